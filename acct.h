@@ -43,7 +43,7 @@ class Acct
 	template<class It> void set_val(const std::string &key, It&& begin, It &&end);
 	template<class T> void set_val(const std::string &key, const T &t);
 
-	Acct(const std::string *const &acct, Adb *const &adb = bot::adb);
+	Acct(const std::string *const &acct, Adb *const &adb = &bot::get_adb());
 	Acct(Acct &&) = delete;
 	Acct(const Acct &) = delete;
 	Acct &operator=(Acct &&) = default;
@@ -1,4 +1,4 @@
-/** 
+/**
  *  COPYRIGHT 2014 (C) Jason Volk
  *  COPYRIGHT 2014 (C) Svetlana Tkachenko
  *
@@ -8,43 +8,230 @@
 
 class Adb
 {
-	std::unique_ptr<stldb::ldb<std::string,std::string>> ldb;
+	std::shared_ptr<Shards> shards;                      // Shared with other Adb on the same path
+	std::unique_ptr<SnapFile> snap;                      // Read-only snapshot mode (shards is null)
+
+	Adoc get(const std::nothrow_t, const Snap &snap, const std::string &name) const noexcept;
+	Adoc get(const Snap &snap, const std::string &name) const;
+	static size_t metric(const std::string &op);         // id of ircbot_adb_seconds{op}
+
+	// The bytes of an ldb value: borrowed when it has data()/size(), else copied into buf
+	template<class T> static auto slice(const T &val, std::string &buf, int) -> decltype(boost::string_ref(val.data(),val.size()));
+	template<class T> static boost::string_ref slice(const T &val, std::string &buf, long);
+
+  public:
+	using string_ref = Snap::string_ref;
+	class Val;
+	using Visitor = std::function<bool (const string_ref &key, const Val &val)>;   // false to stop
+
+	struct Cursor
+	{
+		std::string last;                                // resume after this key; empty to start
+		std::shared_ptr<const Snap> snap;                // pinned in snapshot mode if consistent
+		bool consistent = false;                         // every page from the same snapshot
+		bool done = false;                               // the range is exhausted
+	};
+
+	static constexpr size_t READAHEAD                   = 64;    // entries hinted ahead of a range
+	static std::string successor(const string_ref &prefix);       // first key past all with prefix
+
+  private:
+	size_t range(const Snap &snap, const string_ref &lo, const string_ref &hi, const size_t &limit, bool &end, const Visitor &func) const;
+	size_t range(const string_ref &lo, const string_ref &hi, const size_t &limit, bool &end, const Visitor &func) const;
+	Shards::Ldb &ldb() const;                            // the only one; throws when sharded
 
   public:
-	template<class... A> auto cbegin(A&&... a) const     { return ldb->begin(std::forward<A>(a)...); }
-	template<class... A> auto begin(A&&... a) const      { return ldb->begin(std::forward<A>(a)...); }
-	template<class... A> auto begin(A&&... a)            { return ldb->begin(std::forward<A>(a)...); }
-	template<class... A> auto cend(A&&... a) const       { return ldb->end(std::forward<A>(a)...);   }
-	template<class... A> auto end(A&&... a) const        { return ldb->end(std::forward<A>(a)...);   }
-	template<class... A> auto end(A&&... a)              { return ldb->end(std::forward<A>(a)...);   }
+	bool is_snapshot() const                             { return bool(snap);                        }
+	auto get_snap() const                                { return snap->get();                       }
+	auto &get_shards() const                             { return *shards;                           }
+
+	// Iteration of the ldb of an unsharded db (throws when sharded; use range() instead)
+	template<class... A> auto cbegin(A&&... a) const     { return ldb().begin(std::forward<A>(a)...); }
+	template<class... A> auto begin(A&&... a) const      { return ldb().begin(std::forward<A>(a)...); }
+	template<class... A> auto begin(A&&... a)            { return ldb().begin(std::forward<A>(a)...); }
+	template<class... A> auto cend(A&&... a) const       { return ldb().end(std::forward<A>(a)...);   }
+	template<class... A> auto end(A&&... a) const        { return ldb().end(std::forward<A>(a)...);   }
+	template<class... A> auto end(A&&... a)              { return ldb().end(std::forward<A>(a)...);   }
+
+	// Iteration of either backend; the refs are only valid for the call
+	void for_each(const std::function<void (const string_ref &key, const string_ref &val)> &func) const;
 
-	bool exists(const std::string &name) const           { return ldb->count(name);                  }
-	auto count() const                                   { return ldb->size();                       }
+	// Ordered iteration of either backend over [lo,hi); an empty hi is unbounded
+	size_t range(const string_ref &lo, const string_ref &hi, const Visitor &func) const;
+	size_t range(const string_ref &prefix, const Visitor &func) const;
+	size_t scan(const string_ref &prefix, const size_t &limit, Cursor &cursor, const Visitor &func) const;
+
+	bool exists(const std::string &name) const;
+	size_t count() const;
 
 	Adoc get(const std::nothrow_t, const std::string &name) const noexcept;
 	Adoc get(const std::nothrow_t, const std::string &name) noexcept;
 	Adoc get(const std::string &name) const;
 	Adoc get(const std::string &name);
 
-	void set(const std::string &name, const Adoc &data)  { ldb->insert(name,data);                   }
+	void set(const std::string &name, const Adoc &data);
+
+	// Export the db to an immutable snapshot file (atomically replaces path)
+	size_t write_snap(const std::string &path) const;
 
-	Adb(const std::string &dir);
+	IRCBOT_OVERLOAD(snapshot)                            // Read-only ctor serving from a snapshot file
+	Adb(snapshot_t, const std::string &path);
+	Adb(const std::string &dir, const size_t &shards = 1);
 };
 
 
+/**
+ * Value handed to a range visitor. Nothing is copied or parsed unless the
+ * visitor asks for it, so listing keys costs nothing per document. Valid only
+ * for the duration of the visit.
+ */
+class Adb::Val
+{
+	const void *it;
+	string_ref (*fetch)(const void *it, std::string &buf);
+	mutable std::string buf;
+	mutable string_ref val;
+	mutable bool fetched;
+
+  public:
+	string_ref str() const;                              // raw document
+	Adoc doc() const                                     { return Adoc{Adoc::slice,str()};          }
+	operator Adoc() const                                { return doc();                            }
+
+	Val(const string_ref &val);                          // already in memory (snapshot)
+	template<class It> Val(const It &it);                // read from the ldb iterator on demand
+	Val(const Val &) = delete;
+	Val &operator=(const Val &) = delete;
+};
+
+
+inline
+Adb::Val::Val(const string_ref &val):
+it(nullptr),
+fetch(nullptr),
+val(val),
+fetched(true)
+{
+}
+
+
+template<class It>
+Adb::Val::Val(const It &it):
+it(&it),
+fetch([](const void *const it, std::string &buf)
+{
+	return slice((*static_cast<const It *>(it))->second,buf,0);
+}),
+fetched(false)
+{
+}
+
+
+inline
+Adb::string_ref Adb::Val::str()
+const
+{
+	if(!fetched)
+	{
+		val = fetch(it,buf);
+		fetched = true;
+	}
+
+	return val;
+}
+
+
+inline
+Adb::Adb(const std::string &dir,
+         const size_t &shards):
+shards(!dir.empty()? Shards::open(dir,shards) : nullptr)
+{
+
+}
+
+
+inline
+Adb::Adb(snapshot_t,
+         const std::string &path):
+snap(std::make_unique<SnapFile>(path))
+{
+
+}
+
+
 inline
-Adb::Adb(const std::string &dir):
-ldb(!dir.empty()? std::make_unique<decltype(ldb)::element_type>(dir) : nullptr)
+size_t Adb::write_snap(const std::string &path)
+const
+{
+	if(!shards)
+		throw Exception("No database to snapshot");
+
+	return Snap::write(path,[this]
+	(const auto &func)
+	{
+		range({},{},[&func]
+		(const string_ref &key, const Val &val)
+		{
+			func(key,val.str());
+			return true;
+		});
+	});
+}
+
+
+template<class T>
+auto Adb::slice(const T &val,
+                std::string &buf,
+                int)
+-> decltype(boost::string_ref(val.data(),val.size()))
 {
+	return {val.data(),val.size()};
+}
+
 
+template<class T>
+boost::string_ref Adb::slice(const T &val,
+                             std::string &buf,
+                             long)
+{
+	buf = std::string{val};
+	return buf;
+}
+
+
+inline
+size_t Adb::metric(const std::string &op)
+{
+	return Metrics::id("ircbot_adb_seconds","Time in a database operation.",Metrics::HISTOGRAM,"op=\"" + op + "\"");
+}
+
+
+inline
+void Adb::set(const std::string &name,
+              const Adoc &data)
+{
+	static const auto metric(Adb::metric("set"));
+	const Metrics::Timer timer(metric);
+
+	if(is_snapshot())
+		throw Exception("Database is a read-only snapshot");
+
+	shards->of(name).insert(name,data);
 }
 
 
 inline
 Adoc Adb::get(const std::string &name)
 {
-	const auto it(ldb->find(name));
-	return it? Adoc{std::string{it->second}} : throw Exception("Account not found");
+	static const auto metric(Adb::metric("get"));
+	const Metrics::Timer timer(metric);
+
+	if(is_snapshot())
+		return get(*get_snap(),name);
+
+	std::string buf;
+	const auto it(shards->of(name).find(name));
+	return it? Adoc{Adoc::slice,slice(it->second,buf,0)} : throw Exception("Account not found");
 }
 
 
@@ -52,8 +239,15 @@ inline
 Adoc Adb::get(const std::string &name)
 const
 {
-	const auto it(ldb->find(name));
-	return it? Adoc{std::string{it->second}} : throw Exception("Account not found");
+	static const auto metric(Adb::metric("get"));
+	const Metrics::Timer timer(metric);
+
+	if(is_snapshot())
+		return get(*get_snap(),name);
+
+	std::string buf;
+	const auto it(shards->of(name).find(name));
+	return it? Adoc{Adoc::slice,slice(it->second,buf,0)} : throw Exception("Account not found");
 }
 
 
@@ -62,8 +256,15 @@ Adoc Adb::get(const std::nothrow_t,
               const std::string &name)
 noexcept
 {
-	const auto it = ldb->find(name);
-	return it? Adoc{std::string{it->second}} : Adoc{};
+	static const auto metric(Adb::metric("get"));
+	const Metrics::Timer timer(metric);
+
+	if(is_snapshot())
+		return get(std::nothrow,*get_snap(),name);
+
+	std::string buf;
+	const auto it = shards->of(name).find(name);
+	return it? Adoc{Adoc::slice,slice(it->second,buf,0)} : Adoc{};
 }
 
 
@@ -72,6 +273,281 @@ Adoc Adb::get(const std::nothrow_t,
               const std::string &name)
 const noexcept
 {
-	const auto it = ldb->find(name);
-	return it? Adoc{std::string{it->second}} : Adoc{};
+	static const auto metric(Adb::metric("get"));
+	const Metrics::Timer timer(metric);
+
+	if(is_snapshot())
+		return get(std::nothrow,*get_snap(),name);
+
+	std::string buf;
+	const auto it = shards->of(name).find(name);
+	return it? Adoc{Adoc::slice,slice(it->second,buf,0)} : Adoc{};
+}
+
+
+inline
+Adoc Adb::get(const Snap &snap,
+              const std::string &name)
+const
+{
+	const auto val(snap.get(name));
+	return val.data()? Adoc{Adoc::slice,val} : throw Exception("Account not found");
+}
+
+
+inline
+Adoc Adb::get(const std::nothrow_t,
+              const Snap &snap,
+              const std::string &name)
+const noexcept
+{
+	const auto val(snap.get(name));
+	return val.data()? Adoc{Adoc::slice,val} : Adoc{};
+}
+
+
+inline
+size_t Adb::scan(const string_ref &prefix,
+                 const size_t &limit,
+                 Cursor &cursor,
+                 const Visitor &func)
+const
+{
+	static const auto metric(Adb::metric("scan"));
+	const Metrics::Timer timer(metric);
+
+	if(cursor.done)
+		return 0;
+
+	// The key right after cursor.last is cursor.last with a NUL appended
+	const auto lo(cursor.last.empty()? prefix.to_string() : cursor.last + '\0');
+	const auto hi(successor(prefix));
+	const auto visit([&cursor,&func]
+	(const string_ref &key, const Val &val)
+	{
+		cursor.last.assign(key.begin(),key.end());
+		return func(key,val);
+	});
+
+	if(!is_snapshot())
+		return range(lo,hi,limit,cursor.done,visit);
+
+	if(!cursor.consistent)
+		return range(*get_snap(),lo,hi,limit,cursor.done,visit);
+
+	if(!cursor.snap)
+		cursor.snap = get_snap();
+
+	return range(*cursor.snap,lo,hi,limit,cursor.done,visit);
+}
+
+
+inline
+size_t Adb::range(const string_ref &prefix,
+                  const Visitor &func)
+const
+{
+	return range(prefix,successor(prefix),func);
+}
+
+
+/**
+ * With a Snap a single call is a point-in-time view, as the Snap is held for
+ * the duration. Over ldb each shard's iterator reads its own implicit snapshot,
+ * taken as the call reaches it, so a sharded range is not one point in time.
+ */
+inline
+size_t Adb::range(const string_ref &lo,
+                  const string_ref &hi,
+                  const Visitor &func)
+const
+{
+	static const auto metric(Adb::metric("range"));
+	const Metrics::Timer timer(metric);
+
+	bool end;
+	const auto limit(std::numeric_limits<size_t>::max());
+	return is_snapshot()? range(*get_snap(),lo,hi,limit,end,func):
+	                      range(lo,hi,limit,end,func);
+}
+
+
+inline
+size_t Adb::range(const string_ref &lo,
+                  const string_ref &hi,
+                  const size_t &limit,
+                  bool &end,
+                  const Visitor &func)
+const
+{
+	using It = decltype(ldb().lower_bound(std::string{}));
+	struct Head
+	{
+		Shards::Ldb *ldb;
+		It it;
+		std::string key;
+	};
+
+	end = true;
+	if(!shards)
+		return 0;
+
+	// Each shard is ordered; merge their heads
+	std::vector<Head> heads;
+	heads.reserve(shards->size());
+	for(size_t i(0); i < shards->size(); ++i)
+	{
+		auto &ldb((*shards)[i]);
+		auto it(ldb.lower_bound(lo.to_string()));
+		if(it != ldb.end())
+			heads.push_back({&ldb,it,std::string(it->first)});
+	}
+
+	size_t ret(0);
+	while(!heads.empty())
+	{
+		auto &head(*std::min_element(heads.begin(),heads.end(),[]
+		(const Head &a, const Head &b)
+		{
+			return a.key < b.key;
+		}));
+
+		if(!hi.empty() && head.key >= hi)
+			break;
+
+		if(ret >= limit)
+		{
+			end = false;
+			return ret;
+		}
+
+		++ret;
+		const Val val(head.it);
+		if(!func(head.key,val))
+		{
+			end = false;
+			return ret;
+		}
+
+		if(++head.it != head.ldb->end())
+			head.key = std::string(head.it->first);
+		else
+		{
+			std::swap(head,heads.back());
+			heads.pop_back();
+		}
+	}
+
+	end = true;
+	return ret;
+}
+
+
+inline
+size_t Adb::range(const Snap &snap,
+                  const string_ref &lo,
+                  const string_ref &hi,
+                  const size_t &limit,
+                  bool &end,
+                  const Visitor &func)
+const
+{
+	const auto beg(snap.lower_bound(lo));
+	const auto fin(hi.empty()? snap.count() : snap.lower_bound(hi));
+	if(fin <= beg)                                     // empty, or lo past hi as the ldb path
+	{
+		end = true;
+		return 0;
+	}
+
+	const auto stop(fin - beg > limit? beg + limit : fin);
+	end = stop == fin;
+
+	for(size_t i(beg); i < stop; ++i)
+	{
+		if((i - beg) % READAHEAD == 0)
+			snap.willneed(i,std::min(i + READAHEAD,stop));
+
+		const Val val(snap.val(i));
+		if(!func(snap.key(i),val))
+		{
+			end = false;
+			return i - beg + 1;
+		}
+	}
+
+	return stop - beg;
+}
+
+
+inline
+std::string Adb::successor(const string_ref &prefix)
+{
+	std::string ret(prefix.to_string());
+	while(!ret.empty() && uint8_t(ret.back()) == 0xFF)
+		ret.pop_back();
+
+	if(!ret.empty())
+		++ret.back();
+
+	return ret;
+}
+
+
+inline
+size_t Adb::count()
+const
+{
+	if(is_snapshot())
+		return get_snap()->count();
+
+	size_t ret(0);
+	for(size_t i(0); shards && i < shards->size(); ++i)
+		ret += (*shards)[i].size();
+
+	return ret;
+}
+
+
+inline
+bool Adb::exists(const std::string &name)
+const
+{
+	static const auto metric(Adb::metric("exists"));
+	const Metrics::Timer timer(metric);
+
+	return is_snapshot()? get_snap()->exists(name) : shards && shards->of(name).count(name);
+}
+
+
+inline
+Shards::Ldb &Adb::ldb()
+const
+{
+	if(!shards)
+		throw Exception("Database is disabled");
+
+	if(shards->size() > 1)
+		throw Exception("Database is sharded; iterate it with range()");
+
+	return (*shards)[0];
+}
+
+
+inline
+void Adb::for_each(const std::function<void (const string_ref &, const string_ref &)> &func)
+const
+{
+	if(is_snapshot())
+	{
+		get_snap()->for_each(func);
+		return;
+	}
+
+	range({},{},[&func]
+	(const string_ref &key, const Val &val)
+	{
+		func(key,val.str());
+		return true;
+	});
 }
@@ -0,0 +1,163 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Local Unix socket a Bot answers with its Stats (see: stats.h).
+ *
+ * Each connection is handed to the Bot, which replies on its own thread and
+ * closes it; a reader sees the reply end at EOF (e.g socat - UNIX-CONNECT:path).
+ * Nothing listens without a path. A stale socket file at path (of a process
+ * that's gone, refusing connections) is replaced; one still answered is not,
+ * and the file is removed when closed. After a failed accept the next waits,
+ * from 100ms doubling to 10s, so a full fd table isn't spun on.
+ */
+class Admin
+{
+	using local = boost::asio::local::stream_protocol;
+
+  public:
+	using Sd = std::shared_ptr<local::socket>;
+	using Handler = std::function<void (const boost::system::error_code &, const Sd &)>;
+
+  private:
+	boost::asio::io_service &ios;
+	std::string path;
+	std::unique_ptr<local::acceptor> acceptor;
+	boost::asio::steady_timer timer;                  // delays listen() after a failure
+	milliseconds delay;                               // of the last retry(); 0 after accept()
+
+	void listen(const Handler &handler);
+	static bool in_use(const std::string &path);     // something answers at path
+
+  public:
+	auto &get_path() const                            { return path;                              }
+	bool is_open() const                              { return acceptor && acceptor->is_open();   }
+
+	void accept(const Handler &handler);              // the next connection to handler
+	void retry(const Handler &handler);               // accept() after a growing delay
+	void close();                                     // handler gets operation_aborted
+
+	static void reply(const Sd &sd, std::string text);   // written whole, then closed
+
+	Admin(boost::asio::io_service &ios, const std::string &path);
+	~Admin() noexcept;
+};
+
+
+inline
+Admin::Admin(boost::asio::io_service &ios,
+             const std::string &path):
+ios(ios),
+path(path),
+timer(ios),
+delay(0ms)
+{
+	if(path.empty())
+		return;
+
+	if(in_use(path))
+		throw Exception("Admin socket is in use by another process: ") << path;
+
+	acceptor = std::make_unique<local::acceptor>(ios,local::endpoint(path));
+}
+
+
+inline
+Admin::~Admin()
+noexcept
+{
+	close();
+}
+
+
+inline
+void Admin::close()
+{
+	if(!is_open())
+		return;
+
+	boost::system::error_code ec;
+	timer.cancel(ec);
+	acceptor->close(ec);
+	::unlink(path.c_str());
+}
+
+
+inline
+void Admin::accept(const Handler &handler)
+{
+	delay = 0ms;
+	listen(handler);
+}
+
+
+inline
+void Admin::retry(const Handler &handler)
+{
+	if(!is_open())
+		return;
+
+	delay = std::min(std::max(delay * 2,milliseconds(100)),milliseconds(10000));
+	timer.expires_from_now(delay);
+	timer.async_wait([this,handler]
+	(const boost::system::error_code &e)
+	{
+		if(e != boost::asio::error::operation_aborted)
+			listen(handler);
+	});
+}
+
+
+inline
+void Admin::listen(const Handler &handler)
+{
+	if(!is_open())
+		return;
+
+	const auto sd(std::make_shared<local::socket>(ios));
+	acceptor->async_accept(*sd,[handler,sd]
+	(const boost::system::error_code &e)
+	{
+		handler(e,sd);
+	});
+}
+
+
+/**
+ * Only a refused connection means the file is stale and unlinked; when there's
+ * no file, or it isn't a socket, the bind that follows reports it.
+ */
+inline
+bool Admin::in_use(const std::string &path)
+{
+	boost::asio::io_service ios;
+	local::socket sd(ios);
+	boost::system::error_code ec;
+	sd.connect(local::endpoint(path),ec);
+	if(!ec)
+		return true;
+
+	if(ec == boost::asio::error::connection_refused)
+		::unlink(path.c_str());
+
+	return false;
+}
+
+
+inline
+void Admin::reply(const Sd &sd,
+                  std::string text)
+{
+	const auto buf(std::make_shared<std::string>(std::move(text)));
+	boost::asio::async_write(*sd,boost::asio::buffer(*buf),[sd,buf]
+	(const boost::system::error_code &e, const size_t &size)
+	{
+		boost::system::error_code ec;
+		sd->close(ec);
+	});
+}
@@ -0,0 +1,110 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Process-wide admission of new connections, a token bucket per destination.
+ *
+ * Every Bot::connect() to the same host:port draws from one bucket holding up
+ * to burst tokens, refilled one per interval. Nobody is refused: admit() books
+ * the next free slot and returns how long to wait for it, so N bots returning
+ * from a split connect burst at once and then one per interval, all within
+ * (N - burst) * interval.
+ */
+class Admission
+{
+  public:
+	struct Counters
+	{
+		uint64_t attempts = 0;                         // admit() calls
+		uint64_t deferred = 0;                         // of which had to wait
+		uint64_t successes = 0;                        // TCP connections made
+		uint64_t failures = 0;                         // connects that faulted
+	};
+
+  private:
+	struct Bucket
+	{
+		time_point tat = time_point::min();            // when the bucket is next full (GCRA)
+		Counters counters;
+	};
+
+	static std::mutex mutex;                           // bot.cpp
+	static std::map<std::string,Bucket> buckets;       // bot.cpp
+
+  public:
+	static Counters counters(const std::string &dest);
+	static Counters counters();                        // sum of every destination
+
+	static milliseconds admit(const std::string &dest, const milliseconds &interval, const size_t &burst);
+	static void success(const std::string &dest);
+	static void failure(const std::string &dest);
+};
+
+
+inline
+milliseconds Admission::admit(const std::string &dest,
+                              const milliseconds &interval,
+                              const size_t &burst)
+{
+	using namespace std::chrono;
+
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	auto &bucket(buckets[dest]);
+	const auto now(steady_clock::now());
+	const auto tat(std::max(bucket.tat,now));
+	const auto slot(tat - interval * (burst? burst - 1 : 0));
+	bucket.tat = tat + interval;
+	bucket.counters.attempts++;
+	if(slot <= now)
+		return 0ms;
+
+	bucket.counters.deferred++;
+	return duration_cast<milliseconds>(slot - now);
+}
+
+
+inline
+void Admission::success(const std::string &dest)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	buckets[dest].counters.successes++;
+}
+
+
+inline
+void Admission::failure(const std::string &dest)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	buckets[dest].counters.failures++;
+}
+
+
+inline
+Admission::Counters Admission::counters(const std::string &dest)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	const auto it(buckets.find(dest));
+	return it != buckets.end()? it->second.counters : Counters{};
+}
+
+
+inline
+Admission::Counters Admission::counters()
+{
+	Counters ret;
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	for(const auto &p : buckets)
+	{
+		ret.attempts += p.second.counters.attempts;
+		ret.deferred += p.second.counters.deferred;
+		ret.successes += p.second.counters.successes;
+		ret.failures += p.second.counters.failures;
+	}
+
+	return ret;
+}
@@ -8,14 +8,18 @@
 
 struct Adoc : boost::property_tree::ptree
 {
+	static thread_local std::string buf;                 // bot.cpp; reused by serialization
+
+	std::string &write(std::string &dst) const;          // appends JSON to dst
 	operator std::string() const;
 
 	bool has(const std::string &key) const               { return !get(key,std::string{}).empty();  }
 	bool has_child(const std::string &key) const         { return count(key) > 0;                   }
 	auto operator[](const std::string &key) const        { return get(key,std::string{});           }
 
-	void recurse(const std::function<void (const std::string &, const Adoc &)> &func) const;
-	void for_each(const std::function<void (const std::string &, const std::string &)> &func) const;
+	// Pre-order visitors: recurse() gets (key, parent), for_each() gets (key, value)
+	template<class Func> void recurse(Func&& func) const;
+	template<class Func> void for_each(Func&& func) const;
 
 	// Array document utils
 	template<class C> C into() const;
@@ -26,17 +30,26 @@ struct Adoc : boost::property_tree::ptree
 
 	bool remove(const std::string &key) &;
 	Adoc &merge(const Adoc &src) &;                      // src takes precedence over this
+	Adoc &merge(Adoc &&src) &;                           // src's nodes are moved in
 
 	IRCBOT_OVERLOAD(arg_ctor)                            // Special ctor "--foo=bar" to {"foo": "bar"}
 	Adoc(arg_ctor_t, const std::string &str, const std::string &keyed  = "--", const std::string &valued = "=", const std::string &toksep = " ");
 
+	IRCBOT_OVERLOAD(slice)                               // Parse JSON from a borrowed buffer (i.e db value)
+	Adoc(slice_t, const boost::string_ref &str);
+
 	// Primary ctors
 	Adoc(const std::string &str = "{}");
-	Adoc(boost::property_tree::ptree &&p):               boost::property_tree::ptree(std::move(p)) {}
+	Adoc(boost::property_tree::ptree &&p)                { swap(p);                                 }
 	Adoc(const boost::property_tree::ptree &p):          boost::property_tree::ptree(p) {}
 	template<class It> Adoc(It&& begin, It&& end);
 
 	friend std::ostream &operator<<(std::ostream &s, const Adoc &adoc);
+
+  private:
+	static void take(boost::property_tree::ptree &dst, const boost::property_tree::ptree &src)  { dst = src;       }
+	static void take(boost::property_tree::ptree &dst, boost::property_tree::ptree &src)        { dst.swap(src);  }
+	template<class Tree> static void merge(boost::property_tree::ptree &dst, Tree &src);
 };
 
 
@@ -54,19 +67,16 @@ Adoc::Adoc(It&& beg,
 
 inline
 Adoc::Adoc(const std::string &str)
-try:
-boost::property_tree::ptree([str]
-{
-	std::stringstream ss(str);
-	boost::property_tree::ptree ret;
-	boost::property_tree::json_parser::read_json(ss,ret);
-	return ret;
-}())
 {
+	json::parse(*this,str);
 }
-catch(const boost::property_tree::json_parser::json_parser_error &e)
+
+
+inline
+Adoc::Adoc(slice_t,
+           const boost::string_ref &str)
 {
-	throw Exception(e.what());
+	json::parse(*this,str);
 }
 
 
@@ -85,37 +95,68 @@ Adoc::Adoc(arg_ctor_t,
 }
 
 
+inline
+Adoc &Adoc::merge(Adoc &&src)
+&
+{
+	merge(*this,static_cast<boost::property_tree::ptree &>(src));
+	return *this;
+}
+
+
 inline
 Adoc &Adoc::merge(const Adoc &src)
 &
 {
-	const std::function<void (const Adoc &src, Adoc &dst)> recurse([&recurse]
-	(const Adoc &src, Adoc &dst)
+	merge(*this,static_cast<const boost::property_tree::ptree &>(src));
+	return *this;
+}
+
+
+/**
+ * Iterative and in place: an object in src is descended into the matching object
+ * of dst (created if absent), a value in src replaces the one at its key in dst,
+ * and array elements are appended. When src is mutable its subtrees are swapped
+ * into dst rather than copied.
+ */
+template<class Tree>
+void Adoc::merge(boost::property_tree::ptree &dst,
+                 Tree &src)
+{
+	using ptree = boost::property_tree::ptree;
+	struct Frame
+	{
+		decltype(src.begin()) it;
+		decltype(src.end()) end;
+		ptree *dst;
+	};
+
+	std::vector<Frame> stack {{src.begin(),src.end(),&dst}};
+	while(!stack.empty())
 	{
-		for(const auto &pair : src)
+		auto &frame(stack.back());
+		if(frame.it == frame.end)
 		{
-			const auto &key(pair.first);
-			const auto &sub(pair.second);
-
-			if(!sub.empty())
-			{
-				Adoc child(dst.get_child(key,Adoc{}));
-				recurse(sub,child);
-
-				if(key.empty())
-					dst.push(child);
-				else
-					dst.put_child(key,child);
-			}
-			else if(key.empty())
-				dst.push(sub.get("",std::string{}));
-			else
-				dst.put_child(key,sub);
+			stack.pop_back();
+			continue;
 		}
-	});
 
-	recurse(src,*this);
-	return *this;
+		auto &pair(*frame.it++);
+		auto &doc(*frame.dst);
+		const auto &key(pair.first);
+		auto &sub(pair.second);
+
+		if(key.empty())
+			take(doc.push_back({key,ptree{}})->second,sub);
+		else if(sub.empty())
+			take(doc.put_child(key,ptree{}),sub);
+		else
+		{
+			const auto child(doc.get_child_optional(key));
+			auto &next(child? *child : doc.put_child(key,ptree{}));
+			stack.push_back({sub.begin(),sub.end(),&next});
+		}
+	}
 }
 
 
@@ -193,35 +234,44 @@ const
 }
 
 
-inline
-void Adoc::for_each(const std::function<void (const std::string &key, const std::string &val)> &func)
+template<class Func>
+void Adoc::for_each(Func&& func)
 const
 {
 	recurse([&func]
-	(const std::string &key, const Adoc &doc)
+	(const std::string &key, const boost::property_tree::ptree &doc)
 	{
-		func(key,doc[key]);
+		func(key,doc.get(key,std::string{}));
 	});
 }
 
 
-inline
-void Adoc::recurse(const std::function<void (const std::string &key, const Adoc &doc)> &func)
+template<class Func>
+void Adoc::recurse(Func&& func)
 const
 {
-	const std::function<void (const Adoc &)> re([&re,&func]
-	(const Adoc &doc)
+	using ptree = boost::property_tree::ptree;
+	struct Frame
 	{
-		for(const auto &pair : doc)
+		ptree::const_iterator it;
+		const ptree *doc;
+	};
+
+	std::vector<Frame> stack {{begin(),this}};
+	while(!stack.empty())
+	{
+		auto &frame(stack.back());
+		if(frame.it == frame.doc->end())
 		{
-			const auto &key(pair.first);
-			const auto &sub(pair.second);
-			func(key,doc);
-			re(sub);
+			stack.pop_back();
+			continue;
 		}
-	});
 
-	re(*this);
+		const auto &doc(*frame.doc);
+		const auto &pair(*frame.it++);
+		func(pair.first,doc);
+		stack.push_back({pair.second.begin(),&pair.second});
+	}
 }
 
 
@@ -229,9 +279,16 @@ inline
 Adoc::operator std::string()
 const
 {
-	std::stringstream ss;
-	ss << (*this);
-	return ss.str();
+	buf.clear();
+	return write(buf);
+}
+
+
+inline
+std::string &Adoc::write(std::string &dst)
+const
+{
+	return json::write(dst,*this);
 }
 
 
@@ -239,6 +296,7 @@ inline
 std::ostream &operator<<(std::ostream &s,
                          const Adoc &doc)
 {
-	boost::property_tree::write_json(s,doc,false);
-	return s;
+	Adoc::buf.clear();
+	doc.write(Adoc::buf);
+	return s.write(Adoc::buf.data(),Adoc::buf.size());
 }
@@ -27,7 +27,7 @@ class AKick
 
 	explicit operator const Mask &() const       { return get_mask();                              }
 
-	bool operator<(const AKick &o) const         { return mask < std::string(o.mask);              }
+	bool operator<(const AKick &o) const         { return mask < static_cast<const std::string &>(o.mask); }
 	bool operator==(const AKick &o) const        { return mask == o.mask;                          }
 
 	AKick(const Mask &mask,
@@ -0,0 +1,186 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Scratch memory of one dispatch, released all at once.
+ *
+ * The Bot opens a Scope around parsing a line and running its handlers, and
+ * the Msg it parses carries the Scope's arena to them (Msg::get_arena()) for
+ * their scratch. An Arena::Alloc made with it takes memory by bumping a pointer
+ * through the thread's blocks and frees nothing; closing the outermost Scope
+ * rewinds the pointer to the start (one opened within another releases
+ * nothing, as what it allocates may belong to containers of the outer one).
+ * The blocks are kept for the next line, so once they have grown to the
+ * largest dispatch seen, what a dispatch allocates here costs no malloc.
+ * Nothing of the Msg itself is in the arena, as handlers keep Msgs and their
+ * params past the dispatch. An Alloc made without an arena, and requests of a
+ * quarter block or more, are std::allocator.
+ *
+ * What is allocated here must not outlive the Scope it was made in: pass it by
+ * reference, or copy it out (a copy is never in the arena).
+ */
+class Arena
+{
+	static constexpr size_t ALIGN = 16;
+	static constexpr size_t BLOCK = 64 * 1024;
+	static constexpr size_t LARGE = BLOCK / 4;        // and above from operator new
+
+	std::vector<std::unique_ptr<uint8_t[]>> blocks;
+	size_t block;                                     // being bumped
+	size_t pos;                                       // into it
+	size_t depth;                                     // of open Scopes
+
+	static thread_local Arena local;                  // bot.cpp
+
+  public:
+	struct Scope                                      // opens this thread's arena; the outermost rewinds it
+	{
+		Arena *const arena;
+
+		Scope();
+		~Scope() noexcept;
+	};
+
+	struct Ref;
+	template<class T> struct Alloc;
+	using String = std::basic_string<char, std::char_traits<char>, Alloc<char>>;
+
+	static size_t get_reserved()                      { return local.blocks.size() * BLOCK;      }
+
+	void *allocate(const size_t &bytes);
+
+	Arena();
+	Arena(Arena &&) = delete;
+	Arena(const Arena &) = delete;
+	Arena &operator=(Arena &&) = delete;
+	Arena &operator=(const Arena &) = delete;
+};
+
+
+inline
+Arena::Arena():
+block(0),
+pos(0),
+depth(0)
+{
+}
+
+
+inline
+Arena::Scope::Scope():
+arena(&local)
+{
+	++local.depth;
+}
+
+
+inline
+Arena::Scope::~Scope()
+noexcept
+{
+	if(--local.depth)
+		return;
+
+	local.block = 0;
+	local.pos = 0;
+}
+
+
+inline
+void *Arena::allocate(const size_t &bytes)
+{
+	const auto size((bytes + ALIGN - 1) / ALIGN * ALIGN);
+	if(block < blocks.size() && pos + size <= BLOCK)
+	{
+		const auto ret(blocks[block].get() + pos);
+		pos += size;
+		return ret;
+	}
+
+	if(block < blocks.size())
+		++block;
+
+	if(block == blocks.size())
+		blocks.emplace_back(new uint8_t[BLOCK]);
+
+	pos = size;
+	return blocks[block].get();
+}
+
+
+/**
+ * An arena pointer its holder's copies and moves don't carry: a Msg kept past
+ * its dispatch, by either, has no arena to hand out.
+ */
+struct Arena::Ref
+{
+	Arena *ptr;
+
+	operator Arena *() const                          { return ptr;                              }
+
+	Ref &operator=(const Ref &)                       { ptr = nullptr; return *this;             }
+	Ref(const Ref &): ptr(nullptr) {}
+	Ref(Arena *const &ptr = nullptr): ptr(ptr) {}
+};
+
+
+/**
+ * Takes from the arena it was made with, or none. A container copied, or
+ * move-assigned to one with another allocator, is not in the arena; one move
+ * constructed keeps it, as an allocator must, so never move one out of its
+ * Scope. Swapping exchanges the allocators with the memory they own.
+ */
+template<class T>
+struct Arena::Alloc
+{
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::false_type;
+	using propagate_on_container_move_assignment = std::false_type;
+	using propagate_on_container_swap = std::true_type;
+
+	Arena *arena;
+
+	T *allocate(const size_t n);
+	void deallocate(T *const p, const size_t n) noexcept;
+	Alloc select_on_container_copy_construction() const  { return {nullptr};                  }
+
+	template<class U> Alloc(const Alloc<U> &o) noexcept: arena(o.arena) {}
+	Alloc(Arena *const &arena = nullptr) noexcept: arena(arena) {}
+};
+
+
+template<class T>
+T *Arena::Alloc<T>::allocate(const size_t n)
+{
+	const auto bytes(n * sizeof(T));
+	return static_cast<T *>(arena && bytes < LARGE? arena->allocate(bytes) : ::operator new(bytes));
+}
+
+
+template<class T>
+void Arena::Alloc<T>::deallocate(T *const p,
+                                 const size_t n)
+noexcept
+{
+	if(!arena || n * sizeof(T) >= LARGE)
+		::operator delete(p);
+}
+
+
+template<class T, class U>
+bool operator==(const Arena::Alloc<T> &a, const Arena::Alloc<U> &b)
+{
+	return a.arena == b.arena;
+}
+
+
+template<class T, class U>
+bool operator!=(const Arena::Alloc<T> &a, const Arena::Alloc<U> &b)
+{
+	return a.arena != b.arena;
+}
@@ -0,0 +1,67 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Exponential reconnect delay with jitter.
+ *
+ * The n'th consecutive retry waits min(max, min * 2^n), half of it fixed and
+ * half random, so a fleet faulted by the same split spreads out instead of
+ * returning together, and no retry ever waits longer than max.
+ */
+class Backoff
+{
+	milliseconds min;
+	milliseconds max;
+	uint32_t attempts;                                 // since the last reset()
+
+  public:
+	auto &get_min() const                              { return min;                                }
+	auto &get_max() const                              { return max;                                }
+	auto &get_attempts() const                         { return attempts;                           }
+	milliseconds calc_ceil() const;                    // upper bound of the next delay
+
+	void reset()                                       { attempts = 0;                              }
+	milliseconds next();
+
+	Backoff(const milliseconds &min, const milliseconds &max);
+};
+
+
+inline
+Backoff::Backoff(const milliseconds &min,
+                 const milliseconds &max):
+min(min),
+max(std::max(min,max)),
+attempts(0)
+{
+
+}
+
+
+inline
+milliseconds Backoff::next()
+{
+	static thread_local std::minstd_rand rng(std::random_device{}());
+
+	const auto ceil(calc_ceil().count());
+	std::uniform_int_distribution<int64_t> jitter(0,ceil / 2);
+	++attempts;
+	return milliseconds(ceil - ceil / 2 + jitter(rng));
+}
+
+
+inline
+milliseconds Backoff::calc_ceil()
+const
+{
+	auto ret(min);
+	for(uint32_t i(0); i < attempts && ret < max; ++i)
+		ret *= 2;
+
+	return std::min(ret,max);
+}
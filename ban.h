@@ -21,7 +21,7 @@ class Ban
 
 	explicit operator const Mask &() const       { return get_mask();                              }
 
-	bool operator<(const Ban &o) const           { return get_mask() < std::string(o.get_mask());  }
+	bool operator<(const Ban &o) const           { return get_mask() < static_cast<const std::string &>(o.get_mask()); }
 	bool operator==(const Ban &o) const          { return get_mask() == o.get_mask();              }
 
 	Ban(const Mask &mask, const Mask &oper = "", const time_t &time  = 0);
@@ -0,0 +1,459 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Microbenchmarks for the library's hot paths.
+ *
+ * Usage: bench [corpus] [filter] [min-ms] > results.json
+ *	corpus  - server lines, one per line (default: bench/corpus.txt)
+ *	filter  - run only the cases whose names start with this
+ *	min-ms  - minimum time spent on each case (default: 500)
+ *
+ * JSON goes to stdout and a summary to stderr (see: bench.h).
+ */
+
+#ifndef IRCBOT_VERSION
+#define IRCBOT_VERSION "unknown"
+#endif
+
+#include "bot.h"
+
+using namespace irc::bot;
+
+#include "bench.h"
+
+
+static
+std::vector<std::string> read_corpus(const std::string &path)
+{
+	std::ifstream file(path);
+	if(!file.good())
+		throw Assertive("Failed to open corpus: ") << path;
+
+	std::vector<std::string> ret;
+	for(std::string line; std::getline(file,line); )
+		if(!line.empty())
+			ret.emplace_back(line + "\r\n");
+
+	return ret;
+}
+
+
+static
+std::vector<Msg> parse_corpus(const std::vector<std::string> &corpus)
+{
+	std::vector<Msg> ret;
+	for(const auto &line : corpus)
+		ret.emplace_back(line);
+
+	return ret;
+}
+
+
+static
+void bench_msg(Bench &bench,
+               const std::vector<std::string> &corpus)
+{
+	bench("msg.parse",[&corpus]
+	{
+		for(const auto &line : corpus)
+		{
+			const Msg msg(line);
+			Bench::keep(msg);
+		}
+
+		return corpus.size();
+	});
+}
+
+
+/**
+ * The names registered are those of Bot::init_irc_handlers() at Prio::LIB,
+ * with a USER handler added for some as an application would.
+ */
+static
+void bench_handlers(Bench &bench,
+                    const std::vector<Msg> &msgs)
+{
+	static const std::vector<std::string> names
+	{
+		"ERROR", "QUIT", "CAP", "ACCOUNT", "PING", "MODE", "NICK", "JOIN", "PART", "KICK",
+		"TOPIC", "INVITE", "NOTICE", "ACTION", "PRIVMSG", "AUTHENTICATE", "CTCP",
+	};
+
+	static const std::vector<uint32_t> codes
+	{
+		RPL_WELCOME, RPL_YOURHOST, RPL_CREATED, RPL_MYINFO, RPL_ISUPPORT, RPL_LIST, RPL_LISTEND,
+		RPL_NAMREPLY, RPL_ENDOFNAMES, RPL_UMODEIS, RPL_ISON, RPL_AWAY, RPL_WHOREPLY, RPL_WHOSPCRPL,
+		RPL_WHOISUSER, RPL_WHOISIDLE, RPL_WHOISSERVER, RPL_WHOISSECURE, RPL_WHOISLOGGEDIN,
+		RPL_ENDOFWHOIS, RPL_WHOWASUSER, RPL_CHANNELMODEIS, RPL_TOPIC, RPL_NOTOPIC, RPL_TOPICWHOTIME,
+		RPL_CREATIONTIME, RPL_ENDOFBANLIST, RPL_ENDOFQUIETLIST, RPL_ENDOFWHO, RPL_HOSTHIDDEN,
+		RPL_BANLIST, RPL_INVITELIST, RPL_EXCEPTLIST, RPL_QUIETLIST, RPL_MONONLINE, RPL_MONOFFLINE,
+		RPL_MONLIST, RPL_ENDOFMONLIST, RPL_ACCEPTLIST, RPL_ENDOFACCEPT, RPL_KNOCK, RPL_INVITING,
+		ERR_MLOCKRESTRICTED, ERR_MONLISTFULL, ERR_ACCEPTFULL, ERR_CHANNELISFULL, ERR_ACCEPTEXIST,
+		ERR_ACCEPTNOT, ERR_NOSUCHNICK, ERR_KNOCKONCHAN, ERR_USERONCHANNEL, ERR_USERNOTINCHANNEL,
+		ERR_NICKNAMEINUSE, ERR_UNKNOWNMODE, ERR_CHANOPRIVSNEEDED, ERR_ERRONEUSNICKNAME,
+		ERR_BANNEDFROMCHAN, ERR_CANNOTSENDTOCHAN,
+	};
+
+	size_t calls(0);
+	Events events;
+	const auto func([&calls](const Msg &) { ++calls; });
+	events.msg.add(handler::MISS,func,handler::RECURRING,handler::Prio::LIB);
+	for(const auto &name : names)
+		events.msg.add(name,func,handler::RECURRING,handler::Prio::LIB);
+
+	for(const auto &code : codes)
+		events.msg.add(code,func,handler::RECURRING,handler::Prio::LIB);
+
+	events.msg.add("PRIVMSG",func,handler::RECURRING);
+	events.msg.add("NOTICE",func,handler::RECURRING);
+	events.msg.add(RPL_ENDOFWHOIS,func,handler::RECURRING);
+
+	bench("handlers.dispatch",[&events,&msgs,&calls]
+	{
+		for(const auto &msg : msgs)
+			events.msg(msg);
+
+		Bench::keep(calls);
+		return msgs.size();
+	});
+}
+
+
+static
+void bench_mask(Bench &bench)
+{
+	static const std::vector<Mask> bans
+	{
+		"*!*@198.51.100.*", "*!*@gateway/web/freenode/ip.192.0.2.1", "spam*!*@*", "*!~*@*",
+		"*!*@*.example.org", "*!*eve@unaffiliated/eve", "?allory!*@203.0.113.66", "*!*@2001:db8:*",
+		"troll!*@*", "*!*@*/bot/*", "*!*@pool-*.fios.verizon.net", "*!*@tor-exit.*",
+	};
+
+	static const std::vector<Mask> users
+	{
+		"alice!~alice@gateway/web/freenode/ip.203.0.113.7", "bob!~bob@unaffiliated/bob",
+		"carol!~carol@2001:db8:1f70::999:de8:7648:6e8", "dave!~dave@c-98-207-2-10.hsd1.ca.comcast.net",
+		"eve!~eve@unaffiliated/eve", "frank!~frank@198.51.100.23",
+		"grace!~grace@pool-71-105-23-9.nycmny.fios.verizon.net", "heidi!~heidi@tor-exit.example.org",
+		"mallory!~mallory@203.0.113.66", "spambot!spam@192.0.2.99",
+	};
+
+	bench("mask.match",[]
+	{
+		size_t matched(0);
+		for(const auto &user : users)
+			for(const auto &ban : bans)
+				matched += ban == user;
+
+		Bench::keep(matched);
+		return users.size() * bans.size();
+	});
+}
+
+
+static
+void bench_deltas(Bench &bench)
+{
+	static const std::vector<std::string> strs
+	{
+		"+o ircbot",
+		"+bq-v *!*@203.0.113.* $a:troll carol",
+		"+oooo alice bob dave frank",
+		"+Ccnt",
+		"-lk 50 secret",
+		"+vvvv-o grace heidi ivan judy mallory",
+		"+b-b *!*@198.51.100.* *!*@192.0.2.*",
+	};
+
+	bench("deltas.parse",[]
+	{
+		for(const auto &str : strs)
+		{
+			const Deltas deltas(str);
+			Bench::keep(deltas);
+		}
+
+		return strs.size();
+	});
+
+	std::vector<Deltas> deltas;
+	for(const auto &str : strs)
+		deltas.emplace_back(str);
+
+	bench("deltas.serialize",[&deltas]
+	{
+		for(const auto &d : deltas)
+		{
+			const std::string str(d);
+			Bench::keep(str);
+		}
+
+		return deltas.size();
+	});
+}
+
+
+static
+void bench_adoc(Bench &bench)
+{
+	static const std::string doc
+	{R"({
+		"info":{"registered":"1325376000","last_addr":"~alice@gateway/web/freenode/ip.203.0.113.7","flags":"HIDEMAIL"},
+		"votes":{"ban":{"yea":"12","nay":"3","last":"1444850000"},"kick":{"yea":"4","nay":"0","last":"1444000000"}},
+		"config":{"lang":"en","tz":"UTC","greet":"hello everyone"},
+		"seen":{"time":"1444852329","chan":"#ircbot","msg":"hello everyone, is the bot around?"}
+	})"};
+
+	bench("adoc.parse",[]
+	{
+		const Adoc adoc(doc);
+		Bench::keep(adoc);
+		return 1;
+	});
+
+	// What Adoc's parser replaced: boost's reader over a stringstream copy
+	bench("adoc.parse.read_json",[]
+	{
+		std::stringstream s(doc);
+		boost::property_tree::ptree pt;
+		boost::property_tree::read_json(s,pt);
+		Bench::keep(pt);
+		return 1;
+	});
+
+	const Adoc adoc(doc);
+	bench("adoc.serialize",[&adoc]
+	{
+		const std::string str(adoc);
+		Bench::keep(str);
+		return 1;
+	});
+}
+
+
+/**
+ * Reads of a scratch database; each parses the value where the ldb holds it.
+ */
+static
+void bench_adb(Bench &bench)
+{
+	static constexpr size_t NUM_ACCTS = 1000;
+
+	char tmpl[] = "/tmp/ircbot-bench.XXXXXX";
+	if(!::mkdtemp(tmpl))
+		throw Assertive("Failed to make a scratch directory: ") << strerror(errno);
+
+	const std::string dir(tmpl);
+	const scope cleanup([&dir]
+	{
+		const auto cmd("rm -rf '" + dir + "'");
+		if(::system(cmd.c_str()) != 0)
+			std::cerr << "failed to remove " << dir << std::endl;
+	});
+
+	const Adoc doc(R"({"info":{"registered":"1325376000","flags":"HIDEMAIL"},"seen":{"time":"1444852329","chan":"#ircbot"}})");
+	std::vector<std::string> names;
+	Adb adb(dir + "/adb");
+	for(size_t i(0); i < NUM_ACCTS; i++)
+	{
+		names.emplace_back("acct" + lex_cast(i));
+		adb.set(names.back(),doc);
+	}
+
+	bench("adb.get",[&adb,&names]
+	{
+		for(const auto &name : names)
+			Bench::keep(adb.get(std::nothrow,name));
+
+		return names.size();
+	});
+}
+
+
+/**
+ * Nicks change as handle_nick() does it: in Users and in every channel.
+ */
+static
+void bench_state(Bench &bench,
+                 Bot &bot)
+{
+	static constexpr size_t NUM_USERS = 10000;
+	static constexpr size_t NUM_CHANS = 100;
+	static constexpr size_t CHANS_PER_USER = 5;
+	static constexpr size_t NUM_RENAMES = 64;           // each visits every channel
+
+	auto &users(bot.users);
+	auto &chans(bot.chans);
+	std::vector<std::string> nicks, names;
+	for(size_t i(0); i < NUM_CHANS; i++)
+		names.emplace_back(chans.add("#chan" + lex_cast(i)).get_name());
+
+	for(size_t i(0); i < NUM_USERS; i++)
+	{
+		nicks.emplace_back("User" + lex_cast(i));
+		auto &user(users.add(nicks.back(),"host-" + lex_cast(i % 997) + ".example.net","acct" + lex_cast(i)));
+		for(size_t j(0); j < CHANS_PER_USER; j++)
+			chans.get(names.at((i + j * 97) % NUM_CHANS)).users.add(user);
+	}
+
+	bench("users.lookup",[&users,&nicks]
+	{
+		for(const auto &nick : nicks)
+			Bench::keep(users.get(tolower(nick)));
+
+		return nicks.size();
+	});
+
+	bench("chans.lookup",[&chans,&names]
+	{
+		for(const auto &name : names)
+			Bench::keep(chans.get(name));
+
+		return names.size();
+	});
+
+	const auto rename([&users,&chans]
+	(const std::string &old_nick, const std::string &new_nick)
+	{
+		users.rename(old_nick,new_nick);
+		const auto &user(users.get(new_nick));
+		chans.for_each([&user,&old_nick](Chan &chan)
+		{
+			chan.users.rename(user,old_nick);
+		});
+	});
+
+	bench("users.rename",[&nicks,&rename]
+	{
+		for(size_t i(0); i < NUM_RENAMES; i++)
+			rename(nicks.at(i),nicks.at(i) + "_");
+
+		for(size_t i(0); i < NUM_RENAMES; i++)
+			rename(nicks.at(i) + "_",nicks.at(i));
+
+		return NUM_RENAMES * 2;
+	});
+
+	chans.for_each([](Chan &chan) { chan.users.clear(); });
+	users.clear();
+	for(const auto &name : names)
+		chans.del(name);
+}
+
+
+/**
+ * The socket is corked so lines are formatted and split as for sending,
+ * then discarded rather than queued.
+ */
+static
+void bench_locutor(Bench &bench,
+                   Bot &bot)
+{
+	std::string text;
+	while(text.size() < 2048)
+		text += "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor. ";
+
+	bench("packetize",[&text]
+	{
+		const auto toks(tokens(packetize(text),"\n"));
+		Bench::keep(toks);
+		return 1;
+	});
+
+	auto &sock(bot.sess.get_socket());
+	Locutor loc(bot.context,"#ircbot");
+	sock.set_cork();
+	bench("locutor.msg",[&loc,&sock,&text]
+	{
+		loc << Locutor::PRIVMSG << text << Locutor::flush;
+		sock.clear();
+		return 1;
+	});
+
+	sock.unset_cork();
+}
+
+
+/**
+ * Lines are scheduled an hour out so the sendq thread only holds them. Only a
+ * pointer is compared for the socket; the one given is never written to.
+ */
+static
+void bench_sendq(Bench &bench)
+{
+	static constexpr size_t NUM_LINES = 1024;
+
+	boost::asio::io_service ios;
+	boost::asio::ip::tcp::socket sd(ios);
+	const std::string pck("PRIVMSG #ircbot :Lorem ipsum dolor sit amet, consectetur adipiscing elit");
+
+	bench("sendq.schedule",[&sd,&pck]
+	{
+		const auto base(steady_clock::now() + std::chrono::hours(1));
+		{
+			const std::lock_guard<decltype(sendq::mutex)> lock(sendq::mutex);
+			for(size_t i(0); i < NUM_LINES; i++)
+			{
+				sendq::Ent ent{base + milliseconds((i * 7919) % NUM_LINES),&sd,pck,nullptr};
+				sendq::process(ent);
+			}
+		}
+
+		sendq::purge(&sd);
+		return NUM_LINES;
+	});
+
+	bench("sendq.submit",[&sd,&pck]
+	{
+		const auto base(steady_clock::now() + std::chrono::hours(1));
+		for(size_t i(0); i < NUM_LINES; i++)
+			sendq::submit({base + milliseconds(i),&sd,pck,nullptr});
+
+		sendq::purge(&sd);
+		return NUM_LINES;
+	});
+}
+
+
+int main(int argc, char **argv)
+try
+{
+	const std::string path(argc > 1? argv[1] : "bench/corpus.txt");
+	const std::string filter(argc > 2? argv[2] : "");
+	const milliseconds min_time(argc > 3? lex_cast<int64_t>(argv[3]) : 500);
+
+	const auto corpus(read_corpus(path));
+	const auto msgs(parse_corpus(corpus));
+
+	Opts opts;
+	opts["nick"] = "ircbot";
+	opts["throttle-msg"] = "0";
+	opts["target-max"] = "0";
+	Bot bot(opts);
+
+	Bench bench(min_time,filter);
+	bench_msg(bench,corpus);
+	bench_handlers(bench,msgs);
+	bench_mask(bench);
+	bench_deltas(bench);
+	bench_adoc(bench);
+	bench_adb(bench);
+	bench_state(bench,bot);
+	bench_locutor(bench,bot);
+	bench_sendq(bench);
+
+	std::cout << bench;
+	return 0;
+}
+catch(const std::exception &e)
+{
+	std::cerr << "bench: " << e.what() << std::endl;
+	return 1;
+}
@@ -0,0 +1,135 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Minimal timing harness for the bench suite.
+ *
+ * A case is a function doing one pass over its input and returning how many
+ * items it processed. It's run once to warm up, then in passes until min_time
+ * has elapsed; the result is the mean time per item over all passes. Results
+ * are written as JSON for CI to diff; progress goes to stderr.
+ */
+class Bench
+{
+  public:
+	using nanoseconds = std::chrono::nanoseconds;
+	using Case = std::function<size_t ()>;
+
+	struct Result
+	{
+		std::string name;
+		size_t passes;
+		size_t items;                                 // total over all passes
+		nanoseconds elapsed;
+
+		double ns_per_item() const;
+		double items_per_sec() const;
+	};
+
+  private:
+	milliseconds min_time;
+	std::string filter;                               // run only names starting with this
+	std::vector<Result> results;
+
+  public:
+	auto &get_results() const                         { return results;                            }
+
+	template<class T> static void keep(T &&t);       // value must be computed
+	void operator()(const std::string &name, const Case &func);
+
+	Bench(const milliseconds &min_time = 500ms, const std::string &filter = {});
+
+	friend std::ostream &operator<<(std::ostream &s, const Bench &b);   // JSON
+};
+
+
+inline
+Bench::Bench(const milliseconds &min_time,
+             const std::string &filter):
+min_time(min_time),
+filter(filter)
+{
+}
+
+
+inline
+void Bench::operator()(const std::string &name,
+                       const Case &func)
+{
+	if(!boost::starts_with(name,filter))
+		return;
+
+	keep(func());
+
+	Result res {name,0,0,nanoseconds(0)};
+	const auto start(steady_clock::now());
+	do
+	{
+		res.items += func();
+		res.passes++;
+		res.elapsed = steady_clock::now() - start;
+	}
+	while(res.elapsed < min_time);
+
+	std::cerr << std::setw(24) << std::left << name
+	          << std::setw(12) << std::right << std::fixed << std::setprecision(1) << res.ns_per_item() << " ns/item "
+	          << std::setw(14) << std::right << std::setprecision(0) << res.items_per_sec() << " items/s"
+	          << std::endl;
+
+	results.emplace_back(std::move(res));
+}
+
+
+template<class T>
+void Bench::keep(T &&t)
+{
+	asm volatile("" : : "g"(&t) : "memory");
+}
+
+
+inline
+double Bench::Result::ns_per_item()
+const
+{
+	return items? double(elapsed.count()) / items : 0.0;
+}
+
+
+inline
+double Bench::Result::items_per_sec()
+const
+{
+	return elapsed.count()? items * 1e9 / elapsed.count() : 0.0;
+}
+
+
+inline
+std::ostream &operator<<(std::ostream &s,
+                         const Bench &b)
+{
+	s << "{" << std::endl;
+	s << "\t\"version\": \"" << IRCBOT_VERSION << "\"," << std::endl;
+	s << "\t\"min_time_ms\": " << b.min_time.count() << "," << std::endl;
+	s << "\t\"results\": [" << std::endl;
+	for(auto it(b.results.begin()); it != b.results.end(); ++it)
+	{
+		s << "\t\t{"
+		  << "\"name\": \"" << it->name << "\", "
+		  << "\"passes\": " << it->passes << ", "
+		  << "\"items\": " << it->items << ", "
+		  << "\"elapsed_ns\": " << it->elapsed.count() << ", "
+		  << std::fixed << std::setprecision(2)
+		  << "\"ns_per_item\": " << it->ns_per_item() << ", "
+		  << "\"items_per_sec\": " << it->items_per_sec()
+		  << "}" << (std::next(it) != b.results.end()? "," : "") << std::endl;
+	}
+
+	s << "\t]" << std::endl;
+	s << "}" << std::endl;
+	return s;
+}
@@ -0,0 +1,562 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Performance gate: fixed scenarios measured against a baseline in the repo.
+ *
+ * Usage: perf [--key=val ...]
+ *	--baseline=bench/baseline.json   compared against; its thresholds apply
+ *	--out=perf.json                  results, in the baseline's format
+ *	--update                         merge the results into the baseline instead
+ *	--passes=5                       of each scenario; the best is kept
+ *	--filter=                        run only the scenarios starting with this
+ *
+ * Each scenario is a set of lines replayed through a fresh Bot without a
+ * socket (see: replay.h), or reads of a scratch Adb. Per item, it reports
+ * instructions and cycles (see: Meter), allocations and the time taken, and
+ * the RSS once it's done. Instructions or allocations of a scenario in the
+ * baseline grown by more than their threshold (in percent) are a regression,
+ * and the exit status is 2. So is a scenario run that the baseline lacks, and
+ * a baseline with no results at all (record one with --update). Counters
+ * missing from either side are reported and not compared: a baseline recorded
+ * where perf_event_open() is refused gates on allocations only.
+ *
+ * Only instructions and allocations gate, being nearly deterministic for a
+ * build; cycles, time and RSS vary with the machine and its load from one run
+ * to the next, so past their thresholds they are reported and nothing more. A
+ * baseline is only comparable to runs of the same compiler and flags.
+ *
+ * --update replaces the results of the scenarios run and keeps the rest, so a
+ * filtered run records only what it ran.
+ */
+
+#ifndef IRCBOT_VERSION
+#define IRCBOT_VERSION "unknown"
+#endif
+
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "bot.h"
+
+using namespace irc::bot;
+
+#include "perf.h"
+
+
+/**
+ * Every malloc of the process is counted on its way to glibc's; operator new
+ * and the containers of leveldb come here too.
+ */
+std::atomic<size_t> Meter::allocs;
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t num, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C"
+void *malloc(size_t size)
+noexcept
+{
+	Meter::allocs.fetch_add(1,std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+
+extern "C"
+void *calloc(size_t num,
+             size_t size)
+noexcept
+{
+	Meter::allocs.fetch_add(1,std::memory_order_relaxed);
+	return __libc_calloc(num,size);
+}
+
+
+extern "C"
+void *realloc(void *ptr,
+              size_t size)
+noexcept
+{
+	Meter::allocs.fetch_add(1,std::memory_order_relaxed);
+	return __libc_realloc(ptr,size);
+}
+
+
+static const std::vector<std::string> METRICS
+{
+	"instructions", "cycles", "allocs", "ns", "rss_kb"
+};
+
+static const std::set<std::string> GATED                // the rest are informational
+{
+	"instructions", "allocs"
+};
+
+static const std::map<std::string,double> THRESHOLDS     // percent, unless the baseline has its own
+{
+	{ "instructions",   2.0  },
+	{ "cycles",         10.0 },
+	{ "allocs",         1.0  },
+	{ "ns",             25.0 },
+	{ "rss_kb",         10.0 },
+};
+
+
+struct Result
+{
+	std::string name;
+	size_t items;
+	size_t errors;                                    // lines whose handlers threw
+	std::map<std::string,double> metrics;             // per item, except rss_kb
+};
+
+
+/**
+ * The scenario calls meter.start() and meter.stop() around the work to count
+ * and returns how many items it did. Of the passes, the least of each metric
+ * is kept, being the one least disturbed.
+ */
+using Scenario = std::function<size_t (Meter &meter, size_t &errors)>;
+
+static
+Result run(const std::string &name,
+           const size_t &passes,
+           const Scenario &func)
+{
+	Result ret {name,0,0,{}};
+	Meter meter;
+	for(size_t i(0); i < passes; i++)
+	{
+		size_t errors(0);
+		const size_t items(func(meter,errors));
+		const auto &s(meter.get());
+		const auto rss(Meter::rss_kb());
+		const auto n(double(std::max(items,size_t(1))));
+
+		std::map<std::string,double> m;
+		m["allocs"] = s.allocs / n;
+		m["ns"] = s.elapsed.count() / n;
+		if(s.counted)
+		{
+			m["instructions"] = s.instructions / n;
+			m["cycles"] = s.cycles / n;
+		}
+
+		for(const auto &p : m)
+			if(!i || p.second < ret.metrics[p.first])
+				ret.metrics[p.first] = p.second;
+
+		ret.metrics["rss_kb"] = std::max(ret.metrics["rss_kb"],double(rss));
+		ret.items = items;
+		ret.errors = std::max(ret.errors,errors);
+	}
+
+	std::cerr << std::setw(12) << std::left << name
+	          << std::setw(8) << std::right << ret.items << " items";
+	for(const auto &metric : METRICS)
+		if(ret.metrics.count(metric))
+			std::cerr << std::setw(14) << std::right << std::fixed << std::setprecision(1)
+			          << ret.metrics.at(metric) << " " << metric;
+
+	std::cerr << (ret.errors? " (" + lex_cast(ret.errors) + " errors)" : std::string{}) << std::endl;
+	return ret;
+}
+
+
+static
+Replay lines(const std::function<void (std::ostream &)> &func)
+{
+	std::stringstream s;
+	func(s);
+	return Replay(s);
+}
+
+
+static
+Opts bot_opts()
+{
+	Opts ret;
+	ret["nick"] = "ircbot";
+	ret["throttle-msg"] = "0";
+	ret["target-max"] = "0";
+	ret["sendq-max"] = "0";
+	return ret;
+}
+
+
+/**
+ * A Bot welcomed and in #perf; the setup is replayed before the meter starts.
+ */
+static
+size_t replay(Meter &meter,
+              size_t &errors,
+              const Replay &setup,
+              const Replay &work)
+{
+	Bot bot(bot_opts());
+	const std::lock_guard<Bot> lock(bot);
+	setup(bot);
+
+	meter.start();
+	const auto res(work(bot));
+	meter.stop();
+
+	errors += res.errors;
+	return res.lines;
+}
+
+
+static
+void welcome(std::ostream &s)
+{
+	s << "0 :irc.example.net 001 ircbot :Welcome to the network ircbot" << std::endl;
+	s << "0 :ircbot!~ircbot@bot.example.net JOIN #perf" << std::endl;
+}
+
+
+static
+Result netjoin(const size_t &passes)
+{
+	static constexpr size_t USERS = 5000;
+
+	const auto setup(lines(welcome));
+	const auto work(lines([](std::ostream &s)
+	{
+		for(size_t i(0); i < USERS; i++)
+			s << "0 :user" << i << "!~u" << i << "@host-" << (i % 997) << ".example.net JOIN #perf" << std::endl;
+	}));
+
+	return run("netjoin",passes,[&setup,&work](Meter &meter, size_t &errors)
+	{
+		return replay(meter,errors,setup,work);
+	});
+}
+
+
+static
+Result banlist(const size_t &passes)
+{
+	static constexpr size_t BANS = 5000;
+
+	const auto setup(lines(welcome));
+	const auto work(lines([](std::ostream &s)
+	{
+		for(size_t i(0); i < BANS; i++)
+			s << "0 :irc.example.net 367 ircbot #perf *!*@host-" << i << ".example.net"
+			  << " op!~op@staff.example.net " << (1444850000 + i) << std::endl;
+
+		s << "0 :irc.example.net 368 ircbot #perf :End of Channel Ban List" << std::endl;
+	}));
+
+	return run("banlist",passes,[&setup,&work](Meter &meter, size_t &errors)
+	{
+		return replay(meter,errors,setup,work);
+	});
+}
+
+
+static
+Result privmsg(const size_t &passes)
+{
+	static constexpr size_t USERS = 100;
+	static constexpr size_t MSGS = 10000;
+
+	const auto setup(lines([](std::ostream &s)
+	{
+		welcome(s);
+		for(size_t i(0); i < USERS; i++)
+			s << "0 :user" << i << "!~u" << i << "@host-" << i << ".example.net JOIN #perf" << std::endl;
+	}));
+
+	const auto work(lines([](std::ostream &s)
+	{
+		for(size_t i(0); i < MSGS; i++)
+			s << "0 :user" << (i % USERS) << "!~u" << (i % USERS) << "@host-" << (i % USERS) << ".example.net"
+			  << " PRIVMSG #perf :message " << i << " of the flood, \x02" << "bold\x02 and \x03" << "4red\x03 text" << std::endl;
+	}));
+
+	return run("privmsg",passes,[&setup,&work](Meter &meter, size_t &errors)
+	{
+		return replay(meter,errors,setup,work);
+	});
+}
+
+
+static
+void remove_dir(const std::string &path)
+{
+	if(DIR *const dir = ::opendir(path.c_str()))
+	{
+		while(const struct dirent *const ent = ::readdir(dir))
+			if(strcmp(ent->d_name,".") && strcmp(ent->d_name,".."))
+				::unlink((path + "/" + ent->d_name).c_str());
+
+		::closedir(dir);
+	}
+
+	::rmdir(path.c_str());
+}
+
+
+/**
+ * Cold reads are from an Adb opened for the pass, so nothing of leveldb's is
+ * cached in the process (the OS page cache still is); warm reads are the
+ * second pass over the same keys of one Adb.
+ */
+static
+std::vector<Result> adb(const size_t &passes)
+{
+	static constexpr size_t ACCTS = 2000;
+
+	char tmpl[] = "/tmp/ircbot-perf.XXXXXX";
+	if(!::mkdtemp(tmpl))
+		throw Assertive("Failed to make a scratch directory: ") << strerror(errno);
+
+	const std::string dir(tmpl);
+	const std::string path(dir + "/adb");
+	const scope cleanup([&dir,&path]
+	{
+		remove_dir(path);
+		remove_dir(dir);
+	});
+
+	const Adoc doc(R"({
+		"info":{"registered":"1325376000","last_addr":"~alice@gateway/web/freenode/ip.203.0.113.7","flags":"HIDEMAIL"},
+		"config":{"lang":"en","tz":"UTC","greet":"hello everyone"},
+		"seen":{"time":"1444852329","chan":"#ircbot","msg":"hello everyone, is the bot around?"}
+	})");
+
+	std::vector<std::string> names;
+	{
+		Adb adb(path);
+		for(size_t i(0); i < ACCTS; i++)
+		{
+			names.emplace_back("acct" + lex_cast(i));
+			adb.set(names.back(),doc);
+		}
+	}
+
+	const auto read([&names](const Adb &adb)
+	{
+		size_t ret(0);
+		for(const auto &name : names)
+			ret += adb.get(std::nothrow,name).size();
+
+		return ret;
+	});
+
+	std::vector<Result> ret;
+	ret.emplace_back(run("adb_cold",passes,[&path,&names,&read](Meter &meter, size_t &errors)
+	{
+		meter.start();
+		const Adb adb(path);
+		errors += read(adb) != names.size() * 3;
+		meter.stop();
+		return names.size();
+	}));
+
+	const Adb adb(path);
+	read(adb);
+	ret.emplace_back(run("adb_warm",passes,[&adb,&names,&read](Meter &meter, size_t &errors)
+	{
+		meter.start();
+		errors += read(adb) != names.size() * 3;
+		meter.stop();
+		return names.size();
+	}));
+
+	return ret;
+}
+
+
+static
+std::string render(const Result &res)
+{
+	std::stringstream s;
+	s << "{\"items\": " << res.items << ", \"errors\": " << res.errors;
+	for(const auto &p : res.metrics)
+		s << ", \"" << p.first << "\": " << std::fixed << std::setprecision(2) << p.second;
+
+	s << "}";
+	return s.str();
+}
+
+
+/**
+ * A result of the baseline, as it was recorded: its values are all numbers.
+ */
+static
+std::string render(const boost::property_tree::ptree &ent)
+{
+	std::stringstream s;
+	s << "{";
+	for(auto it(ent.begin()); it != ent.end(); ++it)
+		s << (it != ent.begin()? ", " : "") << "\"" << it->first << "\": " << it->second.data();
+
+	s << "}";
+	return s.str();
+}
+
+
+static
+void write_results(std::ostream &s,
+                   const std::map<std::string,double> &thresholds,
+                   const std::map<std::string,std::string> &results)
+{
+	s << "{" << std::endl;
+	s << "\t\"version\": \"" << IRCBOT_VERSION << "\"," << std::endl;
+	s << "\t\"thresholds\": {";
+	for(auto it(thresholds.begin()); it != thresholds.end(); ++it)
+		s << (it != thresholds.begin()? ", " : "") << "\"" << it->first << "\": " << it->second;
+
+	s << "}," << std::endl;
+	s << "\t\"results\": {" << std::endl;
+	for(auto it(results.begin()); it != results.end(); ++it)
+		s << "\t\t\"" << it->first << "\": " << it->second << (std::next(it) != results.end()? "," : "") << std::endl;
+
+	s << "\t}" << std::endl;
+	s << "}" << std::endl;
+}
+
+
+/**
+ * Returns the number of regressions, counting a scenario the baseline lacks.
+ */
+static
+size_t compare(const Adoc &baseline,
+               const std::map<std::string,double> &thresholds,
+               const std::vector<Result> &results)
+{
+	size_t ret(0);
+	const auto &base(baseline.get_child("results"));
+	for(const auto &res : results)
+	{
+		const auto it(base.find(res.name));
+		if(it == base.not_found())
+		{
+			std::cerr << res.name << ": MISSING from the baseline" << std::endl;
+			++ret;
+			continue;
+		}
+
+		for(const auto &metric : METRICS)
+		{
+			const auto b(it->second.get_optional<double>(metric));
+			const auto c(res.metrics.find(metric));
+			if(!b || c == res.metrics.end())
+			{
+				if(bool(b) != (c != res.metrics.end()))
+					std::cerr << res.name << "." << metric << ": not counted on both sides" << std::endl;
+
+				continue;
+			}
+
+			const double limit(thresholds.at(metric));
+			const double delta(*b > 0.0? (c->second - *b) * 100.0 / *b : 0.0);
+			const bool gated(GATED.count(metric));
+			const bool regressed(gated && delta > limit);
+			ret += regressed;
+
+			if(delta > limit || delta < -limit)
+				std::cerr << res.name << "." << metric << ": "
+				          << std::fixed << std::setprecision(2) << *b << " -> " << c->second
+				          << " (" << std::showpos << delta << std::noshowpos << "%, limit " << limit << "%) "
+				          << (regressed? "REGRESSED" : delta > limit? "grew (informational)" : "improved; consider updating the baseline")
+				          << std::endl;
+		}
+	}
+
+	return ret;
+}
+
+
+int main(int argc, char **argv)
+try
+{
+	Opts opts;
+	opts.clear();
+	opts["baseline"] = "bench/baseline.json";
+	opts["out"] = "perf.json";
+	opts["update"] = "false";
+	opts["passes"] = "5";
+	opts["filter"] = "";
+	opts.parse(std::vector<std::string>(argv + 1,argv + argc));
+
+	std::cout.setstate(std::ios::badbit);              // the bots' logging
+
+	Adoc baseline;
+	{
+		std::ifstream file(opts["baseline"]);
+		if(file.is_open())
+			baseline = Adoc(std::string(std::istreambuf_iterator<char>(file),std::istreambuf_iterator<char>()));
+	}
+
+	auto thresholds(THRESHOLDS);
+	for(auto &p : thresholds)
+		p.second = baseline.get("thresholds." + p.first,p.second);
+
+	if(!Meter().has_counters())
+		std::cerr << "perf_event_open() unavailable: instructions and cycles are not counted" << std::endl;
+
+	const auto passes(std::max(opts.get<size_t>("passes"),size_t(1)));
+	const auto &filter(opts["filter"]);
+	const auto wanted([&filter](const std::string &name)
+	{
+		return boost::starts_with(name,filter) || boost::starts_with(filter,name);
+	});
+
+	std::vector<Result> results;
+	if(wanted("netjoin"))
+		results.emplace_back(netjoin(passes));
+
+	if(wanted("banlist"))
+		results.emplace_back(banlist(passes));
+
+	if(wanted("privmsg"))
+		results.emplace_back(privmsg(passes));
+
+	if(wanted("adb"))
+		for(auto &res : adb(passes))
+			if(wanted(res.name))
+				results.emplace_back(std::move(res));
+
+	const bool update(opts.get<bool>("update"));
+	const auto base(baseline.get_child_optional("results"));
+	std::map<std::string,std::string> written;
+	if(update && base)
+		for(const auto &p : *base)
+			written[p.first] = render(p.second);
+
+	for(const auto &res : results)
+		written[res.name] = render(res);
+
+	std::ofstream file(update? opts["baseline"] : opts["out"]);
+	write_results(file,thresholds,written);
+	if(update)
+		return 0;
+
+	if(!base || base->empty())
+	{
+		std::cerr << opts["baseline"] << " has no results to compare; record them with --update" << std::endl;
+		return 2;
+	}
+
+	const size_t regressions(compare(baseline,thresholds,results));
+	if(regressions)
+		std::cerr << regressions << " regression(s) against " << opts["baseline"] << std::endl;
+
+	return regressions? 2 : 0;
+}
+catch(const std::exception &e)
+{
+	std::cerr << "perf: " << e.what() << std::endl;
+	return 1;
+}
@@ -0,0 +1,141 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Counters of one thread's work between start() and stop().
+ *
+ * Instructions and cycles are read from a perf_event_open() group in user
+ * space only; where that's refused (perf_event_paranoid, a container without
+ * the syscall, a VM without a PMU) they are reported as absent rather than
+ * zero. Allocations are counted by the malloc shim of perf.cpp, of every
+ * thread. Time is the wall clock.
+ */
+class Meter
+{
+	int group;                                        // leader fd; -1 when unavailable
+	int cycles_fd;
+
+	static int open(const uint32_t &config, const int &group);
+
+  public:
+	static std::atomic<size_t> allocs;                // perf.cpp; by the malloc shim
+
+	struct Sample
+	{
+		bool counted = false;                         // instructions and cycles are valid
+		uint64_t instructions = 0;
+		uint64_t cycles = 0;
+		size_t allocs = 0;
+		std::chrono::nanoseconds elapsed {0};
+	};
+
+  private:
+	Sample cur;
+	size_t allocs_start;
+	time_point start_time;
+
+  public:
+	bool has_counters() const                         { return group >= 0;                         }
+	const Sample &get() const                         { return cur;                                }
+
+	void start();
+	void stop();
+
+	static size_t rss_kb();                           // resident now
+
+	Meter();
+	Meter(Meter &&) = delete;
+	Meter(const Meter &) = delete;
+	~Meter() noexcept;
+};
+
+
+inline
+Meter::Meter():
+group(open(PERF_COUNT_HW_INSTRUCTIONS,-1)),
+cycles_fd(group >= 0? open(PERF_COUNT_HW_CPU_CYCLES,group) : -1),
+allocs_start(0)
+{
+	if(group >= 0 && cycles_fd < 0)
+	{
+		::close(group);
+		group = -1;
+	}
+}
+
+
+inline
+Meter::~Meter()
+noexcept
+{
+	if(cycles_fd >= 0)
+		::close(cycles_fd);
+
+	if(group >= 0)
+		::close(group);
+}
+
+
+inline
+int Meter::open(const uint32_t &config,
+                const int &group)
+{
+	struct perf_event_attr attr {};
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = group < 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+	return ::syscall(__NR_perf_event_open,&attr,0,-1,group,0);
+}
+
+
+inline
+void Meter::start()
+{
+	cur = {};
+	if(group >= 0)
+	{
+		::ioctl(group,PERF_EVENT_IOC_RESET,PERF_IOC_FLAG_GROUP);
+		::ioctl(group,PERF_EVENT_IOC_ENABLE,PERF_IOC_FLAG_GROUP);
+	}
+
+	allocs_start = allocs.load(std::memory_order_relaxed);
+	start_time = steady_clock::now();
+}
+
+
+inline
+void Meter::stop()
+{
+	cur.elapsed = steady_clock::now() - start_time;
+	cur.allocs = allocs.load(std::memory_order_relaxed) - allocs_start;
+	if(group < 0)
+		return;
+
+	::ioctl(group,PERF_EVENT_IOC_DISABLE,PERF_IOC_FLAG_GROUP);
+	uint64_t buf[3];                                  // nr, instructions, cycles
+	if(::read(group,buf,sizeof(buf)) != sizeof(buf) || buf[0] != 2)
+		return;
+
+	cur.counted = true;
+	cur.instructions = buf[1];
+	cur.cycles = buf[2];
+}
+
+
+inline
+size_t Meter::rss_kb()
+{
+	std::ifstream statm("/proc/self/statm");
+	size_t size(0), resident(0);
+	statm >> size >> resident;
+	return resident * (::sysconf(_SC_PAGESIZE) / 1024);
+}
@@ -14,12 +14,38 @@ using namespace irc::bot;
 // irc::bot:: library extern base
 std::locale irc::bot::locale;                               // util.h
 thread_local std::ostringstream irc::bot::Stream::sbuf;     // stream.h
-thread_local Adb *irc::bot::adb;
-thread_local Sess *irc::bot::sess;
-thread_local Users *irc::bot::users;
-thread_local Chans *irc::bot::chans;
-thread_local Service *irc::bot::nickserv;
-thread_local Service *irc::bot::chanserv;
+thread_local std::string irc::bot::Adoc::buf;               // adoc.h
+std::mutex irc::bot::Shards::mutex;                         // shards.h
+std::map<std::string,std::weak_ptr<Shards>> irc::bot::Shards::opened;
+std::mutex irc::bot::Resolver::mutex;                       // resolver.h
+std::map<std::string,Resolver::Entry> irc::bot::Resolver::cache;
+std::mutex irc::bot::Admission::mutex;                      // admission.h
+std::map<std::string,Admission::Bucket> irc::bot::Admission::buckets;
+std::mutex irc::bot::Intern::mutex;                         // intern.h
+std::map<boost::string_ref,std::weak_ptr<const std::string>> irc::bot::Intern::pool;
+std::mutex irc::bot::Metrics::mutex;                        // metrics.h
+std::vector<Metrics::Series> irc::bot::Metrics::series;
+std::map<std::string,size_t> irc::bot::Metrics::ids;
+std::list<Metrics::Shard> irc::bot::Metrics::shards;
+std::map<std::string,std::pair<std::string,Metrics::Gauge>> irc::bot::Metrics::gauges;
+thread_local Metrics::Shard *irc::bot::Metrics::local;
+std::unique_ptr<Metrics::Exporter> irc::bot::Metrics::exporter;
+std::mutex irc::bot::Trace::mutex;                          // trace.h
+std::deque<Trace::Span> irc::bot::Trace::spans;
+size_t irc::bot::Trace::max;
+std::atomic<bool> irc::bot::Trace::enabled;
+std::atomic<uint64_t> irc::bot::Trace::ids;
+thread_local Trace::Ctx irc::bot::Trace::current;
+std::mutex irc::bot::Profile::mutex;                        // profile.h
+std::unique_ptr<Profile::Sample[]> irc::bot::Profile::ring;
+std::atomic<size_t> irc::bot::Profile::head;
+std::atomic<size_t> irc::bot::Profile::dropped;
+std::map<std::string,size_t> irc::bot::Profile::stacks;
+std::unordered_map<void *,std::string> irc::bot::Profile::syms;
+std::atomic<size_t> irc::bot::Profile::hz;
+thread_local const Profile::Tag *irc::bot::Profile::current __attribute__((tls_model("initial-exec")));
+thread_local Arena irc::bot::Arena::local;                  // arena.h
+thread_local const Context *irc::bot::ctx;
 
 
 Bot::Bot(const Opts &opts,
@@ -28,24 +54,51 @@ try:
 opts(opts),
 adb([&]
 {
+	if(this->opts.has("dbsnap"))
+		return Adb{Adb::snapshot,this->opts["dbsnap"]};
+
 	if(!this->opts.get<bool>("database"))
-		return std::string{};
+		return Adb{std::string{}};
 
 	mkdir(this->opts["dbdir"].c_str(),0777);
-	return this->opts["dbdir"] + "/ircbot";
+	return Adb{this->opts["dbdir"] + "/ircbot",this->opts.get<size_t>("dbshards")};
+}()),
+worker([&]() -> exec::Worker *
+{
+	if(ios || !this->opts.get<bool>("pinned"))
+		return nullptr;
+
+	exec::min_workers(this->opts.get<size_t>("threads"));
+	const auto &id(this->opts["nick"] + "@" + this->opts["host"] + ":" + this->opts["port"]);
+	return &exec::pin(hash(id),this->opts.get<size_t>("steal"));
 }()),
 sess(this->opts,
      static_cast<std::mutex &>(*this),
-     ios? *ios : recvq::ios),
-ns(users,chans,events),
-cs(chans)
+     ios? *ios : worker? worker->ios : recvq::ios),
+users(&mem),
+chans(context,&mem),
+ns(context,users,chans,events),
+cs(context,chans),
+resume(this->opts["resume-file"]),
+fetchq(sess.get_ios()),
+pending(sess.get_ios(),milliseconds(this->opts.get<uint>("request-timeout"))),
+capture(this->opts["capture-file"]),
+admin(sess.get_ios(),this->opts["admin-socket"]),
+context{&adb,&sess,&users,&chans,&ns,&cs,&pending}
 {
 	namespace ph = std::placeholders;
 
+	// The socket ecb comes from the sendq thread; a pinned session takes it on its own thread.
 	auto &sock(sess.get_socket());
-	sock.set_ecb(std::bind(&Bot::handle_socket_ecb,this,ph::_1));
+	const auto ecb(std::bind(&Bot::handle_socket_ecb,this,ph::_1));
+	sock.set_ecb(worker? sendq::ECb(sess.wrap(ecb)) : sendq::ECb(ecb));
+	pending.set_handler(std::bind(&Bot::handle_pending,this,ph::_1));
+	ns.attach(&mem);
+	cs.attach(&mem);
 	init_state_handlers();
 	init_irc_handlers();
+	init_metrics();
+	set_admin();
 	set_tls_context();
 
 	if(this->opts.get<bool>("connect"))
@@ -57,6 +110,78 @@ catch(const Internal &e)
 }
 
 
+Bot::~Bot()
+noexcept
+{
+	if(worker)
+		exec::unpin(*worker);
+}
+
+
+std::unique_lock<Bot> Bot::event_lock()
+{
+	// A pinned session's events all run on its worker thread, one at a time.
+	if(worker)
+		return std::unique_lock<Bot>{*this,std::defer_lock};
+
+	return std::unique_lock<Bot>{*this};
+}
+
+
+/**
+ * The gauges are of the process; every Bot may name the same export paths.
+ * The trace-file is rewritten with the metrics-file's interval. The profile-file
+ * has its own, short enough to drain the sample ring before it fills.
+ */
+void Bot::init_metrics()
+{
+	static std::once_flag gauges_once;
+	std::call_once(gauges_once,[]
+	{
+		Metrics::gauge("ircbot_sendq_lines","Lines queued in the sendq.",[]
+		{
+			return sendq::size();
+		});
+
+		Metrics::gauge("ircbot_exec_workers","Threads running pinned sessions.",[]
+		{
+			return exec::num_workers();
+		});
+
+		Metrics::gauge("ircbot_interned_strings","Strings in the Intern pool.",[]
+		{
+			return Intern::size();
+		});
+	});
+
+	if(opts.has("metrics-file"))
+		Metrics::dump(opts["metrics-file"],milliseconds(opts.get<uint>("metrics-interval")));
+
+	if(opts.has("metrics-socket"))
+		Metrics::serve(opts["metrics-socket"]);
+
+	if(opts.has("trace-file"))
+	{
+		const auto path(opts["trace-file"]);
+		Trace::enable(opts.get<size_t>("trace-max"));
+		Metrics::every(path,milliseconds(opts.get<uint>("metrics-interval")),[path]
+		{
+			Trace::dump(path);
+		});
+	}
+
+	if(opts.has("profile-file"))
+	{
+		const auto path(opts["profile-file"]);
+		Profile::enable(opts.get<size_t>("profile-hz"));
+		Metrics::every(path,milliseconds(opts.get<uint>("profile-interval")),[path]
+		{
+			Profile::dump(path);
+		});
+	}
+}
+
+
 void Bot::init_state_handlers()
 {
 	namespace ph = std::placeholders;
@@ -64,12 +189,14 @@ void Bot::init_state_handlers()
 	#define ENTER(name,func) \
 		events.state.add(name,std::bind(&Bot::func,this,ph::_1),    \
 		                 handler::RECURRING,                        \
-		                 handler::Prio::LIB);
+		                 handler::Prio::LIB,                        \
+		                 #func);
 
 	#define LEAVE(name,func) \
 		events.state_leave.add(name,std::bind(&Bot::func,this,ph::_1),     \
 		                       handler::RECURRING,                         \
-		                       handler::Prio::LIB);
+		                       handler::Prio::LIB,                         \
+		                       #func);
 
 	ENTER(State::FAULT, enter_state_fault)
 	ENTER(State::CONNECTING, enter_state_connecting)
@@ -104,7 +231,8 @@ void Bot::init_irc_handlers()
 	#define EVENT(name,func) \
 		events.msg.add(name,std::bind(&Bot::func,this,ph::_1),     \
 		               handler::RECURRING,                         \
-		               handler::Prio::LIB);
+		               handler::Prio::LIB,                         \
+		               #func);
 
 	EVENT( handler::MISS, handle_unhandled)
 
@@ -152,6 +280,9 @@ void Bot::init_irc_handlers()
 	EVENT( RPL_NOTOPIC, handle_notopic)
 	EVENT( RPL_TOPICWHOTIME, handle_topicwhotime)
 	EVENT( RPL_CREATIONTIME, handle_creationtime)
+	EVENT( RPL_ENDOFBANLIST, handle_endofbanlist)
+	EVENT( RPL_ENDOFQUIETLIST, handle_endofquietlist)
+	EVENT( RPL_ENDOFWHO, handle_endofwho)
 	EVENT( RPL_HOSTHIDDEN, handle_hosthidden)
 	EVENT( RPL_BANLIST, handle_banlist)
 	EVENT( RPL_INVITELIST, handle_invitelist)
@@ -187,17 +318,53 @@ void Bot::init_irc_handlers()
 }
 
 
+/**
+ * The Msg's trace is current while its handlers run, so what they send is
+ * attributed to it (see: trace.h).
+ */
+void Bot::operator()(const Msg &msg)
+{
+	const auto &trace(msg.get_trace());
+	const Trace::Scope scope(trace);
+	const auto start(trace.id? steady_clock::now() : time_point{});
+	events.msg(msg);
+	pending(msg);
+
+	if(trace.id)
+		Trace::span(trace,"dispatch",msg.get_name(),start,steady_clock::now());
+}
+
+
+void Bot::operator()(const std::string &line)
+{
+	const Arena::Scope scope;
+	const auto trace(Trace::begin());
+	Msg msg(line,scope.arena);
+	if(trace.id)
+	{
+		msg.set_trace(trace);
+		Trace::span(trace,"parse",msg.get_name(),trace.recv,steady_clock::now());
+	}
+
+	operator()(msg);
+}
+
+
 void Bot::operator()(const Loop &loop)
 try
 {
 	switch(loop)
 	{
 		case FOREGROUND:
-			recvq::worker();
+			if(worker)
+				exec::join();
+			else
+				recvq::worker();
 			break;
 
 		case BACKGROUND:
-			recvq::min_threads(opts.get<size_t>("threads"));
+			if(!worker)
+				recvq::min_threads(opts.get<size_t>("threads"));
 			break;
 	}
 }
@@ -217,7 +384,7 @@ void Bot::quit()
 	sess.post([this]
 	{
 		if(sess.is(State::ACTIVE) && sess.has_opt("quit") && opts["quit"] != "hard")
-			Quote("QUIT") << " :" << opts["quit-msg"];
+			Quote(context,"QUIT") << " :" << opts["quit-msg"];
 		else
 			disconnect();
 	});
@@ -226,12 +393,32 @@ void Bot::quit()
 
 void Bot::connect()
 {
-	state(State::CONNECTING);
+	// Every session connecting to this destination draws from one bucket.
+	const auto &sock(sess.get_socket());
+	const milliseconds interval(opts.get<int64_t>("connect-interval"));
+	const auto delay(Admission::admit(sock.get_dest(),interval,opts.get<size_t>("connect-burst")));
+	if(delay == 0ms)
+	{
+		state(State::CONNECTING);
+		return;
+	}
+
+	sess.post([this,delay]
+	{
+		set_retry(delay,true);
+	});
 }
 
 
 void Bot::disconnect()
 {
+	boost::system::error_code ec;
+	if(sess.get_retry().cancel(ec) && sess.is(State::FAULT))
+	{
+		state(State::INACTIVE);
+		return;
+	}
+
 	if(sess.is(State::INACTIVE) || !sess.is(Flag::CONNECTED))
 		return;
 
@@ -242,6 +429,46 @@ void Bot::disconnect()
 }
 
 
+/**
+ * Stop everything which would call back into this instance, so it can be
+ * destroyed once the handlers already aborted have run. Nothing is sent.
+ */
+void Bot::halt()
+{
+	boost::system::error_code ec;
+	sess.get_retry().cancel(ec);
+	cancel_timer(true);
+
+	auto &sock(sess.get_socket());
+	sock.disconnect(false);
+	sock.purge();
+
+	fetchq.clear();
+	pending.cancel();
+	admin.close();
+	ns.clear_queue();
+	cs.clear_queue();
+
+	if(!sess.is(State::INACTIVE))
+		state(State::INACTIVE);
+}
+
+
+Stats Bot::stats()
+const
+{
+	return Stats(*this);
+}
+
+
+void Bot::set_admin()
+{
+	namespace ph = std::placeholders;
+
+	admin.accept(sess.wrap(std::bind(&Bot::handle_admin,this,ph::_1,ph::_2)));
+}
+
+
 void Bot::set_timeout()
 {
 	const auto timeout(opts.get<int64_t>("timeout"));
@@ -262,6 +489,17 @@ void Bot::set_timer(const milliseconds &ms)
 }
 
 
+void Bot::set_retry(const milliseconds &ms,
+                    const bool &admitted)
+{
+	namespace ph = std::placeholders;
+
+	auto &retry(sess.get_retry());
+	retry.expires_from_now(ms);
+	retry.async_wait(std::bind(&Bot::handle_retry,this,ph::_1,admitted));
+}
+
+
 bool Bot::cancel_timer(const bool &all)
 {
 	boost::system::error_code ec;
@@ -303,7 +541,7 @@ void Bot::set_handle(const std::shared_ptr<boost::asio::streambuf> buf)
 
 void Bot::handle_socket_ecb(const boost::system::error_code &e)
 {
-	const std::lock_guard<Bot> lock(*this);
+	const auto lock(event_lock());
 	set_tls_context();
 	auto &sock(sess.get_socket());
 	sess.set_current_exception();
@@ -317,13 +555,62 @@ void Bot::handle_timeout(const boost::system::error_code &e)
 	if(e == boost::asio::error::operation_aborted)
 		return;
 
-	const std::lock_guard<Bot> lock(*this);
+	const auto lock(event_lock());
 	set_tls_context();
 	sess.set(Flag::TIMEOUT);
 	state(State::FAULT);
 }
 
 
+void Bot::handle_retry(const boost::system::error_code &e,
+                       const bool admitted)
+{
+	if(e == boost::asio::error::operation_aborted)
+		return;
+
+	const auto lock(event_lock());
+	set_tls_context();
+	if(admitted)
+		state(State::CONNECTING);
+	else
+		connect();
+}
+
+
+void Bot::handle_fetch(const boost::system::error_code &e)
+{
+	if(e == boost::asio::error::operation_aborted)
+		return;
+
+	const auto lock(event_lock());
+	set_tls_context();
+	fetchq.disarm();
+
+	// One line per throttle-join; jobs for channels we've since left are dropped
+	bool sent(false);
+	while(!sent && !fetchq.empty())
+	{
+		const auto job(fetchq.take());
+		if(chans.has(job.chan) && chans.get(job.chan).is_joined())
+			sent = fetch(chans.get(job.chan),job.part);
+	}
+
+	if(!fetchq.empty())
+		set_fetch(milliseconds(opts.get<uint>("throttle-join")));
+}
+
+
+void Bot::handle_pending(const boost::system::error_code &e)
+{
+	if(e == boost::asio::error::operation_aborted)
+		return;
+
+	const auto lock(event_lock());
+	set_tls_context();
+	pending.expire();
+}
+
+
 void Bot::handle_conn(const boost::system::error_code &e)
 {
 	if(e)
@@ -331,16 +618,21 @@ void Bot::handle_conn(const boost::system::error_code &e)
 		if(e == boost::asio::error::operation_aborted)
 			return;
 
-		const std::lock_guard<Bot> lock(*this);
+		const auto lock(event_lock());
 		set_tls_context();
+		Admission::failure(sess.get_socket().get_dest());
 		sess.set_exception(boost::system::system_error(e));
 		sess.set(Flag::SOCKERR);
 		state(State::FAULT);
 		return;
 	}
 
-	const std::lock_guard<Bot> lock(*this);
+	static const auto connects(Metrics::id("ircbot_connects_total","Connections established.",Metrics::COUNTER));
+
+	const auto lock(event_lock());
 	set_tls_context();
+	Admission::success(sess.get_socket().get_dest());
+	Metrics::count(connects);
 	sess.set(Flag::CONNECTED);
 	set_timeout();
 	new_handle();
@@ -348,6 +640,33 @@ void Bot::handle_conn(const boost::system::error_code &e)
 }
 
 
+void Bot::handle_admin(const boost::system::error_code &e,
+                       const Admin::Sd &sd)
+{
+	namespace ph = std::placeholders;
+
+	if(e == boost::asio::error::operation_aborted)
+		return;
+
+	if(e)
+	{
+		std::cerr << "\033[1;31m[admin]: accept: " << e.message() << "\033[0m" << std::endl;
+		admin.retry(sess.wrap(std::bind(&Bot::handle_admin,this,ph::_1,ph::_2)));
+		return;
+	}
+
+	{
+		const auto lock(event_lock());
+		set_tls_context();
+		std::ostringstream s;
+		stats().write(s);
+		Admin::reply(sd,s.str());
+	}
+
+	set_admin();
+}
+
+
 void Bot::handle_pck(const boost::system::error_code &e,
                      const size_t size,
                      const std::shared_ptr<boost::asio::streambuf> buf)
@@ -357,7 +676,7 @@ void Bot::handle_pck(const boost::system::error_code &e,
 		if(e == boost::asio::error::operation_aborted)
 			return;
 
-		const std::lock_guard<Bot> lock(*this);
+		const auto lock(event_lock());
 		set_tls_context();
 		sess.set_exception(boost::system::system_error(e));
 		sess.set(Flag::SOCKERR);
@@ -369,11 +688,23 @@ void Bot::handle_pck(const boost::system::error_code &e,
 		return;
 
 	{
-		const std::lock_guard<Bot> lock(*this);
+		const auto lock(event_lock());
 		set_tls_context();
-		std::istream stream(buf.get());
-		const Msg msg(stream);
-		events.msg(msg);
+		if(capture.is_open())
+			capture(boost::asio::buffer_cast<const char *>(buf->data()),size);
+
+		const Arena::Scope scope;
+		const auto trace(Trace::begin());
+		const boost::string_ref line(boost::asio::buffer_cast<const char *>(buf->data()),size);
+		Msg msg(line,scope.arena);
+		buf->consume(size);
+		if(trace.id)
+		{
+			msg.set_trace(trace);
+			Trace::span(trace,"parse",msg.get_name(),trace.recv,steady_clock::now());
+		}
+
+		operator()(msg);
 		set_timeout();
 	}
 
@@ -381,14 +712,138 @@ void Bot::handle_pck(const boost::system::error_code &e,
 }
 
 
+/**
+ * A part is queued unless it was completed within chan-fresh seconds. WHO is
+ * always queued; whether it's needed is decided when it's sent.
+ */
+void Bot::fetch(Chan &chan)
+{
+	const auto ttl(opts.get<time_t>("chan-fresh"));
+	const auto prio(fetch_prio(chan));
+	const auto add([this,&chan,&prio]
+	(const Fetch::Part &part)
+	{
+		fetchq.add(chan.get_name(),part,prio);
+	});
+
+	if(opts.get<bool>("chan-fetch-mode") && !chan.is_fresh("mode",ttl))
+		add(Fetch::MODE);
+
+	if(opts.get<bool>("chan-fetch-who"))
+		add(Fetch::WHO);
+
+	if(opts.get<bool>("chan-fetch-info") && opts.get<bool>("services") && !chan.is_fresh("info",ttl))
+		add(Fetch::INFO);
+
+	if(opts.get<bool>("chan-fetch-lists"))
+	{
+		if(!chan.is_fresh("bans",ttl))
+			add(Fetch::BANS);
+
+		if(!chan.is_fresh("quiets",ttl))
+			add(Fetch::QUIETS);
+
+		if(opts.get<bool>("services") && !chan.is_fresh("access",ttl))
+			add(Fetch::ACCESS);
+	}
+
+	set_fetch(0ms);
+}
+
+
+/**
+ * The lists refetched are emptied first, since the replies only add entries.
+ * A WHO is skipped when every member was in a WHO reply within chan-fresh
+ * (e.g from a channel they share with us); otherwise the other channels with
+ * a WHO queued go on the same line, as many as TARGMAX allows.
+ */
+bool Bot::fetch(Chan &chan,
+                const Fetch::Part &part)
+{
+	// Until NAMES completes users may hold only ourself, who is already fresh
+	const auto ttl(opts.get<time_t>("chan-fresh"));
+	const auto stale([&ttl](const Chan &chan)
+	{
+		if(!chan.is_named())
+			return true;
+
+		bool ret(false);
+		chan.users.for_each([&ttl,&ret]
+		(const User &user)
+		{
+			ret |= !user.is_fresh(ttl);
+		});
+
+		return ret;
+	});
+
+	switch(part)
+	{
+		case Fetch::MODE:     chan.mode();                                 return true;
+		case Fetch::INFO:     chan.csinfo();                               return true;
+		case Fetch::ACCESS:   chan.accesslist();                           return true;
+		case Fetch::BANS:     chan.lists.bans.clear();    chan.banlist();   return true;
+		case Fetch::QUIETS:   chan.lists.quiets.clear();  chan.quietlist(); return true;
+		case Fetch::WHO:      break;
+	}
+
+	std::vector<std::string> targets;
+	const auto max(Fetch::targmax(sess.get_isupport(),"WHO"));
+	size_t len(0);
+	for(auto next(std::vector<std::string>{chan.get_name()}); !next.empty(); next = fetchq.take(Fetch::WHO,1))
+	{
+		if(!chans.has(next.front()))
+			continue;
+
+		Chan &target(chans.get(next.front()));
+		if(!target.is_joined())
+			continue;
+
+		if(!stale(target))
+		{
+			target.set_fresh("who");
+			continue;
+		}
+
+		targets.emplace_back(target.get_name());
+		len += target.get_name().size() + 1;
+		if(targets.size() >= max || len > 384)
+			break;
+	}
+
+	if(targets.empty())
+		return false;
+
+	Quote(context,"WHO") << boost::algorithm::join(targets,",") << " " << std::string{User::WHO_FORMAT};
+	return true;
+}
+
+
+size_t Bot::fetch_prio(const Chan &chan)
+const
+{
+	size_t ret(0);
+	for(const auto &name : opts.autojoin)
+		if(iequals(name,chan.get_name()))
+			return ret;
+		else
+			++ret;
+
+	return ret;
+}
+
+
+void Bot::set_fetch(const milliseconds &ms)
+{
+	namespace ph = std::placeholders;
+
+	fetchq.arm(ms,std::bind(&Bot::handle_fetch,this,ph::_1));
+}
+
+
 void Bot::set_tls_context()
 {
-	bot::adb       = &this->adb;
-	bot::sess      = &this->sess;
-	bot::users     = &this->users;
-	bot::chans     = &this->chans;
-	bot::nickserv  = &this->ns;
-	bot::chanserv  = &this->cs;
+	bot::ctx = &this->context;
 }
 
 
@@ -399,16 +854,18 @@ void Bot::enter_state_connecting(const State &st)
 	log(st,"Entered CONNECTING");
 
 	auto &sock(sess.get_socket());
-	auto &ep(sock.get_ep());
-	auto &sd(sock.get_sd());
 	set_timeout();
-	sd.async_connect(ep,std::bind(&Bot::handle_conn,this,ph::_1));
+	sock.async_connect(sess.wrap(std::bind(&Bot::handle_conn,this,ph::_1)));
 }
 
 
 void Bot::enter_state_fault(const State &st)
 {
+	static const auto faults(Metrics::id("ircbot_faults_total","Sessions entering FAULT.",Metrics::COUNTER));
+	static const auto reconnects(Metrics::id("ircbot_reconnects_total","Reconnects scheduled after a fault.",Metrics::COUNTER));
+
 	log(st,"Entered FAULT");
+	Metrics::count(faults);
 
 	auto &sock(sess.get_socket());
 	cancel_timer(true);
@@ -417,8 +874,32 @@ void Bot::enter_state_fault(const State &st)
 	sock.purge();
 	sess.unset(Flag::ALL);
 
-	if(opts.get<bool>("reconnect"))
-		connect();
+	// Nothing asked of the server or services will be answered now.
+	pending.cancel();
+	ns.clear_capture();
+	ns.clear_queue();
+	cs.clear_capture();
+	cs.clear_queue();
+
+	// Keep what each channel holds for the rejoin; who is in it must be relearned.
+	fetchq.clear();
+	resume.save(chans);
+	chans.for_each([](Chan &chan)
+	{
+		chan.set_joined(false);
+		chan.set_resumed(false);
+		chan.users.clear();
+	});
+	users.clear();
+
+	if(!opts.get<bool>("reconnect"))
+		return;
+
+	auto &backoff(sess.get_backoff());
+	const auto delay(backoff.next());
+	log(st,"Reconnecting in " + lex_cast(delay.count()) + "ms (attempt " + lex_cast(backoff.get_attempts()) + ")");
+	Metrics::count(reconnects);
+	set_retry(delay,false);
 }
 
 
@@ -439,7 +920,7 @@ void Bot::enter_state_proxying(const State &st)
 
 	events.msg.add("HTTP/1.0",std::bind(&Bot::handle_http,this,ph::_1),flag_t(0),handler::Prio::LIB);
 	events.msg.add("HTTP/1.1",std::bind(&Bot::handle_http,this,ph::_1),flag_t(0),handler::Prio::LIB);
-	Quote("CONNECT") << opts["host"] << ":" << opts["port"] << " HTTP/1.0\r\n";
+	Quote(context,"CONNECT") << opts["host"] << ":" << opts["port"] << " HTTP/1.0\r\n";
 }
 
 
@@ -447,7 +928,7 @@ void Bot::enter_state_negotiating(const State &st)
 {
 	log(st,"Entered NEGOTIATING; Negotiating capabilities...");
 
-	Quote("CAP") << "LS";
+	Quote(context,"CAP") << "LS";
 }
 
 
@@ -456,7 +937,7 @@ void Bot::leave_state_negotiating(const State &st)
 	log(st,"Leaving NEGOTIATING");
 
 	if(sess.is(Flag::NEGOTIATED))
-		Quote("CAP") << "END";
+		Quote(context,"CAP") << "END";
 }
 
 
@@ -467,9 +948,9 @@ void Bot::enter_state_registering(const State &st)
 	const auto &username(opts.has("user")? opts["user"] : "nobody");
 	const auto &gecos(opts.has("gecos")? opts["gecos"] : "nowhere");
 
-	const Cork cork;
-	Quote("NICK") << sess.get_nick();
-	Quote("USER") << username << " unknown unknown :" << gecos;
+	const Cork cork(context);
+	Quote(context,"NICK") << sess.get_nick();
+	Quote(context,"USER") << username << " unknown unknown :" << gecos;
 }
 
 
@@ -486,6 +967,8 @@ void Bot::enter_state_active(const State &st)
 {
 	log(st,"Entered ACTIVE");
 
+	sess.get_backoff().reset();
+
 	std::stringstream modes;
 	if(opts.has("as-a-service"))
 		modes << "+Q";
@@ -494,7 +977,7 @@ void Bot::enter_state_active(const State &st)
 		modes << opts["umode"];
 
 	if(!modes.str().empty())
-		Quote("MODE") << sess.get_nick() << " " << modes.str();
+		Quote(context,"MODE") << sess.get_nick() << " " << modes.str();
 
 	if(!opts.get<bool>("cloaked"))
 		chans.autojoin();
@@ -540,7 +1023,7 @@ void Bot::handle_ping(const Msg &msg)
 
 	log(msg,"PING");
 
-	Quote("PONG") << msg[SOURCE];
+	Quote(context,"PONG") << msg[SOURCE];
 }
 
 
@@ -626,7 +1109,7 @@ void Bot::handle_cap(const Msg &msg)
 			server.caps.insert(caps.begin(),caps.end());
 
 			if(sess.is(State::NEGOTIATING))
-				Quote("CAP") << "REQ :account-notify extended-join multi-prefix";
+				Quote(context,"CAP") << "REQ :account-notify extended-join multi-prefix";
 
 			break;
 
@@ -742,27 +1225,18 @@ void Bot::handle_join(const Msg &msg)
 	if(msg.get_nick() == sess.get_nick())
 	{
 		// We have joined
-		const Opts &opts(sess.get_opts());
-		const FloodGuard guard(opts.get<uint>("throttle-join"));
 		chan.set_joined(true);
+		if(chan.get_fresh().empty())
+			resume.restore(chan);
 
-		if(opts.get<bool>("chan-fetch-mode"))
-			chan.mode();
-
-		if(opts.get<bool>("chan-fetch-who"))
-			chan.who();
-
-		if(opts.get<bool>("chan-fetch-info") && opts.get<bool>("services"))
-			chan.csinfo();
-
-		if(opts.get<bool>("chan-fetch-lists"))
+		// State from before is only trusted once RPL_CREATIONTIME matches it
+		if(!chan.get_fresh().empty() && opts.get<bool>("chan-fetch-mode"))
 		{
-			chan.banlist();
-			chan.quietlist();
-
-			if(opts.get<bool>("services"))
-				chan.accesslist();
+			chan.set_resumed(true);
+			fetchq.add(chan.get_name(),Fetch::MODE,fetch_prio(chan));
+			set_fetch(0ms);
 		}
+		else fetch(chan);
 	}
 
 	events.chan_user(msg,chan,user);
@@ -954,11 +1428,56 @@ void Bot::handle_creationtime(const Msg &msg)
 	log(msg,"CREATION TIME");
 
 	Chan &chan(chans.get(msg[CHANNAME]));
-	chan.set_creation(msg.get<time_t>(TIME));
+	const auto creation(msg.get<time_t>(TIME));
+	if(chan.get_creation() && chan.get_creation() != creation)
+		chan.set_fresh(chan::Fresh{});
+
+	chan.set_creation(creation);
+	chan.set_fresh("mode");
+	if(chan.is_resumed())
+	{
+		chan.set_resumed(false);
+		fetch(chan);
+	}
+
 	events.chan(msg,chan);
 }
 
 
+void Bot::handle_endofbanlist(const Msg &msg)
+{
+	using namespace fmt::ENDOFBANLIST;
+
+	log(msg,"END OF BAN LIST");
+
+	if(chans.has(msg[CHANNAME]))
+		chans.get(msg[CHANNAME]).set_fresh("bans");
+}
+
+
+void Bot::handle_endofquietlist(const Msg &msg)
+{
+	using namespace fmt::ENDOFQUIETLIST;
+
+	log(msg,"END OF 728 LIST");
+
+	if(chans.has(msg[CHANNAME]))
+		chans.get(msg[CHANNAME]).set_fresh("quiets");
+}
+
+
+void Bot::handle_endofwho(const Msg &msg)
+{
+	using namespace fmt::ENDOFWHO;
+
+	log(msg,"END OF WHO");
+
+	for(const auto &target : tokens(msg[TARGET],","))
+		if(chans.has(target))
+			chans.get(target).set_fresh("who");
+}
+
+
 void Bot::handle_topicwhotime(const Msg &msg)
 {
 	using namespace fmt::TOPICWHOTIME;
@@ -1329,7 +1848,7 @@ void Bot::handle_namreply(const Msg &msg)
 
 	const Server &serv(sess.get_server());
 	Chan &chan(chans.add(msg[CHANNAME]));
-	for(const auto &nick : tokens(msg[NAMELIST]))
+	for(const auto &nick : tokens<std::vector,std::string>(msg[NAMELIST]," ",Arena::Alloc<std::string>(msg.get_arena())))
 	{
 		auto modes(chan::nick_prefix(serv,nick));
 		std::transform(modes.begin(),modes.end(),modes.begin(),[&serv]
@@ -1350,7 +1869,12 @@ void Bot::handle_namreply(const Msg &msg)
 
 void Bot::handle_endofnames(const Msg &msg)
 {
+	using namespace fmt::ENDOFNAMES;
+
 	log(msg,"END OF NAMES");
+
+	if(chans.has(msg[CHANNAME]))
+		chans.get(msg[CHANNAME]).set_named();
 }
 
 
@@ -1443,7 +1967,7 @@ void Bot::handle_nicknameinuse(const Msg &msg)
 	{
 		const std::string randy(randstr(14));
 
-		Quote nick("NICK");
+		Quote nick(context,"NICK");
 		nick(randy);
 		sess.set_nick(randy);
 		ns.regain(opts["ns-acct"],opts["ns-pass"]);
@@ -1496,6 +2020,7 @@ void Bot::handle_whospecial(const Msg &msg)
 			User &user(users.get(nick));
 			user.set_host(host);
 			user.set_acct(acct);
+			user.set_fresh();
 			//user.set_idle(idle);
 
 			if(user.is_logged_in() && opts.get<bool>("database") && !user.Acct::exists())
@@ -1765,7 +2290,8 @@ void Bot::state(const State &state)
 {
 	sess.post([&,state,this]
 	{
-		const std::lock_guard<Bot> lock(*this);
+		const auto lock(event_lock());
+		set_tls_context();
 		const auto last(sess.get_state());
 		sess.set(state);
 		events.state_leave(last,last);
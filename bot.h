@@ -11,9 +11,21 @@
 
 
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
 #include <set>
 #include <map>
 #include <list>
+#include <array>
 #include <vector>
 #include <forward_list>
 #include <unordered_map>
@@ -23,15 +35,20 @@
 #include <string>
 #include <iomanip>
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <future>
+#include <random>
+#include <numeric>
 
 // boost
 #include <boost/tokenizer.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -61,6 +78,8 @@ namespace colors
 }
 #include "exception.h"
 #include "util.h"
+#include "mem.h"
+#include "arena.h"
 #include "opts.h"
 #include "mask.h"
 #include "delta.h"
@@ -74,19 +93,27 @@ using Except = Ban;
 using Invite = Ban;
 #include "flags.h"
 #include "akick.h"
+#include "json.h"
 #include "adoc.h"
+#include "trace.h"
 #include "msg.h"
 #include "state.h"
 #include "stream.h"
+#include "metrics.h"
+#include "profile.h"
 namespace handler
 {
 	#include "handler.h"
 	#include "handlers.h"
 }
 
+#include "context.h"
+extern thread_local const Context *ctx;
+inline auto &get_ctx()                 { assert(ctx); return *ctx;             }
+#include "snap.h"
+#include "shards.h"
 #include "adb.h"
-extern thread_local Adb *adb;
-inline auto &get_adb()                 { assert(adb); return *adb;             }
+inline auto &get_adb()                 { return get_ctx().get_adb();           }
 #include "acct.h"
 namespace sendq
 {
@@ -96,23 +123,30 @@ namespace recvq
 {
 	#include "recvq.h"
 }
+namespace exec
+{
+	#include "exec.h"
+}
 #include "throttle.h"
+#include "overflow.h"
+#include "backoff.h"
+#include "admission.h"
+#include "resolver.h"
 #include "socket.h"
 #include "sess.h"
-extern thread_local Sess *sess;
-inline auto &get_sess()                { assert(sess); return *sess;           }
+inline auto &get_sess()                { return get_ctx().get_sess();          }
 inline auto &get_opts()                { return get_sess().get_opts();         }
 inline auto &get_sock()                { return get_sess().get_socket();       }
 #include "floodguard.h"
 #include "cork.h"
 #include "quote.h"
 #include "cmds.h"
+#include "pending.h"
 #include "locutor.h"
 #include "service.h"
-extern thread_local Service *chanserv;
-extern thread_local Service *nickserv;
-inline auto &get_cs()                  { assert(chanserv); return *chanserv;   }
-inline auto &get_ns()                  { assert(nickserv); return *nickserv;   }
+inline auto &get_cs()                  { return get_ctx().get_cs();            }
+inline auto &get_ns()                  { return get_ctx().get_ns();            }
+#include "intern.h"
 #include "user.h"
 namespace chan
 {
@@ -123,14 +157,17 @@ namespace chan
 }
 using Chan = chan::Chan;
 #include "users.h"
-extern thread_local Users *users;
-inline auto &get_users()               { assert(users); return *users;         }
+inline auto &get_users()               { return get_ctx().get_users();         }
 #include "chans.h"
-extern thread_local Chans *chans;
-inline auto &get_chans()               { assert(chans); return *chans;         }
+inline auto &get_chans()               { return get_ctx().get_chans();         }
 #include "events.h"
 #include "nickserv.h"
 #include "chanserv.h"
+#include "resume.h"
+#include "fetch.h"
+#include "capture.h"
+#include "admin.h"
+struct Stats;
 
 
 /**
@@ -142,6 +179,8 @@ inline auto &get_chans()               { assert(chans); return *chans;         }
  *	2. Fill in an 'Opts' options structure (opts.h) and instance of this bot in your project.
  *	3. Operate the controls:
  *		connect() - initiate the connection to server. Async (returns immediately).
+ *		            Admitted by the per-destination bucket (admission.h); a fault
+ *		            reconnects after a jittered backoff (backoff.h).
  *		operator() - runs the event processing for the instance.
  *		
  * This class is protected by a simple mutex via the lock()/unlock() concept:
@@ -149,23 +188,36 @@ inline auto &get_chans()               { assert(chans); return *chans;         }
  *		+ The handlers operate under this lock when called.
  *	- If you access this class asynchronously outside of the handler stack you must lock.
  *
+ * With opts["pinned"] the session instead runs on one exec:: worker thread and the
+ * mutex is not taken for events. Access from outside the handler stack must then be
+ * passed to sess.post() rather than locking.
+ *
  * To destruct the Bot instance from inside a handler, pass a lambda of your destruction
  * routine to sess.post().
  */
 struct Bot : public std::mutex
 {
 	Opts opts;                                        // Options for this session
-	Adb adb;                                          // Document database (local ldb)
+	Adb adb;                                          // Document database (local ldb or snapshot)
+	exec::Worker *worker;                             // Pinned executor thread (null for shared ios)
 	Sess sess;                                        // IRC client session
 	Events events;                                    // Event handler registry
+	Mem mem;                                          // Pool of the state below; outlives it
 	Users users;                                      // Users state
 	Chans chans;                                      // Channels state
 	NickServ ns;                                      // NickServ service parser
 	ChanServ cs;                                      // ChanServ service parser
+	Resume resume;                                    // Channel state saved for the next rejoin
+	Fetch fetchq;                                     // Post-join requests, by channel priority
+	Pending pending;                                  // Queries awaiting their replies
+	Capture capture;                                  // Inbound lines as received (opts capture-file)
+	Admin admin;                                      // Stats to local connections (opts admin-socket)
+	Context context;                                  // Handle to the above; those above only keep its address
 
-	void set_tls_context();                           // Direct thread-locals at this instance.
+	void set_tls_context();                           // Direct thread-local ctx at this instance.
 
   private:
+	std::unique_lock<Bot> event_lock();               // Locked unless pinned
 	static void log(const State &state, const std::string &remarks = "");
 	static void log(const Msg &m, const std::string &name = "");
 
@@ -185,6 +237,9 @@ struct Bot : public std::mutex
 	void handle_channelmodeis(const Msg &m);
 	void handle_topicwhotime(const Msg &m);
 	void handle_creationtime(const Msg &m);
+	void handle_endofbanlist(const Msg &m);
+	void handle_endofquietlist(const Msg &m);
+	void handle_endofwho(const Msg &m);
 	void handle_hosthidden(const Msg &m);
 	void handle_endofnames(const Msg &m);
 	void handle_namreply(const Msg &m);
@@ -268,11 +323,16 @@ struct Bot : public std::mutex
 	void handle_pck(const boost::system::error_code &e, const size_t size, const std::shared_ptr<boost::asio::streambuf> sbuf);
 	void handle_conn(const boost::system::error_code &e);
 	void handle_timeout(const boost::system::error_code &e);
+	void handle_retry(const boost::system::error_code &e, const bool admitted);
+	void handle_fetch(const boost::system::error_code &e);
+	void handle_pending(const boost::system::error_code &e);
 	void handle_socket_ecb(const boost::system::error_code &e);
+	void handle_admin(const boost::system::error_code &e, const Admin::Sd &sd);
 
 	// Inits
 	void init_state_handlers();
 	void init_irc_handlers();
+	void init_metrics();
 
   protected:
 	// Controls
@@ -283,7 +343,13 @@ struct Bot : public std::mutex
 	void set_handle(const std::shared_ptr<boost::asio::streambuf> buf);
 	void set_timer(const milliseconds &ms);           // set a timer for anything
 	void set_timeout();                               // set_timer(opts["timeout"])
+	void set_retry(const milliseconds &ms, const bool &admitted);   // connect() after ms
 	void new_handle();
+	void fetch(Chan &chan);                           // Queue what is stale of a joined channel
+	bool fetch(Chan &chan, const Fetch::Part &part);  // Send one queued part (false if not needed)
+	size_t fetch_prio(const Chan &chan) const;        // Position in autojoin, else after it
+	void set_fetch(const milliseconds &ms);           // Send the next queued part after ms
+	void set_admin();                                 // Accept the next admin connection
 
   public:
 	// Controls
@@ -291,11 +357,14 @@ struct Bot : public std::mutex
 	void disconnect();                                                           // LOCK REQUIRED
 	void join(const std::string &chan)                { chans.join(chan);     }  // LOCK REQUIRED
 	void quit();                                                                 // LOCK OPTIONAL
+	void halt();                                                                 // LOCK REQUIRED
+	Stats stats() const;                                                         // LOCK REQUIRED
 
 	// Execution
 	enum Loop { FOREGROUND, BACKGROUND };
 	void operator()(const Loop &loop = FOREGROUND);   // Run worker loop
-	void operator()(const Msg &msg)                   { events.msg(msg);      }  // manual dispatch (lock required)
+	void operator()(const Msg &msg);                  // manual dispatch (lock required)
+	void operator()(const std::string &line);         // manual dispatch of a raw line (lock required)
 
 	Bot(void) = delete;
 	Bot(const Opts &opts, boost::asio::io_service *const &ios = nullptr);
@@ -303,11 +372,17 @@ struct Bot : public std::mutex
 	Bot(const Bot &) = delete;
 	Bot &operator=(Bot &&) = delete;
 	Bot &operator=(const Bot &) = delete;
+	~Bot() noexcept;
 
 	friend std::ostream &operator<<(std::ostream &s, const Bot &bot);
 };
 
 
+#include "stats.h"
+#include "fleet.h"
+#include "replay.h"
+
+
 }       // namespace bot
 }       // namespace irc
 
@@ -0,0 +1,61 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Wire capture of the lines a Bot receives, for replay (see: replay.h).
+ *
+ * One line of the file per line received, as it came off the socket without
+ * its CRLF, after the time it was received in microseconds since the epoch:
+ *
+ *	1444852329123456 :nick!user@host PRIVMSG #chan :text
+ *
+ * Nothing is recorded without a path; the file is appended to otherwise.
+ */
+class Capture
+{
+	std::ofstream file;
+	size_t lines;
+
+  public:
+	auto is_open() const                              { return file.is_open();                    }
+	auto &get_lines() const                           { return lines;                             }
+
+	void operator()(const char *const &line, size_t len);
+
+	Capture(const std::string &path);
+};
+
+
+inline
+Capture::Capture(const std::string &path):
+lines(0)
+{
+	if(path.empty())
+		return;
+
+	file.open(path,std::ios::out | std::ios::app);
+	if(!file.is_open())
+		throw Exception("Failed to open capture file: ") << path;
+}
+
+
+inline
+void Capture::operator()(const char *const &line,
+                         size_t len)
+{
+	using namespace std::chrono;
+
+	while(len && (line[len-1] == '\n' || line[len-1] == '\r'))
+		--len;
+
+	const auto now(duration_cast<microseconds>(system_clock::now().time_since_epoch()));
+	file << now.count() << ' ';
+	file.write(line,len);
+	file << '\n';
+	++lines;
+}
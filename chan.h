@@ -14,6 +14,7 @@ enum Type
 };
 
 using Info = std::map<std::string, std::string>;
+using Fresh = std::map<std::string, time_t>;
 using Topic = std::tuple<std::string, Mask, time_t>;
 using Lambda = std::function<void (Chan &)>;
 using Lambdas = std::forward_list<Lambda>;
@@ -29,6 +30,7 @@ class Chan : public Locutor,
              public Acct
 {
 	bool joined;                                            // Indication the server has sent us
+	bool named;                                             // RPL_ENDOFNAMES since we joined: users is complete
 	Mode _mode;                                             // Channel's mode state
 	time_t creation;                                        // Timestamp for channel from server
 	std::string pass;                                       // passkey for channel
@@ -37,6 +39,8 @@ class Chan : public Locutor,
 	uint limit;                                             // users +l limit
 	Topic _topic;                                           // Topic state
 	Info info;                                              // ChanServ info response
+	Fresh fresh;                                            // When each fetched part was last complete
+	bool resumed;                                           // Saved state awaiting the creation time check
 	Deltas opdo_deltas;                                     // OpDo Delta queue
 	Lambdas opdo_lambdas;                                   // OpDo Lambda queue
 
@@ -46,6 +50,7 @@ class Chan : public Locutor,
 
 	auto &get_name() const                                  { return Locutor::get_target();         }
 	auto &is_joined() const                                 { return joined;                        }
+	auto &is_named() const                                  { return named;                         }
 	auto &get_mode() const                                  { return _mode;                         }
 	auto &get_creation() const                              { return creation;                      }
 	auto &get_pass() const                                  { return pass;                          }
@@ -54,9 +59,13 @@ class Chan : public Locutor,
 	auto &get_limit() const                                 { return limit;                         }
 	auto &get_topic() const                                 { return _topic;                        }
 	auto &get_info() const                                  { return info;                          }
+	auto &get_fresh() const                                 { return fresh;                         }
+	auto &is_resumed() const                                { return resumed;                       }
 	auto &get_opdo_deltas() const                           { return opdo_deltas;                   }
 	auto &get_opdo_lambdas() const                          { return opdo_lambdas;                  }
+	size_t get_opdo_depth() const;                          // deltas and lambdas queued for op
 	bool has_mode(const char &mode) const                   { return get_mode().has(mode);          }
+	bool is_fresh(const std::string &part, const time_t &ttl) const;
 
 	// Convenience checks for ourself
 	bool is_flag(const char &flag) const;
@@ -65,17 +74,24 @@ class Chan : public Locutor,
 
   protected:
 	bool run_opdo();
+	bool opdo_admit(const Delta *const &delta);             // false to drop it (opts target-max)
 	void fetch_oplists();
 	void event_opped();                                     // We have been opped up
 	bool set_user_mode(const Delta &d);
 	bool set_join_throttle(const Delta &d);
+	void list(const char &c, const uint32_t &reply, const uint32_t &end, const Pending::Callback &cb);
 
   public:
-	void set_joined(const bool &joined)                     { this->joined = joined;                }
+	void set_joined(const bool &joined)                     { this->joined = joined; named = false; }
+	void set_named()                                        { named = true;                         }
 	void set_creation(const time_t &creation)               { this->creation = creation;            }
 	void set_info(const decltype(info) &info)               { this->info = info;                    }
+	void set_fresh(const decltype(fresh) &fresh)            { this->fresh = fresh;                  }
+	void set_fresh(const std::string &part)                 { fresh[part] = time(NULL);             }
+	void set_resumed(const bool &resumed)                   { this->resumed = resumed;              }
 	auto &set_topic()                                       { return _topic;                        }
 	bool set_mode(const Delta &d);
+	void attach(Tally &tally, Mem *const &mem);             // users and lists counted in and allocated from
 
 	// [SEND] Execution interface
 	bool opdo(const Lambda &lambda);                        // sudo <something as op> (happens async)
@@ -87,17 +103,25 @@ class Chan : public Locutor,
 	void operator()(const Delta &delta);                    // best possible deltas execution (cs or op)
 
 	// [SEND] State update interface
+	// A callback is given the reply or capture once complete (see: pending.h, service.h)
 	void who(const std::string &fl = User::WHO_FORMAT);     // Update state of users in channel (goes into Users->User)
-	void accesslist();                                      // ChanServ access list update
-	void flagslist();                                       // ChanServ flags list update
-	void akicklist();                                       // ChanServ akick list update
-	void invitelist();                                      // INVEX update
-	void exceptlist();                                      // EXCEPTS update
-	void quietlist();                                       // 728 q list
-	void banlist();
-	void csinfo();                                          // ChanServ info update
+	void who(const Pending::Callback &cb, const std::string &fl = User::WHO_FORMAT);
+	void accesslist(const Service::Callback &cb = nullptr); // ChanServ access list update
+	void flagslist(const Service::Callback &cb = nullptr);  // ChanServ flags list update
+	void akicklist(const Service::Callback &cb = nullptr);  // ChanServ akick list update
+	void invitelist(const Pending::Callback &cb = nullptr); // INVEX update
+	void exceptlist(const Pending::Callback &cb = nullptr); // EXCEPTS update
+	void quietlist(const Pending::Callback &cb = nullptr);  // 728 q list
+	void banlist(const Pending::Callback &cb = nullptr);
+	void csinfo(const Service::Callback &cb = nullptr);     // ChanServ info update
 	void names();                                           // Update user list of channel (goes into this->users)
 
+	// [SEND] As above, for a reply waited on outside the handlers
+	std::future<Pending::Reply> who_async();
+	std::future<Pending::Reply> banlist_async();
+	std::future<Pending::Reply> quietlist_async();
+	std::future<Service::Capture> csinfo_async();
+
 	// [SEND] ChanServ interface to channel
 	void csclear(const Mode &mode = {"bq"});                // clear a list with a Mode vector
 	void akick_del(const Mask &mask);
@@ -152,12 +176,14 @@ inline
 Chan::Chan(const std::string &name,
            const std::string &pass):
 Locutor(name),
-Acct(&Locutor::get_target()),
+Acct(&Locutor::get_target(),&Locutor::get_ctx().get_adb()),
 joined(false),
+named(false),
 creation(0),
 pass(pass),
 join_throttle{0,0},
-limit(0)
+limit(0),
+resumed(false)
 {
 }
 
@@ -165,8 +191,9 @@ limit(0)
 inline
 Chan::Chan(const Chan &chan):
 Locutor(chan),
-Acct(&Locutor::get_target()),
+Acct(&Locutor::get_target(),&Locutor::get_ctx().get_adb()),
 joined(chan.joined),
+named(chan.named),
 _mode(chan._mode),
 creation(chan.creation),
 pass(chan.pass),
@@ -175,6 +202,8 @@ join_throttle(chan.join_throttle),
 limit(chan.limit),
 _topic(chan._topic),
 info(chan.info),
+fresh(chan.fresh),
+resumed(chan.resumed),
 opdo_deltas(chan.opdo_deltas),
 opdo_lambdas(chan.opdo_lambdas),
 users(chan.users),
@@ -187,8 +216,9 @@ inline
 Chan::Chan(Chan &&chan)
 noexcept:
 Locutor(std::move(chan)),
-Acct(&Locutor::get_target()),
+Acct(&Locutor::get_target(),&Locutor::get_ctx().get_adb()),
 joined(std::move(chan.joined)),
+named(std::move(chan.named)),
 _mode(std::move(chan._mode)),
 creation(std::move(chan.creation)),
 pass(std::move(chan.pass)),
@@ -197,6 +227,8 @@ join_throttle(std::move(chan.join_throttle)),
 limit(std::move(chan.limit)),
 _topic(std::move(chan._topic)),
 info(std::move(chan.info)),
+fresh(std::move(chan.fresh)),
+resumed(std::move(chan.resumed)),
 opdo_deltas(std::move(chan.opdo_deltas)),
 opdo_lambdas(std::move(chan.opdo_lambdas)),
 users(std::move(chan.users)),
@@ -209,7 +241,7 @@ inline
 User &operator<<(User &user,
                  const Chan &chan)
 {
-	const auto &sess(get_sess());
+	const auto &sess(get_ctx().get_sess());
 
 	if(!chan.is_op())
 		return user;
@@ -247,7 +279,7 @@ Chan &operator<<(Chan &chan,
 inline
 void Chan::join()
 {
-	Quote out("JOIN");
+	Quote out(get_ctx(),"JOIN");
 	out << get_name();
 
 	if(!get_pass().empty())
@@ -258,7 +290,7 @@ void Chan::join()
 inline
 void Chan::part()
 {
-	Quote("PART") << get_name();
+	Quote(get_ctx(),"PART") << get_name();
 }
 
 
@@ -430,7 +462,7 @@ void Chan::remove(const User &user,
 	const auto &nick(user.get_nick());
 	opdo([nick,reason](Chan &chan)
 	{
-		Quote("REMOVE") << chan.get_name() << " "  << nick << " :" << reason;
+		Quote(chan.get_ctx(),"REMOVE") << chan.get_name() << " "  << nick << " :" << reason;
 	});
 }
 
@@ -442,7 +474,7 @@ void Chan::kick(const User &user,
 	const auto &nick(user.get_nick());
 	opdo([nick,reason](Chan &chan)
 	{
-		Quote("KICK") << chan.get_name() << " "  << nick << " :" << reason;
+		Quote(chan.get_ctx(),"KICK") << chan.get_name() << " "  << nick << " :" << reason;
 	});
 }
 
@@ -453,7 +485,7 @@ void Chan::invite(const std::string &nick)
 
 	const auto func([nick](Chan &chan)
 	{
-		Quote("INVITE") << nick << " " << chan.get_name();
+		Quote(chan.get_ctx(),"INVITE") << nick << " " << chan.get_name();
 	});
 
 	if(has_mode('g'))
@@ -468,7 +500,7 @@ void Chan::topic(const std::string &text)
 {
 	if(is_flag('t'))
 	{
-		Service &cs(get_cs());
+		Service &cs(get_ctx().get_cs());
 		cs << "TOPIC " << get_name() << " " << text << flush;
 		cs.terminator_errors();
 		return;
@@ -476,7 +508,7 @@ void Chan::topic(const std::string &text)
 
 	opdo([text](Chan &chan)
 	{
-		Quote out("TOPIC");
+		Quote out(chan.get_ctx(),"TOPIC");
 		out << chan.get_name();
 
 		if(!text.empty())
@@ -488,14 +520,14 @@ void Chan::topic(const std::string &text)
 inline
 void Chan::knock(const std::string &msg)
 {
-	Quote("KNOCK") << get_name() << " :" << msg;
+	Quote(get_ctx(),"KNOCK") << get_name() << " :" << msg;
 }
 
 
 inline
 void Chan::unban()
 {
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "UNBAN " << get_name() << flush;
 	cs.terminator_next("Unbanned");
 }
@@ -504,7 +536,7 @@ void Chan::unban()
 inline
 void Chan::recover()
 {
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "RECOVER " << get_name() << flush;
 	cs.terminator_errors();
 }
@@ -527,7 +559,7 @@ void Chan::akick(const Mask &mask,
                  const std::string &ts,
                  const std::string &reason)
 {
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "AKICK " << get_name() << " ADD " << mask;
 
 	if(!ts.empty())
@@ -544,7 +576,7 @@ void Chan::akick(const Mask &mask,
 inline
 void Chan::akick_del(const Mask &mask)
 {
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "AKICK " << get_name() << " DEL " << mask << flush;
 	cs.terminator_any();
 }
@@ -557,7 +589,7 @@ void Chan::flags(const User &user,
 	if(!user.is_logged_in())
 		throw Assertive("Can't set flags on user: not logged in");
 
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "FLAGS " << get_name() << " " << user.get_acct() << " " << deltas << flush;
 
 	std::stringstream terminator;
@@ -569,123 +601,225 @@ void Chan::flags(const User &user,
 inline
 void Chan::csclear(const Mode &mode)
 {
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "clear " << get_name() << " BANS " << mode << flush;
 	cs.terminator_any();
 }
 
 
+/**
+ * Whether part was completed within the last ttl seconds. Parts are named for
+ * what was fetched: "mode", "who", "info", "bans", "quiets", "access".
+ */
 inline
-void Chan::csinfo()
+bool Chan::is_fresh(const std::string &part,
+                    const time_t &ttl)
+const
 {
-	Service &cs(get_cs());
+	const auto it(fresh.find(part));
+	return it != fresh.end() && it->second + ttl >= time(NULL);
+}
+
+
+inline
+void Chan::csinfo(const Service::Callback &cb)
+{
+	Service &cs(get_ctx().get_cs());
 	cs << "info " << get_name() << flush;
 	cs.terminator_next("*** End of Info ***");
+	if(cb)
+		cs.terminator_then(cb);
+}
+
+
+inline
+std::future<Service::Capture> Chan::csinfo_async()
+{
+	auto p(Service::promise());
+	csinfo(p.first);
+	return std::move(p.second);
 }
 
 
 inline
 void Chan::names()
 {
-	Quote out("NAMES");
+	Quote out(get_ctx(),"NAMES");
 	out << get_name() << flush;
 }
 
 
+/**
+ * The callback for a list the server doesn't have is given an empty reply.
+ */
 inline
-void Chan::banlist()
+void Chan::banlist(const Pending::Callback &cb)
 {
-	const auto &sess(get_sess());
+	const auto &sess(get_ctx().get_sess());
 	const auto &serv(sess.get_server());
 	if(serv.chan_pmodes.find('b') == std::string::npos)
+	{
+		if(cb)
+			cb({get_name(),{},false});
+
 		return;
+	}
 
-	mode("+b");
+	list('b',RPL_BANLIST,RPL_ENDOFBANLIST,cb);
 }
 
 
 inline
-void Chan::quietlist()
+std::future<Pending::Reply> Chan::banlist_async()
 {
-	const auto &sess(get_sess());
+	auto p(Pending::promise());
+	banlist(p.first);
+	return std::move(p.second);
+}
+
+
+inline
+void Chan::quietlist(const Pending::Callback &cb)
+{
+	const auto &sess(get_ctx().get_sess());
 	const auto &serv(sess.get_server());
 	if(serv.chan_pmodes.find('q') == std::string::npos)
+	{
+		if(cb)
+			cb({get_name(),{},false});
+
 		return;
+	}
+
+	list('q',RPL_QUIETLIST,RPL_ENDOFQUIETLIST,cb);
+}
 
-	mode("+q");
+
+inline
+std::future<Pending::Reply> Chan::quietlist_async()
+{
+	auto p(Pending::promise());
+	quietlist(p.first);
+	return std::move(p.second);
 }
 
 
 inline
-void Chan::exceptlist()
+void Chan::exceptlist(const Pending::Callback &cb)
 {
-	const auto &sess(get_sess());
+	const auto &sess(get_ctx().get_sess());
 	const auto &isup(sess.get_isupport());
-	mode(std::string("+") + isup.get("EXCEPTS",'e'));
+	list(isup.get("EXCEPTS",'e'),RPL_EXCEPTLIST,RPL_ENDOFEXCEPTLIST,cb);
 }
 
 
 inline
-void Chan::invitelist()
+void Chan::invitelist(const Pending::Callback &cb)
 {
-	const auto &sess(get_sess());
+	const auto &sess(get_ctx().get_sess());
 	const auto &isup(sess.get_isupport());
-	mode(std::string("+") + isup.get("INVEX",'I'));
+	list(isup.get("INVEX",'I'),RPL_INVITELIST,RPL_ENDOFINVITELIST,cb);
+}
+
+
+inline
+void Chan::list(const char &c,
+                const uint32_t &reply,
+                const uint32_t &end,
+                const Pending::Callback &cb)
+{
+	if(cb)
+		get_ctx().get_pending().add({get_name(),{reply},{end,ERR_NOSUCHCHANNEL,ERR_CHANOPRIVSNEEDED},cb});
+
+	mode(std::string("+") + c);
 }
 
 
 inline
-void Chan::flagslist()
+void Chan::flagslist(const Service::Callback &cb)
 {
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "flags " << get_name() << flush;
 
 	std::stringstream ss;
 	ss << "End of " << get_name() << " FLAGS listing.";
 	cs.terminator_next(ss.str());
+	if(cb)
+		cs.terminator_then(cb);
 }
 
 
 inline
-void Chan::accesslist()
+void Chan::accesslist(const Service::Callback &cb)
 {
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "access " << get_name() << " list" << flush;
 
 	std::stringstream ss;
 	ss << "End of " << get_name() << " FLAGS listing.";
 	cs.terminator_next(ss.str());
+	if(cb)
+		cs.terminator_then(cb);
 }
 
 
 inline
-void Chan::akicklist()
+void Chan::akicklist(const Service::Callback &cb)
 {
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << "akick " << get_name() << " list" << flush;
 
 	// This is the best we can do right now
 	std::stringstream ss;
 	ss << "Total of ";
 	cs.terminator_next(ss.str());
+	if(cb)
+		cs.terminator_then(cb);
 }
 
 
 inline
 void Chan::who(const std::string &flags)
 {
-	Quote out("WHO");
+	Quote out(get_ctx(),"WHO");
 	out << get_name() << " " << flags << flush;
 }
 
 
+inline
+void Chan::who(const Pending::Callback &cb,
+               const std::string &flags)
+{
+	get_ctx().get_pending().add({get_name(),{RPL_WHOREPLY,RPL_WHOSPCRPL},{RPL_ENDOFWHO},cb});
+	who(flags);
+}
+
+
+inline
+std::future<Pending::Reply> Chan::who_async()
+{
+	auto p(Pending::promise());
+	who(p.first);
+	return std::move(p.second);
+}
+
+
+inline
+void Chan::attach(Tally &tally,
+                  Mem *const &mem)
+{
+	users.attach(&tally.members,mem);
+	lists.attach(tally,mem);
+}
+
+
 inline
 bool Chan::set_mode(const Delta &d)
 try
 {
 	using std::get;
 
-	const auto &sess(get_sess());
+	const auto &sess(get_ctx().get_sess());
 	const auto &serv(sess.get_server());
 	switch(serv.mode_type(d))
 	{
@@ -794,7 +928,7 @@ void Chan::csdo(const Deltas &deltas)
 	const auto cmd(gen_cs_cmd(get_name(),deltas));
 	if(!cmd.empty())
 	{
-		Service &cs(get_cs());
+		Service &cs(get_ctx().get_cs());
 		cs << cmd << flush;
 		cs.terminator_errors();
 		return;
@@ -818,7 +952,7 @@ bool Chan::csdo(const Delta &delta)
 	if(cmd.empty())
 		return false;
 
-	Service &cs(get_cs());
+	Service &cs(get_ctx().get_cs());
 	cs << cmd << flush;
 	cs.terminator_errors();
 	return true;
@@ -831,7 +965,10 @@ bool Chan::opdo(const Deltas &deltas)
 	if(!is_op() && opdo_deltas.empty() && opdo_lambdas.empty())
 		op();
 
-	opdo_deltas.insert(opdo_deltas.end(),deltas.begin(),deltas.end());
+	for(const auto &delta : deltas)
+		if(opdo_admit(&delta))
+			opdo_deltas.emplace_back(delta);
+
 	return run_opdo();
 }
 
@@ -842,7 +979,9 @@ bool Chan::opdo(const Delta &delta)
 	if(!is_op() && opdo_deltas.empty() && opdo_lambdas.empty())
 		op();
 
-	opdo_deltas.emplace_back(delta);
+	if(opdo_admit(&delta))
+		opdo_deltas.emplace_back(delta);
+
 	return run_opdo();
 }
 
@@ -853,15 +992,66 @@ bool Chan::opdo(const Lambda &lambda)
 	if(!is_op() && opdo_deltas.empty() && opdo_lambdas.empty())
 		op();
 
-	opdo_lambdas.emplace_front(lambda);
+	if(opdo_admit(nullptr))
+		opdo_lambdas.emplace_front(lambda);
+
 	return run_opdo();
 }
 
 
+/**
+ * Queued deltas are what can be coalesced or dropped for the oldest; a lambda
+ * offered to a full queue without deltas is dropped instead.
+ */
+inline
+bool Chan::opdo_admit(const Delta *const &delta)
+{
+	auto &bound(get_bound());
+	if(!bound.full(get_opdo_depth()))
+		return true;
+
+	switch(bound.policy)
+	{
+		case Overflow::REJECT:
+			bound.rejected++;
+			throw Exception("Too many operations waiting for ops in ") << get_name();
+
+		case Overflow::COALESCE:
+			if(delta && std::find(opdo_deltas.begin(),opdo_deltas.end(),*delta) != opdo_deltas.end())
+			{
+				bound.dropped++;
+				return false;
+			}
+			// fallthrough
+
+		case Overflow::DROP_OLDEST:
+			bound.dropped++;
+			if(opdo_deltas.empty())
+				return false;
+
+			opdo_deltas.erase(opdo_deltas.begin());
+			return true;
+
+		case Overflow::DROP_NEWEST:
+		default:
+			bound.dropped++;
+			return false;
+	}
+}
+
+
+inline
+size_t Chan::get_opdo_depth()
+const
+{
+	return opdo_deltas.size() + std::distance(opdo_lambdas.begin(),opdo_lambdas.end());
+}
+
+
 inline
 void Chan::event_opped()
 {
-	const Sess &sess(get_sess());
+	const Sess &sess(get_ctx().get_sess());
 	const Opts &opts(sess.get_opts());
 	const auto opq_empty(opdo_deltas.empty() && opdo_lambdas.empty());
 	if(opq_empty && opts.get<bool>("chan-fetch-lists"))
@@ -874,7 +1064,7 @@ void Chan::event_opped()
 inline
 void Chan::fetch_oplists()
 {
-	const Sess &sess(get_sess());
+	const Sess &sess(get_ctx().get_sess());
 
 	if(sess.isupport("INVEX"))
 		invitelist();
@@ -911,7 +1101,7 @@ bool Chan::run_opdo()
 		std::cerr << "Chan::run_opdo() lambda exception: " << e << std::endl;
 	}
 
-	const auto &sess(get_sess());
+	const auto &sess(get_ctx().get_sess());
 	const auto &acct(sess.get_acct());
 	if(!acct.empty() && lists.has_flag(acct) && !is_flag('O'))
 		opdo_deltas.emplace_back("-o",get_my_nick());
@@ -925,7 +1115,7 @@ inline
 bool Chan::is_flag(const char &flag)
 const
 {
-	const auto &sess(get_sess());
+	const auto &sess(get_ctx().get_sess());
 	const auto &acct(sess.get_acct());
 	return lists.has_flag(acct,flag);
 }
@@ -968,6 +1158,10 @@ std::ostream &operator<<(std::ostream &s,
 	for(const auto &kv : c.info)
 		s << "\t" << kv.first << ":\t => " << kv.second << std::endl;
 
+	s << "fresh:      \t" << c.fresh.size() << (c.is_resumed()? " (resumed)" : "") << std::endl;
+	for(const auto &kv : c.fresh)
+		s << "\t" << kv.first << ":\t => " << kv.second << std::endl;
+
 	s << c.lists << std::endl;
 	s << c.users << std::endl;
 	return s;
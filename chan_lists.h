@@ -6,7 +6,52 @@
  */
 
 
-template<class Value> using List = std::set<Value>;
+/**
+ * Totals over the channels of one Chans, kept as their entries come and go so
+ * no channel is walked to know them (see: Stats).
+ */
+struct Tally
+{
+	size_t members = 0;                               // over every chan::Users
+	size_t bans = 0;
+	size_t quiets = 0;
+	size_t excepts = 0;
+	size_t invites = 0;
+	size_t akicks = 0;
+	size_t flags = 0;
+};
+
+
+/**
+ * A set counting its entries into a total of the Tally and allocating them
+ * from the Mem of its Chans. A copy does neither (e.g one being filled to be
+ * assigned over an attached List); what it's assigned over keeps its own.
+ */
+template<class Value>
+class List : public std::set<Value, std::less<Value>, Alloc<Value>>
+{
+	using Set = std::set<Value, std::less<Value>, Alloc<Value>>;
+
+	size_t *tally {nullptr};
+
+	void recount(const size_t &prev, const size_t &now) { if(tally) *tally += now - prev;        }
+
+  public:
+	void attach(size_t *const &tally, Mem *const &mem);
+
+	template<class... Args> std::pair<typename Set::iterator,bool> emplace(Args&&... args);
+	typename Set::iterator erase(const typename Set::const_iterator &it);
+	size_t erase(const Value &value);
+	void clear() noexcept;
+
+	List() = default;
+	List(const List &list): Set(list) {}
+	List(List &&list) noexcept: Set(std::move(list)), tally(list.tally) {}
+	List &operator=(const List &list);
+	List &operator=(List &&list) noexcept;
+	~List() noexcept                                  { recount(this->size(),0);                }
+};
+
 template<class R, class List> using Closure = std::function<R (const typename List::value_type &)>;
 
 template<class List> void for_each(const List &list, const Mask &match, const Closure<void,List> &func);
@@ -42,11 +87,25 @@ struct Lists
 	// Mutators
 	bool set_mode(const Delta &delta);
 	void delta_flag(const Mask &m, const std::string &delta);
+	void attach(Tally &tally, Mem *const &mem);
 
 	friend std::ostream &operator<<(std::ostream &s, const Lists &lists);
 };
 
 
+inline
+void Lists::attach(Tally &tally,
+                   Mem *const &mem)
+{
+	bans.attach(&tally.bans,mem);
+	quiets.attach(&tally.quiets,mem);
+	excepts.attach(&tally.excepts,mem);
+	invites.attach(&tally.invites,mem);
+	akicks.attach(&tally.akicks,mem);
+	flags.attach(&tally.flags,mem);
+}
+
+
 inline
 void Lists::delta_flag(const Mask &mask,
                        const std::string &delta)
@@ -231,7 +290,7 @@ bool exists(const List &list,
 	return std::any_of(std::begin(list),std::end(list),[&match]
 	(const auto &element)
 	{
-		return Mask(element) == match;
+		return static_cast<const Mask &>(element) == match;
 	});
 }
 
@@ -258,7 +317,7 @@ size_t count(const List &list,
 	return std::count_if(std::begin(list),std::end(list),[&match]
 	(const auto &element)
 	{
-		return Mask(element) == match;
+		return static_cast<const Mask &>(element) == match;
 	});
 }
 
@@ -306,3 +365,78 @@ void for_each(const List &list,
 			if(!func(elem))
 				return;
 }
+
+
+template<class Value>
+void List<Value>::attach(size_t *const &tally,
+                         Mem *const &mem)
+{
+	recount(this->size(),0);
+	this->tally = tally;
+	recount(0,this->size());
+
+	Set set(this->begin(),this->end(),std::less<Value>(),mem);
+	Set::swap(set);
+}
+
+
+template<class Value>
+template<class... Args>
+std::pair<typename List<Value>::Set::iterator,bool> List<Value>::emplace(Args&&... args)
+{
+	const auto ret(Set::emplace(std::forward<Args>(args)...));
+	recount(0,ret.second);
+	return ret;
+}
+
+
+template<class Value>
+typename List<Value>::Set::iterator List<Value>::erase(const typename Set::const_iterator &it)
+{
+	recount(1,0);
+	return Set::erase(it);
+}
+
+
+template<class Value>
+size_t List<Value>::erase(const Value &value)
+{
+	const auto ret(Set::erase(value));
+	recount(ret,0);
+	return ret;
+}
+
+
+template<class Value>
+void List<Value>::clear()
+noexcept
+{
+	recount(this->size(),0);
+	Set::clear();
+}
+
+
+template<class Value>
+List<Value> &List<Value>::operator=(const List &list)
+{
+	const auto prev(this->size());
+	Set::operator=(list);
+	recount(prev,this->size());
+	return *this;
+}
+
+
+/**
+ * Whatever the moved-from list still holds stays counted in its own tally.
+ */
+template<class Value>
+List<Value> &List<Value>::operator=(List &&list)
+noexcept
+{
+	const auto prev(this->size());
+	const auto prev_list(list.size());
+	Set::operator=(std::move(list));
+	recount(prev,this->size());
+	list.recount(prev_list,list.size());
+	return *this;
+}
@@ -9,7 +9,11 @@
 class Users
 {
 	using Cmp = CaseInsensitiveEqual<std::string>;
-	std::unordered_map<std::string, std::tuple<User *, Mode>, Cmp, Cmp> users;
+	using Value = std::pair<const std::string, std::tuple<User *, Mode>>;
+	std::unordered_map<std::string, std::tuple<User *, Mode>, Cmp, Cmp, Alloc<Value>> users;
+	size_t *tally {nullptr};                                // Tally::members; a copy counts into nothing
+
+	void recount(const size_t &prev, const size_t &now)     { if(tally) *tally += now - prev;       }
 
   public:
 	void for_each(const std::function<void (const User &, const Mode &)> &c) const;
@@ -32,16 +36,38 @@ class Users
 	bool rename(const User &user, const std::string &old);
 	bool add(User &user, const Mode &mode = {});
 	bool del(User &user) noexcept;
+	void clear() noexcept                                   { recount(num(),0); users.clear();      }
+	void attach(size_t *const &tally, Mem *const &mem);
+
+	Users() = default;
+	Users(const Users &users): users(users.users) {}
+	Users(Users &&users) noexcept: users(std::move(users.users)), tally(users.tally) {}
+	~Users() noexcept                                       { recount(num(),0);                     }
 
 	friend std::ostream &operator<<(std::ostream &s, const Users &users);
 };
 
 
+inline
+void Users::attach(size_t *const &tally,
+                   Mem *const &mem)
+{
+	recount(num(),0);
+	this->tally = tally;
+	recount(0,num());
+
+	decltype(users) users(this->users.begin(),this->users.end(),0,Cmp(),Cmp(),mem);
+	this->users.swap(users);
+}
+
+
 inline
 bool Users::del(User &user)
 noexcept
 {
-	return users.erase(user.get_nick());
+	const auto ret(users.erase(user.get_nick()));
+	recount(ret,0);
+	return ret;
 }
 
 
@@ -52,6 +78,7 @@ bool Users::add(User &user,
 	const auto iit(users.emplace(std::piecewise_construct,
 	                             std::forward_as_tuple(user.get_nick()),
 	                             std::forward_as_tuple(std::make_tuple(&user,mode))));
+	recount(0,iit.second);
 	return iit.second;
 }
 
@@ -66,6 +93,7 @@ try
 
 	const auto &new_nick(user.get_nick());
 	const auto iit(users.emplace(new_nick,val));
+	recount(1,iit.second);
 	return iit.second;
 }
 catch(const std::out_of_range &e)
@@ -9,13 +9,17 @@
 class Chans
 {
 	using Cmp = CaseInsensitiveLess<std::string>;
-	std::map<std::string, Chan, Cmp> chans;
+	const Context *ctx;
+	Mem *mem;                                          // of every Chan in chans (or null)
+	chan::Tally tally;                                 // of every Chan in chans; outlives them
+	std::map<std::string, Chan, Cmp, Alloc<std::pair<const std::string, Chan>>> chans;
 
   public:
 	// Observers
 	const Chan &get(const std::string &name) const     { return chans.at(name);                     }
 	bool has(const std::string &name) const            { return chans.count(name);                  }
 	auto num() const                                   { return chans.size();                       }
+	auto &get_tally() const                            { return tally;                              }
 
 	// Closures
 	void for_each(const User &user, const std::function<void (const Chan &)> &c) const;
@@ -37,14 +41,26 @@ class Chans
 	void servicejoin();                                // Joins all channels with access
 	void autojoin();                                   // Joins all channels in the autojoin list
 
+	Chans(const Context &ctx, Mem *const &mem = nullptr);
+
 	friend std::ostream &operator<<(std::ostream &s, const Chans &c);
 };
 
 
+inline
+Chans::Chans(const Context &ctx,
+             Mem *const &mem):
+ctx(&ctx),
+mem(mem),
+chans(Cmp(),mem)
+{
+}
+
+
 inline
 void Chans::autojoin()
 {
-	const auto &opts(get_opts());
+	const auto &opts(ctx->get_sess().get_opts());
 	for(const auto &chan : opts.autojoin)
 		join(chan);
 }
@@ -53,7 +69,7 @@ void Chans::autojoin()
 inline
 void Chans::servicejoin()
 {
-	const auto &sess(get_sess());
+	const auto &sess(ctx->get_sess());
 	for(const auto &p : sess.get_access())
 	{
 		const auto &chan(p.first);
@@ -78,7 +94,7 @@ inline
 Chan &Chans::get(const std::string &name)
 try
 {
-	return chans.at(tolower(name));
+	return chans.at(name);
 }
 catch(const std::out_of_range &e)
 {
@@ -89,10 +105,17 @@ catch(const std::out_of_range &e)
 inline
 Chan &Chans::add(const std::string &name)
 {
+	const auto it(chans.find(name));
+	if(it != chans.end())
+		return it->second;
+
 	auto iit(chans.emplace(std::piecewise_construct,
 	                       std::forward_as_tuple(tolower(name)),
 	                       std::forward_as_tuple(tolower(name))));
 
+	if(iit.second)
+		iit.first->second.attach(tally,mem);
+
 	return iit.first->second;
 }
 
@@ -23,13 +23,14 @@ class ChanServ : public Service
 	void handle_chan_notice(const Msg &msg, Chan &chan);
 	void handle(const Msg &msg);
 
-	ChanServ(Chans &chans);
+	ChanServ(const Context &ctx, Chans &chans);
 };
 
 
 inline
-ChanServ::ChanServ(Chans &chans):
-Service("ChanServ"),
+ChanServ::ChanServ(const Context &ctx,
+                   Chans &chans):
+Service(ctx,"ChanServ"),
 chans(chans)
 {
 }
@@ -104,6 +105,7 @@ void ChanServ::handle_info(const Capture &msg)
 	}
 
 	chan.set_info(info);
+	chan.set_fresh("info");
 }
 
 
@@ -134,6 +136,7 @@ void ChanServ::handle_flagslist(const Capture &msg)
 	}
 
 	chan.lists.flags = flags;
+	chan.set_fresh("access");
 }
 
 
@@ -164,6 +167,7 @@ void ChanServ::handle_akicklist(const Capture &msg)
 	}
 
 	chan.lists.akicks = akicks;
+	chan.set_fresh("akicks");
 }
 
 
@@ -0,0 +1,42 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+class Adb;
+class Sess;
+class Users;
+class Chans;
+class Service;
+class Pending;
+
+
+/**
+ * The instances making up one Bot, as a single handle. Each Bot owns one.
+ *
+ * Objects created for a Bot (Locutor and so Chan/User, Quote, ...) take the
+ * Context once at construction and use it thereafter. The thread-local ctx
+ * and the free get_sess()/get_sock()/etc. remain for code without a handle;
+ * Bot points ctx at its Context on entry to each event (set_tls_context()).
+ */
+struct Context
+{
+	Adb *adb;
+	Sess *sess;
+	Users *users;
+	Chans *chans;
+	Service *nickserv;
+	Service *chanserv;
+	Pending *pending;
+
+	auto &get_adb() const                              { assert(adb); return *adb;                  }
+	auto &get_sess() const                             { assert(sess); return *sess;                }
+	auto &get_users() const                            { assert(users); return *users;              }
+	auto &get_chans() const                            { assert(chans); return *chans;              }
+	auto &get_ns() const                               { assert(nickserv); return *nickserv;        }
+	auto &get_cs() const                               { assert(chanserv); return *chanserv;        }
+	auto &get_pending() const                          { assert(pending); return *pending;          }
+};
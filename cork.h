@@ -8,15 +8,18 @@
 
 struct Cork
 {
-	Cork()
+	Socket &sock;
+
+	Cork(const Context &ctx):
+	     sock(ctx.get_sess().get_socket())
 	{
-		auto &sock(get_sock());
 		sock.set_cork();
 	}
 
+	Cork(): Cork(get_ctx()) {}
+
 	~Cork()
 	{
-		auto &sock(get_sock());
 		sock.unset_cork();
 		if(!sock.has_cork())
 			sock << Socket::flush;
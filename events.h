@@ -13,22 +13,22 @@ struct Events
 
 	// Event in a channel apropos a user in that channel.
 	using ChanUser = void (const bot::Msg &, bot::Chan &, bot::User &);
-	Handlers<ChanUser> chan_user;
+	Handlers<ChanUser> chan_user {"chan_user"};
 
 	// Event for a channel itself.
 	using Chan = void (const bot::Msg &, bot::Chan &);
-	Handlers<Chan> chan;
+	Handlers<Chan> chan {"chan"};
 
 	// Event for a user itself.
 	using User = void (const bot::Msg &, bot::User &);
-	Handlers<User> user;
+	Handlers<User> user {"user"};
 
 	// Raw message received from the server.
 	using Msg = void (const bot::Msg &);
-	Handlers<Msg> msg;
+	Handlers<Msg> msg {"msg"};
 
 	// Session state change
 	using State = void (const bot::State &);
-	Handlers<State> state_leave;
-	Handlers<State> state;
+	Handlers<State> state_leave {"state_leave"};
+	Handlers<State> state {"state"};
 };
@@ -0,0 +1,136 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+#include "bot.h"
+
+using namespace irc::bot;
+
+
+decltype(exec::mutex)        exec::mutex;
+decltype(exec::interrupted)  exec::interrupted;
+decltype(exec::workers)      exec::workers;
+static std::condition_variable joined;
+static const scope join_workers([]
+{
+	exec::interrupt();
+	for(auto &worker : exec::workers)
+	{
+		worker->thread->join();
+		delete worker->thread;
+	}
+});
+
+
+void exec::interrupt()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	interrupted.store(true,std::memory_order_release);
+	for(auto &worker : workers)
+		worker->ios.stop();
+
+	joined.notify_all();
+}
+
+
+void exec::join()
+{
+	std::unique_lock<decltype(mutex)> lock(mutex);
+	joined.wait(lock,[]
+	{
+		return interrupted.load(std::memory_order_consume);
+	});
+}
+
+
+size_t exec::num_workers()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	return workers.size();
+}
+
+
+// Adds workers until there are num; the mutex is held
+static
+void grow(const size_t &num)
+{
+	using namespace exec;
+
+	while(workers.size() < num)
+	{
+		workers.emplace_back(std::make_unique<Worker>());
+		auto &worker(*workers.back());
+		worker.thread = new std::thread(&exec::worker,std::ref(worker));
+	}
+}
+
+
+void exec::add_workers(const size_t &num)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	grow(workers.size() + num);
+}
+
+
+void exec::min_workers(const size_t &num)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	grow(num);
+}
+
+
+exec::Worker &exec::pin(const size_t &hash,
+                        const size_t &steal)
+{
+	if(!num_workers())
+		min_workers(1);
+
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	auto &home(*workers.at(hash % workers.size()));
+	auto &idle(**std::min_element(workers.begin(),workers.end(),[]
+	(const auto &a, const auto &b)
+	{
+		return a->sessions.load(std::memory_order_relaxed) < b->sessions.load(std::memory_order_relaxed);
+	}));
+
+	const auto excess(home.sessions.load(std::memory_order_relaxed) - idle.sessions.load(std::memory_order_relaxed));
+	auto &ret(excess > steal? idle : home);
+	ret.sessions.fetch_add(1,std::memory_order_relaxed);
+	return ret;
+}
+
+
+void exec::unpin(Worker &worker)
+{
+	worker.sessions.fetch_sub(1,std::memory_order_relaxed);
+}
+
+
+void exec::worker(Worker &worker)
+{
+	const boost::asio::io_service::work work(worker.ios);
+
+	while(!interrupted.load(std::memory_order_consume)) try
+	{
+		worker.ios.run();
+	}
+	catch(const Interrupted &e)
+	{
+		continue;
+	}
+	catch(const std::exception &e)
+	{
+		// run() returns after the handler which threw; the others on this worker go on
+		std::cerr << "\033[1;31m[exec]: unhandled: " << e.what() << "\033[0m" << std::endl;
+		continue;
+	}
+	catch(...)
+	{
+		std::cerr << "\033[1;31m[exec]: unhandled non-standard exception\033[0m" << std::endl;
+		continue;
+	}
+}
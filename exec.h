@@ -0,0 +1,35 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Worker threads each running their own io_service. A pinned session is bound
+ * to one worker for its lifetime, so all of its handlers run on one thread in
+ * order and need no Bot mutex; sessions on different workers never contend.
+ *
+ * Sessions are placed by hash; if the hashed worker carries more than `steal`
+ * sessions over the least loaded worker, the least loaded one takes it instead.
+ */
+struct Worker
+{
+	boost::asio::io_service ios;
+	std::atomic<size_t> sessions {0};                 // pinned to this worker
+	std::thread *thread {nullptr};
+};
+
+extern std::mutex mutex;
+extern std::atomic<bool> interrupted;
+extern std::vector<std::unique_ptr<Worker>> workers;
+
+size_t num_workers();                             // No lock required.
+void add_workers(const size_t &num = 1);          // No lock required.
+void min_workers(const size_t &num = 0);          // No lock required.
+Worker &pin(const size_t &hash, const size_t &steal = 4);  // No lock required.
+void unpin(Worker &worker);                       // No lock required.
+void interrupt();                                 // No lock required.
+void join();                                      // No lock required. Blocks until interrupt()
+void worker(Worker &worker);                      // Thread body (internal usage)
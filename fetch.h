@@ -0,0 +1,195 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Queue of channel metadata requests made after joining.
+ *
+ * Each channel/part is queued once. Work is taken in order of channel priority,
+ * then part, when it's time to send (not when the JOIN arrived), so channels
+ * near the front of autojoin are synced first and a part queued twice is only
+ * sent once. WHO jobs are sent together, several channels to a line where
+ * TARGMAX allows.
+ */
+class Fetch
+{
+  public:
+	enum Part : uint8_t                               // in the order they are sent for one channel
+	{
+		MODE,
+		WHO,
+		BANS,
+		QUIETS,
+		INFO,
+		ACCESS,
+	};
+
+	struct Job
+	{
+		size_t prio;                                  // lower is sooner
+		Part part;
+		std::string chan;
+
+		bool operator<(const Job &o) const;
+	};
+
+  private:
+	std::set<Job> queue;
+	std::map<std::pair<std::string,Part>,size_t> queued;    // (lowercase chan, part) -> prio
+	boost::asio::steady_timer timer;
+	bool armed;
+
+  public:
+	auto &get_queue() const                           { return queue;                              }
+	auto size() const                                 { return queue.size();                       }
+	bool empty() const                                { return queue.empty();                      }
+	bool is_armed() const                             { return armed;                              }
+	static size_t targmax(const ISupport &isupport, const std::string &cmd);
+
+	bool add(const std::string &chan, const Part &part, const size_t &prio);   // false if queued
+	size_t del(const std::string &chan);              // drop a channel's queued parts
+	Job take();                                       // pop the first job
+	std::vector<std::string> take(const Part &part, const size_t &max);   // pop up to max chans
+	void clear();
+
+	template<class Handler> void arm(const milliseconds &ms, Handler&& handler);
+	void disarm()                                     { armed = false;                             }
+
+	Fetch(boost::asio::io_service &ios);
+};
+
+
+inline
+Fetch::Fetch(boost::asio::io_service &ios):
+timer(ios),
+armed(false)
+{
+
+}
+
+
+template<class Handler>
+void Fetch::arm(const milliseconds &ms,
+                Handler&& handler)
+{
+	if(armed)
+		return;
+
+	armed = true;
+	timer.expires_from_now(ms);
+	timer.async_wait(std::forward<Handler>(handler));
+}
+
+
+inline
+void Fetch::clear()
+{
+	boost::system::error_code ec;
+	timer.cancel(ec);
+	queue.clear();
+	queued.clear();
+	armed = false;
+}
+
+
+inline
+bool Fetch::add(const std::string &chan,
+                const Part &part,
+                const size_t &prio)
+{
+	const auto key(std::make_pair(tolower(chan),part));
+	const auto it(queued.find(key));
+	if(it != queued.end())
+	{
+		if(it->second <= prio)
+			return false;
+
+		// Queued again with a better priority: move it up
+		queue.erase({it->second,part,key.first});
+		it->second = prio;
+		queue.insert({prio,part,key.first});
+		return false;
+	}
+
+	queued.emplace(key,prio);
+	queue.insert({prio,part,key.first});
+	return true;
+}
+
+
+inline
+size_t Fetch::del(const std::string &chan)
+{
+	size_t ret(0);
+	const auto name(tolower(chan));
+	for(auto it(queued.lower_bound({name,Part(0)})); it != queued.end() && it->first.first == name; ++ret)
+	{
+		queue.erase({it->second,it->first.second,name});
+		queued.erase(it++);
+	}
+
+	return ret;
+}
+
+
+inline
+Fetch::Job Fetch::take()
+{
+	auto job(*queue.begin());
+	queue.erase(queue.begin());
+	queued.erase({job.chan,job.part});
+	return job;
+}
+
+
+inline
+std::vector<std::string> Fetch::take(const Part &part,
+                                     const size_t &max)
+{
+	std::vector<std::string> ret;
+	for(auto it(queue.begin()); it != queue.end() && ret.size() < max;)
+	{
+		if(it->part != part)
+		{
+			++it;
+			continue;
+		}
+
+		ret.emplace_back(it->chan);
+		queued.erase({it->chan,part});
+		queue.erase(it++);
+	}
+
+	return ret;
+}
+
+
+/**
+ * Targets allowed per command by ISUPPORT TARGMAX (e.g "WHO:4,NAMES:1"); 1 when
+ * the command isn't listed, and a bounded 8 when listed without a limit.
+ */
+inline
+size_t Fetch::targmax(const ISupport &isupport,
+                      const std::string &cmd)
+{
+	for(const auto &tok : tokens(isupport["TARGMAX"],","))
+	{
+		const auto kv(split(tok,":"));
+		if(kv.first == cmd)
+			return kv.second.empty()? 8 : std::max(lex_cast<size_t>(kv.second),size_t(1));
+	}
+
+	return 1;
+}
+
+
+inline
+bool Fetch::Job::operator<(const Job &o)
+const
+{
+	return std::tie(prio,part,chan) < std::tie(o.prio,o.part,o.chan);
+}
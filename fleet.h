@@ -0,0 +1,285 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Supervisor for many Bot in one process.
+ *
+ * Every Bot of a Fleet is pinned (see: exec.h). The Fleet sizes the worker pool
+ * once and the sessions are spread over it, so hundreds of bots run on a handful
+ * of threads with no per-bot thread or lock. What the library holds process-wide
+ * is then shared by all of them: the sendq thread and its scheduler, the resolver
+ * cache, connect admission, database shards by path and interned strings.
+ *
+ * Bots are added and deleted at any time from outside the handler stack. del()
+ * halts the Bot on its own thread and destroys it after its aborted handlers have
+ * run; the future it returns is ready then. The futures of del(), and clear() and
+ * stats() which wait on every Bot, must not be waited on from a handler.
+ */
+class Fleet
+{
+  public:
+	struct Stats
+	{
+		size_t bots = 0;
+		std::map<State,size_t> states;                // number of bots in each State
+		size_t users = 0;
+		size_t chans = 0;
+		size_t pending = 0;                           // queries awaiting their replies
+		size_t sendq_depth = 0;                       // lines queued by these bots
+		size_t sendq_dropped = 0;                     // by the sendq overflow policy
+		size_t sendq_rejected = 0;
+		size_t sendq_total = 0;                       // lines queued by the process
+		size_t workers = 0;
+		size_t interned = 0;                          // strings in the Intern pool
+
+		Stats &operator+=(const Stats &o);
+		Stats() = default;
+		explicit Stats(const Bot &bot);               // Only on the bot's thread
+	};
+
+  private:
+	mutable std::mutex mutex;
+	size_t threads;
+	std::map<std::string,std::unique_ptr<Bot>> bots;
+
+  public:
+	auto &get_threads() const                         { return threads;                            }
+	size_t size() const;
+	bool has(const std::string &id) const;
+	Stats stats() const;
+
+	// Posts func to each Bot's own thread
+	void for_each(const std::function<void (Bot &)> &func);
+
+	Bot &add(const std::string &id, Opts opts);       // opts["pinned"] and opts["threads"] are forced
+	std::future<void> del(const std::string &id);     // invalid future if no such id
+	void clear();                                     // del() all and wait for them
+
+	Fleet(const size_t &threads = std::thread::hardware_concurrency());
+	Fleet(Fleet &&) = delete;
+	Fleet(const Fleet &) = delete;
+	Fleet &operator=(Fleet &&) = delete;
+	Fleet &operator=(const Fleet &) = delete;
+	~Fleet() noexcept;
+
+	friend std::ostream &operator<<(std::ostream &s, const Fleet &f);
+};
+
+
+inline
+Fleet::Fleet(const size_t &threads):
+threads(std::max(threads,size_t(1)))
+{
+	exec::min_workers(this->threads);
+}
+
+
+inline
+Fleet::~Fleet()
+noexcept
+{
+	clear();
+}
+
+
+inline
+Bot &Fleet::add(const std::string &id,
+                Opts opts)
+{
+	opts["pinned"] = "true";
+	opts["threads"] = lex_cast(threads);
+
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	if(bots.count(id))
+		throw Assertive("Fleet already has a bot: ") << id;
+
+	auto bot(std::make_unique<Bot>(opts));
+	auto &ret(*bot);
+	bots.emplace(id,std::move(bot));
+	return ret;
+}
+
+
+/**
+ * The bot's strand is left before destruction, and is left twice first so
+ * whatever halt() aborted gets its turn on it.
+ */
+inline
+std::future<void> Fleet::del(const std::string &id)
+{
+	std::unique_ptr<Bot> bot;
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		const auto it(bots.find(id));
+		if(it == bots.end())
+			return {};
+
+		bot = std::move(it->second);
+		bots.erase(it);
+	}
+
+	const auto p(std::make_shared<std::promise<void>>());
+	auto ret(p->get_future());
+	auto &b(*bot.release());
+	auto &ios(b.sess.get_ios());
+	b.sess.post([&b,&ios,p]
+	{
+		b.set_tls_context();
+		b.halt();
+		ios.post([&b,&ios,p]
+		{
+			b.sess.post([&b,&ios,p]
+			{
+				ios.post([&b,p]
+				{
+					delete &b;
+					p->set_value();
+				});
+			});
+		});
+	});
+
+	return ret;
+}
+
+
+inline
+void Fleet::clear()
+{
+	std::vector<std::string> ids;
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		for(const auto &p : bots)
+			ids.emplace_back(p.first);
+	}
+
+	std::vector<std::future<void>> dels;
+	for(const auto &id : ids)
+		dels.emplace_back(del(id));
+
+	for(auto &d : dels)
+		if(d.valid())
+			d.wait();
+}
+
+
+inline
+void Fleet::for_each(const std::function<void (Bot &)> &func)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	for(const auto &p : bots)
+	{
+		auto &bot(*p.second);
+		bot.sess.post([&bot,func]
+		{
+			bot.set_tls_context();
+			func(bot);
+		});
+	}
+}
+
+
+inline
+Fleet::Stats Fleet::stats()
+const
+{
+	std::vector<std::future<Stats>> futs;
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		for(const auto &p : bots)
+		{
+			auto &bot(*p.second);
+			const auto prom(std::make_shared<std::promise<Stats>>());
+			futs.emplace_back(prom->get_future());
+			bot.sess.post([&bot,prom]
+			{
+				prom->set_value(Stats(bot));
+			});
+		}
+	}
+
+	Stats ret;
+	for(auto &f : futs)
+		ret += f.get();
+
+	ret.sendq_total = sendq::size();
+	ret.workers = exec::num_workers();
+	ret.interned = Intern::size();
+	return ret;
+}
+
+
+inline
+bool Fleet::has(const std::string &id)
+const
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	return bots.count(id);
+}
+
+
+inline
+size_t Fleet::size()
+const
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	return bots.size();
+}
+
+
+inline
+Fleet::Stats::Stats(const Bot &bot):
+bots(1),
+states({{bot.sess.get_state(),1}}),
+users(bot.users.num()),
+chans(bot.chans.num()),
+pending(bot.pending.size()),
+sendq_depth(bot.sess.get_socket().get_depth()),
+sendq_dropped(bot.sess.get_socket().get_bound().dropped),
+sendq_rejected(bot.sess.get_socket().get_bound().rejected)
+{
+}
+
+
+inline
+Fleet::Stats &Fleet::Stats::operator+=(const Stats &o)
+{
+	bots += o.bots;
+	for(const auto &p : o.states)
+		states[p.first] += p.second;
+
+	users += o.users;
+	chans += o.chans;
+	pending += o.pending;
+	sendq_depth += o.sendq_depth;
+	sendq_dropped += o.sendq_dropped;
+	sendq_rejected += o.sendq_rejected;
+	return *this;
+}
+
+
+inline
+std::ostream &operator<<(std::ostream &s,
+                         const Fleet &f)
+{
+	const auto st(f.stats());
+	s << "Fleet(" << st.bots << ") workers: " << st.workers << " interned: " << st.interned << std::endl;
+	s << "States:          ";
+	for(const auto &p : st.states)
+		s << state_t(p.first) << ": " << p.second << " ";
+
+	s << std::endl;
+	s << "Users:           " << st.users << std::endl;
+	s << "Channels:        " << st.chans << std::endl;
+	s << "Pending:         " << st.pending << std::endl;
+	s << "Sendq:           " << st.sendq_depth << " queued "
+	                         << st.sendq_dropped << " dropped "
+	                         << st.sendq_rejected << " rejected "
+	                         << st.sendq_total << " in process" << std::endl;
+	return s;
+}
@@ -8,20 +8,28 @@
 
 class FloodGuard
 {
+	Socket &sock;
 	milliseconds saved;
 
   public:
-	FloodGuard(const uint64_t &ms):
-	           FloodGuard(milliseconds(ms)) {}
+	FloodGuard(const Context &ctx, const uint64_t &ms):
+	           FloodGuard(ctx,milliseconds(ms)) {}
 
-	FloodGuard(const milliseconds &inc):
-	           saved(get_sock().get_throttle().get_inc())
+	FloodGuard(const Context &ctx, const milliseconds &inc):
+	           sock(ctx.get_sess().get_socket()),
+	           saved(sock.get_throttle().get_inc())
 	{
-		get_sock().set_throttle(inc);
+		sock.set_throttle(inc);
 	}
 
+	FloodGuard(const uint64_t &ms):
+	           FloodGuard(get_ctx(),milliseconds(ms)) {}
+
+	FloodGuard(const milliseconds &inc):
+	           FloodGuard(get_ctx(),inc) {}
+
 	~FloodGuard()
 	{
-		get_sock().set_throttle(saved);
+		sock.set_throttle(saved);
 	}
 };
@@ -30,27 +30,34 @@ struct Handler
 	std::function<Prototype> func;
 	flag_t flags;
 	prio_t prio;
+	const char *name;                                 // for its metrics; else labeled by prio
+	size_t metric;                                    // id of its latency (see: Handlers::add())
 
   public:
 	auto &get_flags() const                   { return flags;                             }
 	auto &get_prio() const                    { return prio;                              }
+	auto &get_name() const                    { return name;                              }
 	bool is(const flag_t &flags) const        { return (this->flags & flags) == flags;    }
 
 	template<class... Args> void operator()(Args&&... args) const;
 
 	Handler(const std::function<Prototype> &func    = nullptr,
 	        const flag_t &flags                     = 0,
-	        const prio_t &prio                      = Prio::USER);
+	        const prio_t &prio                      = Prio::USER,
+	        const char *const &name                 = nullptr);
 };
 
 
 template<class Prototype>
 Handler<Prototype>::Handler(const std::function<Prototype> &func,
                             const flag_t &flags,
-                            const prio_t &prio):
+                            const prio_t &prio,
+                            const char *const &name):
 func(func),
 flags(flags),
-prio(prio)
+prio(prio),
+name(name),
+metric(0)
 {
 }
 
@@ -15,15 +15,33 @@ enum Special
 };
 
 
+/**
+ * Dispatches are timed by event, and each handler called is timed (see:
+ * metrics.h); the count of the first is the count of events. Events without a
+ * mapped handler are counted together as MISS, so what a server sends can't
+ * add series without bound. Each handler is called under a Profile::Tag, so
+ * CPU samples taken in it are attributed to the event and handler.
+ */
 template<class Handler>
 class Handlers
 {
 	template<class T> static std::string name_cast(const T &num);
 
+	const char *kind;                                   // Events member; labels the metrics
 	std::multimap<std::string, Handler> handlers;
 	std::vector<std::list<Handler>> specials            { _NUM_SPECIAL                       };
+	std::unordered_map<std::string, size_t> metrics;    // ircbot_dispatch_seconds by event
+	std::array<size_t,3> nums {};                       // handlers and specials by prio class
+
+	static size_t prio_class(const prio_t &prio)        { return prio < LIB? 0 : prio < USER? 1 : 2; }
+	size_t metric(const std::string &event);
+	size_t metric(const std::string &event, const Handler &handler) const;
+	void tally(const Handler &handler, const ssize_t &n);
 
   public:
+	size_t num(const Prio &prio) const;                 // handlers and specials from prio to the next Prio
+	size_t num() const;
+
 	template<class... Args> auto &add(const Special &special, Args&&... args);
 	template<class... Args> auto &add(const std::string &event, Args&&... args);
 	template<class... Args> auto &add(const char *const &event, Args&&... args);
@@ -33,15 +51,24 @@ class Handlers
 	template<class... Args> void operator()(const Msg &msg, Args&&... args);
 	template<class T, class... Args> void operator()(const T &num, Args&&... args);
 
-	void clear(const std::string &event)                { handlers.erase(event);             }
-	void clear(const Special &special)                  { specials[special].clear();         }
+	void clear(const std::string &event);
+	void clear(const Special &special);
 	void clear(const Prio &prio);                       // clears handlers by priority num
-	void clear_handlers()                               { handlers.clear();                  }
+	void clear_handlers();
 	void clear_specials();                              // clears all Special handlers
 	void clear();                                       // clears everything
+
+	Handlers(const char *const &kind = "");
 };
 
 
+template<class Handler>
+Handlers<Handler>::Handlers(const char *const &kind):
+kind(kind)
+{
+}
+
+
 template<class Handler>
 void Handlers<Handler>::clear()
 {
@@ -53,8 +80,39 @@ void Handlers<Handler>::clear()
 template<class Handler>
 void Handlers<Handler>::clear_specials()
 {
-	for(auto &s : specials)
-		s.clear();
+	for(size_t i(0); i < specials.size(); i++)
+		clear(Special(i));
+}
+
+
+template<class Handler>
+void Handlers<Handler>::clear_handlers()
+{
+	for(const auto &p : handlers)
+		tally(p.second,-1);
+
+	handlers.clear();
+}
+
+
+template<class Handler>
+void Handlers<Handler>::clear(const Special &special)
+{
+	for(const auto &handler : specials.at(special))
+		tally(handler,-1);
+
+	specials.at(special).clear();
+}
+
+
+template<class Handler>
+void Handlers<Handler>::clear(const std::string &event)
+{
+	const auto itp(handlers.equal_range(event));
+	for(auto it(itp.first); it != itp.second; ++it)
+		tally(it->second,-1);
+
+	handlers.erase(itp.first,itp.second);
 }
 
 
@@ -63,18 +121,49 @@ void Handlers<Handler>::clear(const Prio &prio)
 {
 	for(auto it(handlers.begin()); it != handlers.end(); )
 		if(it->second.get_prio() == prio)
+		{
+			tally(it->second,-1);
 			handlers.erase(it++);
+		}
 		else
 			++it;
 
 	for(auto &spec : specials)
-		spec.remove_if([&prio](const Handler &handler)
+		spec.remove_if([this,&prio](const Handler &handler)
 		{
-			return handler.get_prio() == prio;
+			if(handler.get_prio() != prio)
+				return false;
+
+			tally(handler,-1);
+			return true;
 		});
 }
 
 
+template<class Handler>
+size_t Handlers<Handler>::num(const Prio &prio)
+const
+{
+	return nums.at(prio_class(prio));
+}
+
+
+template<class Handler>
+size_t Handlers<Handler>::num()
+const
+{
+	return std::accumulate(nums.begin(),nums.end(),size_t(0));
+}
+
+
+template<class Handler>
+void Handlers<Handler>::tally(const Handler &handler,
+                              const ssize_t &n)
+{
+	nums.at(prio_class(handler.get_prio())) += n;
+}
+
+
 template<class Handler>
 template<class T,
          class... Args>
@@ -122,20 +211,42 @@ void Handlers<Handler>::operator()(const std::string &name,
 		return a->get_prio() < b->get_prio();
 	});
 
-	// Call handlers
+	// Call handlers, each timed from the end of the last
+	const auto start(steady_clock::now());
+	auto last(start);
 	for(const Handler *const &handler : vec)
+	{
+		const auto &prio(handler->get_prio());
+		const auto label(handler->get_name()? handler->get_name() : prio < LIB? "hook" : prio < USER? "lib" : "user");
+		const Profile::Tag tag(kind,name.c_str(),label,prio);
 		(*handler)(std::forward<Args>(args)...);
+		const auto now(steady_clock::now());
+		Metrics::record(handler->metric,now - last);
+		last = now;
+	}
+
+	Metrics::record(metric(itp_sz? name : "MISS"),last - start);
 
 	// Erase one-time mapped handlers
 	for(auto it = itp.first; it != itp.second; )
 		if(!it->second.is(RECURRING))
+		{
+			tally(it->second,-1);
 			handlers.erase(it++);
+		}
 		else
 			++it;
 
 	// Erase one-time Special handlers (note: one-time MISS handlers erased even if never called)
 	for(auto &s : specials)
-		s.remove_if([](const auto &handler) { return !handler.is(RECURRING); });
+		s.remove_if([this](const auto &handler)
+		{
+			if(handler.is(RECURRING))
+				return false;
+
+			tally(handler,-1);
+			return true;
+		});
 }
 
 
@@ -156,6 +267,8 @@ auto &Handlers<Handler>::add(const std::string &event,
                              Args&&... args)
 {
 	auto iit(handlers.emplace(event,Handler{std::forward<Args>(args)...}));
+	iit->second.metric = metric(event,iit->second);
+	tally(iit->second,1);
 	return iit->second;
 }
 
@@ -166,6 +279,8 @@ auto &Handlers<Handler>::add(const char *const &event,
                              Args&&... args)
 {
 	auto iit(handlers.emplace(event,Handler{std::forward<Args>(args)...}));
+	iit->second.metric = metric(event,iit->second);
+	tally(iit->second,1);
 	return iit->second;
 }
 
@@ -175,8 +290,39 @@ template<class... Args>
 auto &Handlers<Handler>::add(const Special &spec,
                              Args&&... args)
 {
-	specials.at(spec).emplace_back(Handler{std::forward<Args>(args)...});
-	return specials.at(spec).back();
+	static const char *const names[_NUM_SPECIAL] { "ALL", "MISS" };
+
+	auto &handler(specials.at(spec));
+	handler.emplace_back(Handler{std::forward<Args>(args)...});
+	handler.back().metric = metric(names[spec],handler.back());
+	tally(handler.back(),1);
+	return handler.back();
+}
+
+
+template<class Handler>
+size_t Handlers<Handler>::metric(const std::string &event)
+{
+	const auto it(metrics.find(event));
+	if(it != metrics.end())
+		return it->second;
+
+	const auto labels(std::string("kind=\"") + kind + "\",event=\"" + event + "\"");
+	const auto id(Metrics::id("ircbot_dispatch_seconds","Time to call every handler of an event.",Metrics::HISTOGRAM,labels));
+	metrics.emplace(event,id);
+	return id;
+}
+
+
+template<class Handler>
+size_t Handlers<Handler>::metric(const std::string &event,
+                                 const Handler &handler)
+const
+{
+	const auto prio(handler.get_prio() < LIB? "hook" : handler.get_prio() < USER? "lib" : "user");
+	const auto name(handler.get_name()? handler.get_name() : prio);
+	const auto labels(std::string("kind=\"") + kind + "\",event=\"" + event + "\",handler=\"" + name + "\"");
+	return Metrics::id("ircbot_handler_seconds","Time in one handler.",Metrics::HISTOGRAM,labels);
 }
 
 
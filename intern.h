@@ -0,0 +1,66 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Process-wide pool of immutable strings. Equal strings interned by any Bot
+ * come back as one shared instance, so text every session on a network sees
+ * (e.g user hosts) is held once. An entry leaves the pool with its last Ref.
+ */
+class Intern
+{
+  public:
+	using Ref = std::shared_ptr<const std::string>;
+
+  private:
+	static std::mutex mutex;                          // bot.cpp
+	static std::map<boost::string_ref,std::weak_ptr<const std::string>> pool;
+
+	static void release(const std::string *const &str);
+
+  public:
+	static size_t size();                             // No lock required.
+	static Ref get(const std::string &str);           // No lock required.
+};
+
+
+inline
+Intern::Ref Intern::get(const std::string &str)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	const auto it(pool.find(str));
+	if(it != pool.end())
+		if(auto ret = it->second.lock())
+			return ret;
+
+	// An expired entry is still keyed on its string until release() runs.
+	Ref ret(new std::string(str),&Intern::release);
+	if(it != pool.end())
+		pool.erase(it);
+
+	pool.emplace(boost::string_ref(*ret),ret);
+	return ret;
+}
+
+
+inline
+void Intern::release(const std::string *const &str)
+{
+	const std::unique_ptr<const std::string> del(str);
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	const auto it(pool.find(*str));
+	if(it != pool.end() && it->first.data() == str->data())
+		pool.erase(it);
+}
+
+
+inline
+size_t Intern::size()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	return pool.size();
+}
@@ -0,0 +1,517 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Direct JSON <-> ptree conversion for Adoc.
+ *
+ * Reads from a borrowed buffer (e.g. the database value) and builds the tree
+ * in place without the stringstream and lexer of boost::property_tree's reader.
+ * Writes into a caller's string which is meant to be reused. The resulting trees
+ * and output bytes are identical to read_json()/write_json(s,pt,false), so
+ * documents already stored remain readable and byte-for-byte comparable.
+ */
+namespace json
+{
+	using ptree = boost::property_tree::ptree;
+	using string_ref = boost::string_ref;
+
+	void parse(ptree &dst, const string_ref &src);                 // throws Exception
+	std::string &write(std::string &dst, const ptree &src);        // appends; throws Exception
+
+	// Internal
+	struct Parser;
+	enum Cls : uint8_t { PLAIN, QUOTE, ESCAPE, CTRL };
+	const std::array<Cls,256> &cls();
+	void write_string(std::string &dst, const std::string &str);
+	void write_value(std::string &dst, const ptree &src);
+	void write_object(std::string &dst, const ptree &src);
+	void write_array(std::string &dst, const ptree &src);
+}
+
+
+/**
+ * Character class table shared by the string scanners: runs of PLAIN bytes
+ * are copied in one append rather than char by char.
+ */
+inline
+const std::array<json::Cls,256> &json::cls()
+{
+	static const auto ret([]
+	{
+		std::array<Cls,256> ret;
+		ret.fill(PLAIN);
+		std::fill(ret.begin(),ret.begin()+0x20,CTRL);
+		ret['"'] = QUOTE;
+		ret['\\'] = ESCAPE;
+		return ret;
+	}());
+
+	return ret;
+}
+
+
+struct json::Parser
+{
+	static constexpr size_t MAX_DEPTH               = 512;
+
+	const char *const beg;
+	const char *pos;
+	const char *const end;
+	size_t depth;
+
+	[[noreturn]] void error(const char *const &msg) const;
+	bool eof() const                                    { return pos == end;                         }
+	char peek() const                                   { return eof()? '\0' : *pos;                 }
+	void expect(const char &c, const char *const &msg);
+	void expect(const char *const &lit, const char *const &msg);
+	void skip_ws();
+
+	void parse_codepoint(std::string &dst);
+	void parse_string(std::string &dst);
+	void parse_number(std::string &dst);
+	void parse_array(ptree &dst);
+	void parse_object(ptree &dst);
+	void parse_value(ptree &dst);
+
+	Parser(const string_ref &src);
+};
+
+
+inline
+json::Parser::Parser(const string_ref &src):
+beg(src.data()),
+pos(src.data()),
+end(src.data() + src.size()),
+depth(0)
+{
+}
+
+
+inline
+void json::parse(ptree &dst,
+                 const string_ref &src)
+{
+	Parser p(src);
+	p.skip_ws();
+	p.parse_value(dst);
+	p.skip_ws();
+	if(!p.eof())
+		p.error("garbage after data");
+}
+
+
+inline
+void json::Parser::parse_value(ptree &dst)
+{
+	switch(peek())
+	{
+		case '{':   parse_object(dst);                                            return;
+		case '[':   parse_array(dst);                                             return;
+		case '"':   parse_string(dst.data());                                     return;
+		case 't':   expect("true","expected 'true'");    dst.data() = "true";     return;
+		case 'f':   expect("false","expected 'false'");  dst.data() = "false";    return;
+		case 'n':   expect("null","expected 'null'");    dst.data() = "null";     return;
+		case '-':
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			parse_number(dst.data());
+			return;
+
+		default:
+			error("expected value");
+	}
+}
+
+
+inline
+void json::Parser::parse_object(ptree &dst)
+{
+	if(++depth > MAX_DEPTH)
+		error("nesting too deep");
+
+	expect('{',"expected '{'");
+	skip_ws();
+	if(peek() == '}')
+	{
+		++pos;
+		--depth;
+		return;
+	}
+
+	std::string key;
+	do
+	{
+		skip_ws();
+		if(peek() != '"')
+			error("expected key string");
+
+		key.clear();
+		parse_string(key);
+		skip_ws();
+		expect(':',"expected ':'");
+		skip_ws();
+
+		auto &child(dst.push_back({key,ptree{}})->second);
+		parse_value(child);
+		skip_ws();
+	}
+	while(!eof() && *pos == ',' && ++pos);
+
+	expect('}',"expected '}' or ','");
+	--depth;
+}
+
+
+inline
+void json::Parser::parse_array(ptree &dst)
+{
+	if(++depth > MAX_DEPTH)
+		error("nesting too deep");
+
+	expect('[',"expected '['");
+	skip_ws();
+	if(peek() == ']')
+	{
+		++pos;
+		--depth;
+		return;
+	}
+
+	static const ptree::value_type elem;                // copied in; saves a temporary per element
+	do
+	{
+		skip_ws();
+		auto &child(dst.push_back(elem)->second);
+		parse_value(child);
+		skip_ws();
+	}
+	while(!eof() && *pos == ',' && ++pos);
+
+	expect(']',"expected ']' or ','");
+	--depth;
+}
+
+
+/**
+ * Numbers are validated to the JSON grammar and kept as their literal text,
+ * which is what the ptree reader stores and what get<T>() later converts.
+ */
+inline
+void json::Parser::parse_number(std::string &dst)
+{
+	const auto start(pos);
+	const auto digits([this]
+	{
+		const auto start(pos);
+		while(!eof() && *pos >= '0' && *pos <= '9')
+			++pos;
+
+		return pos - start;
+	});
+
+	if(peek() == '-')
+		++pos;
+
+	if(peek() == '0')
+		++pos;
+	else if(!digits())
+		error("expected digits after -");
+
+	if(peek() == '.')
+	{
+		++pos;
+		if(!digits())
+			error("need at least one digit after '.'");
+	}
+
+	if(peek() == 'e' || peek() == 'E')
+	{
+		++pos;
+		if(peek() == '+' || peek() == '-')
+			++pos;
+
+		if(!digits())
+			error("need at least one digit in exponent");
+	}
+
+	dst.assign(start,pos);
+}
+
+
+inline
+void json::Parser::parse_string(std::string &dst)
+{
+	const auto &cls(json::cls());
+
+	expect('"',"expected '\"'");
+	while(1)
+	{
+		const auto run(pos);
+		while(pos != end && cls[uint8_t(*pos)] == PLAIN)
+			++pos;
+
+		dst.append(run,pos);
+		if(eof())
+			error("unterminated string");
+
+		switch(cls[uint8_t(*pos++)])
+		{
+			case QUOTE:
+				return;
+
+			case CTRL:
+				error("invalid code sequence");
+
+			case ESCAPE:
+				if(eof())
+					error("invalid escape sequence");
+
+				switch(*pos++)
+				{
+					case '"':   dst.push_back('"');    break;
+					case '\\':  dst.push_back('\\');   break;
+					case '/':   dst.push_back('/');    break;
+					case 'b':   dst.push_back('\b');   break;
+					case 'f':   dst.push_back('\f');   break;
+					case 'n':   dst.push_back('\n');   break;
+					case 'r':   dst.push_back('\r');   break;
+					case 't':   dst.push_back('\t');   break;
+					case 'u':   parse_codepoint(dst);  break;
+					default:    error("invalid escape sequence");
+				}
+				continue;
+
+			default:
+				continue;
+		}
+	}
+}
+
+
+inline
+void json::Parser::parse_codepoint(std::string &dst)
+{
+	const auto hex4([this]
+	{
+		if(end - pos < 4)
+			error("invalid escape sequence");
+
+		uint32_t ret(0);
+		for(size_t i(0); i < 4; ++i, ++pos)
+		{
+			const char &c(*pos);
+			ret <<= 4;
+			if(c >= '0' && c <= '9')       ret |= c - '0';
+			else if(c >= 'a' && c <= 'f')  ret |= c - 'a' + 10;
+			else if(c >= 'A' && c <= 'F')  ret |= c - 'A' + 10;
+			else error("invalid escape sequence");
+		}
+
+		return ret;
+	});
+
+	uint32_t cp(hex4());
+	if(cp >= 0xDC00 && cp <= 0xDFFF)
+		error("invalid codepoint, stray low surrogate");
+
+	if(cp >= 0xD800 && cp <= 0xDBFF)
+	{
+		if(end - pos < 2 || pos[0] != '\\' || pos[1] != 'u')
+			error("expected codepoint reference after high surrogate");
+
+		pos += 2;
+		const uint32_t lo(hex4());
+		if(lo < 0xDC00 || lo > 0xDFFF)
+			error("expected low surrogate after high surrogate");
+
+		cp = 0x10000 + ((cp & 0x3FF) << 10) + (lo & 0x3FF);
+	}
+
+	if(cp < 0x80)
+		dst.push_back(char(cp));
+	else if(cp < 0x800)
+	{
+		dst.push_back(char(0xC0 | (cp >> 6)));
+		dst.push_back(char(0x80 | (cp & 0x3F)));
+	}
+	else if(cp < 0x10000)
+	{
+		dst.push_back(char(0xE0 | (cp >> 12)));
+		dst.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+		dst.push_back(char(0x80 | (cp & 0x3F)));
+	}
+	else
+	{
+		dst.push_back(char(0xF0 | (cp >> 18)));
+		dst.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+		dst.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+		dst.push_back(char(0x80 | (cp & 0x3F)));
+	}
+}
+
+
+inline
+void json::Parser::skip_ws()
+{
+	while(!eof() && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r'))
+		++pos;
+}
+
+
+inline
+void json::Parser::expect(const char *const &lit,
+                          const char *const &msg)
+{
+	const size_t len(strlen(lit));
+	if(size_t(end - pos) < len || memcmp(pos,lit,len) != 0)
+		error(msg);
+
+	pos += len;
+}
+
+
+inline
+void json::Parser::expect(const char &c,
+                          const char *const &msg)
+{
+	if(eof() || *pos != c)
+		error(msg);
+
+	++pos;
+}
+
+
+inline
+void json::Parser::error(const char *const &msg)
+const
+{
+	const auto line(1 + std::count(beg,pos,'\n'));
+	throw Exception("<unspecified file>(") << line << "): " << msg;
+}
+
+
+/**
+ * Output matches write_json(s,src,false) including the trailing newline.
+ */
+inline
+std::string &json::write(std::string &dst,
+                         const ptree &src)
+{
+	if(!src.data().empty())
+		throw Exception("<unspecified file>: ptree contains data that cannot be represented in JSON format");
+
+	write_object(dst,src);
+	dst.push_back('\n');
+	return dst;
+}
+
+
+inline
+void json::write_value(std::string &dst,
+                       const ptree &src)
+{
+	if(src.empty())
+	{
+		write_string(dst,src.data());
+		return;
+	}
+
+	if(!src.data().empty())
+		throw Exception("<unspecified file>: ptree contains data that cannot be represented in JSON format");
+
+	const bool array(std::all_of(src.begin(),src.end(),[]
+	(const auto &pair)
+	{
+		return pair.first.empty();
+	}));
+
+	if(array)
+		write_array(dst,src);
+	else
+		write_object(dst,src);
+}
+
+
+inline
+void json::write_object(std::string &dst,
+                        const ptree &src)
+{
+	dst.push_back('{');
+	for(auto it(src.begin()); it != src.end(); ++it)
+	{
+		if(it != src.begin())
+			dst.push_back(',');
+
+		write_string(dst,it->first);
+		dst.push_back(':');
+		write_value(dst,it->second);
+	}
+	dst.push_back('}');
+}
+
+
+inline
+void json::write_array(std::string &dst,
+                       const ptree &src)
+{
+	dst.push_back('[');
+	for(auto it(src.begin()); it != src.end(); ++it)
+	{
+		if(it != src.begin())
+			dst.push_back(',');
+
+		write_value(dst,it->second);
+	}
+	dst.push_back(']');
+}
+
+
+/**
+ * Escapes as boost's create_escapes(): additionally '/' is escaped and all other
+ * control characters become \u00XX; bytes >= 0x80 pass through untouched.
+ */
+inline
+void json::write_string(std::string &dst,
+                        const std::string &str)
+{
+	static const char hex[] {"0123456789ABCDEF"};
+	const auto &cls(json::cls());
+
+	dst.push_back('"');
+	auto pos(str.data());
+	const auto end(str.data() + str.size());
+	while(1)
+	{
+		const auto run(pos);
+		while(pos != end && cls[uint8_t(*pos)] == PLAIN && *pos != '/')
+			++pos;
+
+		dst.append(run,pos);
+		if(pos == end)
+			break;
+
+		const char c(*pos++);
+		switch(c)
+		{
+			case '"':   dst.append("\\\"");   break;
+			case '\\':  dst.append("\\\\");   break;
+			case '/':   dst.append("\\/");    break;
+			case '\b':  dst.append("\\b");    break;
+			case '\f':  dst.append("\\f");    break;
+			case '\n':  dst.append("\\n");    break;
+			case '\r':  dst.append("\\r");    break;
+			case '\t':  dst.append("\\t");    break;
+			default:
+				dst.append("\\u00");
+				dst.push_back(hex[uint8_t(c) >> 4]);
+				dst.push_back(hex[uint8_t(c) & 0xF]);
+				break;
+		}
+	}
+	dst.push_back('"');
+}
@@ -28,25 +28,32 @@ struct Locutor : Stream
 	static const MethodEx DEFAULT_METHODEX              { NONE                                       };
 
   private:
+	const Context *ctx;                                 // Bot this locutor speaks through
 	Method meth;                                        // Stream state for current method
 	MethodEx methex;                                    // Stream state for extension to method
 	colors::FG fg;                                      // Stream state for foreground color
 	std::string target;
 	Throttle throttle;
+	Bound bound;                                        // opts target-max/target-policy
 
   public:
+	auto &get_ctx() const                               { return *ctx;                               }
 	auto &get_meth() const                              { return meth;                               }
 	auto &get_methex() const                            { return methex;                             }
 	auto &get_target() const                            { return target;                             }
-	auto &get_my_nick() const                           { return get_sess().get_nick();              }
+	auto &get_my_nick() const                           { return get_ctx().get_sess().get_nick();    }
 	auto &get_throttle() const                          { return throttle;                           }
+	auto &get_bound() const                             { return bound;                              }
+	size_t get_depth() const;                           // lines waiting on this target's throttle
 
 	void set_target(const std::string &target)          { this->target = target;                     }
 	void reset();
 
   protected:
 	auto &get_throttle()                                { return throttle;                           }
+	auto &get_bound()                                   { return bound;                              }
 	void msg(const char *const &cmd);
+	void line(const char *const &cmd, const std::string &str);
 
   public:
 	// [SEND] stream interface                          // Defaults back to DEFAULT_METHOD after flush
@@ -61,9 +68,11 @@ struct Locutor : Stream
 	// [SEND] Controls / Utils
 	void mode(const std::string &mode);                 // Raw mode command
 	void mode(const Deltas &deltas);                    // Execute any number of deltas
-	void whois();                                       // Sends whois query
+	void whois(const Pending::Callback &cb = nullptr);  // Sends whois query (cb with the replies)
+	std::future<Pending::Reply> whois_async();          // Not to be waited on by a handler
 	void mode();                                        // Sends mode query
 
+	Locutor(const Context &ctx, const std::string &target);
 	explicit Locutor(const std::string &target);
 	virtual ~Locutor() = default;
 };
@@ -71,11 +80,21 @@ struct Locutor : Stream
 
 inline
 Locutor::Locutor(const std::string &target):
+Locutor(bot::get_ctx(),target)
+{
+}
+
+
+inline
+Locutor::Locutor(const Context &ctx,
+                 const std::string &target):
+ctx(&ctx),
 meth(DEFAULT_METHOD),
 methex(DEFAULT_METHODEX),
 fg(colors::FG::BLACK),
 target(target),
-throttle(get_opts().get<uint>("throttle-msg"))
+throttle(ctx.get_sess().get_opts().get<uint>("throttle-msg")),
+bound(ctx.get_sess().get_opts(),"target")
 {
 }
 
@@ -83,21 +102,39 @@ throttle(get_opts().get<uint>("throttle-msg"))
 inline
 void Locutor::mode()
 {
-	Quote("MODE") << get_target();
+	Quote(get_ctx(),"MODE") << get_target();
+}
+
+
+inline
+void Locutor::whois(const Pending::Callback &cb)
+{
+	static const Pending::Numerics replies
+	{
+		RPL_AWAY, RPL_WHOISUSER, RPL_WHOISSERVER, RPL_WHOISOPERATOR, RPL_WHOISIDLE,
+		RPL_WHOISCHANNELS, RPL_WHOISLOGGEDIN, RPL_WHOISSECURE, RPL_WHOISACTUALLY, ERR_NOSUCHNICK,
+	};
+
+	if(cb)
+		get_ctx().get_pending().add({get_target(),replies,{RPL_ENDOFWHOIS},cb});
+
+	Quote(get_ctx(),"WHOIS") << get_target();
 }
 
 
 inline
-void Locutor::whois()
+std::future<Pending::Reply> Locutor::whois_async()
 {
-	Quote("WHOIS") << get_target();
+	auto p(Pending::promise());
+	whois(p.first);
+	return std::move(p.second);
 }
 
 
 inline
 void Locutor::mode(const Deltas &deltas)
 {
-	auto &sess(get_sess());
+	auto &sess(get_ctx().get_sess());
 	const auto &isup(sess.get_isupport());
 	const size_t max(isup.get("MODES",3));
 
@@ -113,7 +150,7 @@ void Locutor::mode(const Deltas &deltas)
 inline
 void Locutor::mode(const std::string &str)
 {
-	Quote("MODE") << get_target() << " " << str;
+	Quote(get_ctx(),"MODE") << get_target() << " " << str;
 }
 
 
@@ -187,7 +224,6 @@ Locutor &Locutor::operator<<(const flush_t)
 inline
 void Locutor::msg(const char *const &cmd)
 {
-	auto &throttle(get_throttle());
 	const auto toks(tokens(packetize(get_str()),"\n"));
 
 	switch(methex)
@@ -197,7 +233,7 @@ void Locutor::msg(const char *const &cmd)
 		{
 			const auto prefix(methex == WALLCHOPS? '@' : '+');
 			for(const auto &token : toks)
-				Quote(cmd,throttle.next()) << prefix << get_target() << " :" << token;
+				line(cmd,prefix + get_target() + " :" + token);
 
 			break;
 		}
@@ -206,7 +242,7 @@ void Locutor::msg(const char *const &cmd)
 		{
 			const auto &chan(toks.at(0));
 			for(auto it(toks.begin()+1); it != toks.end(); ++it)
-				Quote(cmd,throttle.next()) << get_target() << " "  << chan << " :" << *it;
+				line(cmd,get_target() + " " + chan + " :" + *it);
 
 			break;
 		}
@@ -215,7 +251,7 @@ void Locutor::msg(const char *const &cmd)
 		default:
 		{
 			for(const auto &token : toks)
-				Quote(cmd,throttle.next()) << get_target() << " :" << token;
+				line(cmd,get_target() + " :" + token);
 
 			break;
 		}
@@ -223,6 +259,70 @@ void Locutor::msg(const char *const &cmd)
 }
 
 
+/**
+ * Sends one line at this target's pace. When target-max lines are already
+ * waiting, the policy applies to the lines for this target alone: they are
+ * found in sendq by command and target.
+ */
+inline
+void Locutor::line(const char *const &cmd,
+                   const std::string &str)
+{
+	using namespace std::chrono;
+
+	auto &throttle(get_throttle());
+	if(!bound.full(get_depth()))
+	{
+		Quote(get_ctx(),cmd,throttle.next()) << str;
+		return;
+	}
+
+	const auto &sd(get_ctx().get_sess().get_socket().get_sd());
+	const auto pck(std::string(cmd) + " " + str);
+	time_point slot;
+	switch(bound.policy)
+	{
+		case Overflow::REJECT:
+			bound.rejected++;
+			throw Exception("Too many lines waiting for ") << get_target();
+
+		case Overflow::COALESCE:
+			if(sendq::has(&sd,pck))
+			{
+				bound.dropped++;
+				return;
+			}
+			// fallthrough
+
+		case Overflow::DROP_OLDEST:
+			if(!sendq::shift(&sd,{pck.substr(0,pck.find(" :") + 1)},slot))
+			{
+				Quote(get_ctx(),cmd,throttle.next()) << str;
+				return;
+			}
+
+			// The freed slot is taken as is; the throttle isn't advanced
+			bound.dropped++;
+			Quote(get_ctx(),cmd,std::max(duration_cast<milliseconds>(slot - steady_clock::now()),1ms)) << str;
+			return;
+
+		case Overflow::DROP_NEWEST:
+		default:
+			bound.dropped++;
+			return;
+	}
+}
+
+
+inline
+size_t Locutor::get_depth()
+const
+{
+	const auto &inc(throttle.get_inc());
+	return inc > 0ms? throttle.calc_rel() / inc : 0;
+}
+
+
 inline
 void Locutor::reset()
 {
@@ -277,40 +377,40 @@ bool operator>(const Locutor &a, const Locutor &b)
 inline
 bool operator==(const Locutor &a, const std::string &b)
 {
-	return tolower(a.get_target()) == tolower(b);
+	return iequals(a.get_target(),b);
 }
 
 
 inline
 bool operator!=(const Locutor &a, const std::string &b)
 {
-	return tolower(a.get_target()) != tolower(b);
+	return !iequals(a.get_target(),b);
 }
 
 
 inline
 bool operator<=(const Locutor &a, const std::string &b)
 {
-	return tolower(a.get_target()) <= tolower(b);
+	return !iless(b,a.get_target());
 }
 
 
 inline
 bool operator>=(const Locutor &a, const std::string &b)
 {
-	return tolower(a.get_target()) >= tolower(b);
+	return !iless(a.get_target(),b);
 }
 
 
 inline
 bool operator<(const Locutor &a, const std::string &b)
 {
-	return tolower(a.get_target()) < tolower(b);
+	return iless(a.get_target(),b);
 }
 
 
 inline
 bool operator>(const Locutor &a, const std::string &b)
 {
-	return tolower(a.get_target()) > tolower(b);
+	return iless(b,a.get_target());
 }
@@ -146,68 +146,68 @@ bool operator!=(const Mask &a, const Mask &b)
 inline
 bool operator<=(const Mask &a, const Mask &b)
 {
-	return a == b || tolower(a) <= tolower(b);
+	return a == b || !iless(b,a);
 }
 
 
 inline
 bool operator>=(const Mask &a, const Mask &b)
 {
-	return a == b || tolower(a) >= tolower(b);
+	return a == b || !iless(a,b);
 }
 
 
 inline
 bool operator<(const Mask &a, const Mask &b)
 {
-	return a != b && tolower(a) < tolower(b);
+	return a != b && iless(a,b);
 }
 
 
 inline
 bool operator>(const Mask &a, const Mask &b)
 {
-	return a != b && tolower(a) > tolower(b);
+	return a != b && iless(b,a);
 }
 
 
 inline
 bool operator==(const Mask &a, const std::string &b)
 {
-	return tolower(a) == tolower(b);
+	return iequals(a,b);
 }
 
 
 inline
 bool operator!=(const Mask &a, const std::string &b)
 {
-	return tolower(a) != tolower(b);
+	return !iequals(a,b);
 }
 
 
 inline
 bool operator<=(const Mask &a, const std::string &b)
 {
-	return tolower(a) <= tolower(b);
+	return !iless(b,a);
 }
 
 
 inline
 bool operator>=(const Mask &a, const std::string &b)
 {
-	return tolower(a) >= tolower(b);
+	return !iless(a,b);
 }
 
 
 inline
 bool operator<(const Mask &a, const std::string &b)
 {
-	return tolower(a) < tolower(b);
+	return iless(a,b);
 }
 
 
 inline
 bool operator>(const Mask &a, const std::string &b)
 {
-	return tolower(a) > tolower(b);
+	return iless(b,a);
 }
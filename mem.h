@@ -0,0 +1,187 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Memory of one Bot's state, pooled and counted.
+ *
+ * The containers of its users, channels, memberships, lists and service
+ * captures allocate their nodes here (see: Alloc). Nodes up to 256 bytes come
+ * from a free list per 16 byte size class, carved out of 64KiB blocks, so the
+ * bots of a process don't contend in malloc for them and a bot's nodes sit
+ * together. A freed node goes back on its list for the next of its size; the
+ * blocks are returned when the Mem is destroyed. Larger requests (bucket arrays)
+ * go to operator new and are counted all the same.
+ *
+ * Not thread-safe: it is used where the Bot's state is, on its thread or under
+ * its lock.
+ */
+class Mem
+{
+	static constexpr size_t ALIGN = 16;
+	static constexpr size_t CLASSES = 16;             // of ALIGN bytes each, up to 256
+	static constexpr size_t BLOCK = 64 * 1024;
+
+	struct Free
+	{
+		Free *next;
+	};
+
+	std::array<Free *,CLASSES> free;
+	std::vector<std::unique_ptr<uint8_t[]>> blocks;
+	uint8_t *pos;                                     // unused remainder of the last block
+	uint8_t *end;
+	size_t used;                                      // bytes of live allocations, by size class
+	size_t large;                                     // of which from operator new
+	size_t allocs;                                    // live allocations
+
+	static size_t size_class(const size_t &bytes)     { return (bytes + ALIGN - 1) / ALIGN - 1;   }
+
+  public:
+	auto &get_used() const                            { return used;                              }
+	auto &get_allocs() const                          { return allocs;                            }
+	size_t get_reserved() const                       { return blocks.size() * BLOCK + large;     }
+
+	void *allocate(const size_t &bytes);
+	void deallocate(void *const &ptr, const size_t &bytes) noexcept;
+
+	Mem();
+	Mem(Mem &&) = delete;
+	Mem(const Mem &) = delete;
+	Mem &operator=(Mem &&) = delete;
+	Mem &operator=(const Mem &) = delete;
+};
+
+
+inline
+Mem::Mem():
+free{},
+pos(nullptr),
+end(nullptr),
+used(0),
+large(0),
+allocs(0)
+{
+}
+
+
+inline
+void *Mem::allocate(const size_t &bytes)
+{
+	if(bytes > CLASSES * ALIGN)
+	{
+		const auto ret(::operator new(bytes));
+		used += bytes;
+		large += bytes;
+		++allocs;
+		return ret;
+	}
+
+	const auto cls(size_class(bytes));
+	const auto size((cls + 1) * ALIGN);
+	void *ret;
+	if(free[cls])
+	{
+		ret = free[cls];
+		free[cls] = free[cls]->next;
+	}
+	else
+	{
+		if(size_t(end - pos) < size)
+		{
+			blocks.emplace_back(new uint8_t[BLOCK]);
+			pos = blocks.back().get();
+			end = pos + BLOCK;
+		}
+
+		ret = pos;
+		pos += size;
+	}
+
+	used += size;
+	++allocs;
+	return ret;
+}
+
+
+inline
+void Mem::deallocate(void *const &ptr,
+                     const size_t &bytes)
+noexcept
+{
+	--allocs;
+	if(bytes > CLASSES * ALIGN)
+	{
+		::operator delete(ptr);
+		used -= bytes;
+		large -= bytes;
+		return;
+	}
+
+	const auto cls(size_class(bytes));
+	const auto node(static_cast<Free *>(ptr));
+	node->next = free[cls];
+	free[cls] = node;
+	used -= (cls + 1) * ALIGN;
+}
+
+
+/**
+ * Allocator of a container's nodes from a Mem; without one (default) it is
+ * std::allocator. A copy of the container is not allocated from the Mem of
+ * the original: it may be taken elsewhere, e.g handed to another thread.
+ */
+template<class T>
+struct Alloc
+{
+	using value_type = T;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	Mem *mem;
+
+	T *allocate(const size_t n);
+	void deallocate(T *const p, const size_t n) noexcept;
+	Alloc select_on_container_copy_construction() const  { return {};                         }
+
+	template<class U> Alloc(const Alloc<U> &o) noexcept: mem(o.mem) {}
+	Alloc(Mem *const &mem = nullptr) noexcept: mem(mem) {}
+};
+
+
+template<class T>
+T *Alloc<T>::allocate(const size_t n)
+{
+	const auto bytes(n * sizeof(T));
+	return static_cast<T *>(mem? mem->allocate(bytes) : ::operator new(bytes));
+}
+
+
+template<class T>
+void Alloc<T>::deallocate(T *const p,
+                          const size_t n)
+noexcept
+{
+	if(mem)
+		mem->deallocate(p,n * sizeof(T));
+	else
+		::operator delete(p);
+}
+
+
+template<class T, class U>
+bool operator==(const Alloc<T> &a, const Alloc<U> &b)
+{
+	return a.mem == b.mem;
+}
+
+
+template<class T, class U>
+bool operator!=(const Alloc<T> &a, const Alloc<U> &b)
+{
+	return a.mem != b.mem;
+}
@@ -0,0 +1,571 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Process-wide metrics: counters, histograms of durations and gauges.
+ *
+ * A series is registered once by family and labels and is then recorded by
+ * its id. Every thread records into its own shard, so recording takes no lock
+ * and shares no cache line with another thread; a read merges all shards. The
+ * shards of threads which have exited are kept, so nothing counted is lost.
+ *
+ * Histograms have log-linear buckets (as HDR histograms): 16 per power of two,
+ * so any duration from 1ns to 2^40ns (~18 minutes) is within 6.25%.
+ *
+ * Gauges are functions evaluated at read. write() produces the Prometheus text
+ * format; it can be written out periodically to a file or served to whoever
+ * connects to a Unix socket (see: Bot opts metrics-file, metrics-socket).
+ */
+class Metrics
+{
+  public:
+	using nanoseconds = std::chrono::nanoseconds;
+	using Gauge = std::function<double ()>;
+
+	enum Type { COUNTER, HISTOGRAM };
+
+	struct Hist
+	{
+		static constexpr size_t SUB = 16;             // buckets per power of two
+		static constexpr size_t SUB_BITS = 4;
+		static constexpr size_t MAX_BITS = 40;        // top power of two; longer is clamped
+		static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 2) * SUB;
+
+		std::array<uint64_t,BUCKETS> counts;
+		uint64_t sum;                                 // ns
+		uint64_t count;
+
+		static size_t bucket(uint64_t ns);
+		static uint64_t lower(const size_t &bucket);  // least ns in the bucket
+		uint64_t quantile(const double &q) const;     // ns
+
+		Hist &operator+=(const Hist &o);
+		Hist(): counts{}, sum(0), count(0) {}
+	};
+
+	struct Timer                                     // Records its lifetime to a HISTOGRAM
+	{
+		size_t id;
+		time_point start;
+
+		Timer(const size_t &id): id(id), start(steady_clock::now()) {}
+		~Timer() { record(id,steady_clock::now() - start); }
+	};
+
+  private:
+	struct Series
+	{
+		std::string family;
+		std::string help;
+		std::string labels;                           // e.g. op="get"
+		Type type;
+	};
+
+	struct Cell
+	{
+		std::atomic<uint64_t> value {0};
+		std::unique_ptr<std::array<std::atomic<uint64_t>,Hist::BUCKETS + 1>> hist;   // + sum
+	};
+
+	struct Shard : std::mutex                         // owner grows it; readers lock
+	{
+		std::vector<std::unique_ptr<Cell>> cells;     // by id
+	};
+
+	static std::mutex mutex;                          // bot.cpp
+	static std::vector<Series> series;                // bot.cpp; by id
+	static std::map<std::string,size_t> ids;          // bot.cpp; by family{labels}
+	static std::list<Shard> shards;                   // bot.cpp
+	static std::map<std::string,std::pair<std::string,Gauge>> gauges;    // bot.cpp; help and value
+	static thread_local Shard *local;                 // bot.cpp
+
+	struct Exporter;
+	static std::unique_ptr<Exporter> exporter;        // bot.cpp; started by dump() or serve()
+
+	static Cell &cell(const size_t &id);
+	static std::string format_le(const uint64_t &ns);
+	static Exporter &get_exporter();
+
+  public:
+	static size_t size();                             // series registered
+
+	// Registration (No lock required); the same family and labels give the same id
+	static size_t id(const std::string &family, const std::string &help, const Type &type, const std::string &labels = {});
+	static void gauge(const std::string &family, const std::string &help, const Gauge &func);
+
+	// Recording (No lock required)
+	static void count(const size_t &id, const uint64_t &n = 1);
+	static void record(const size_t &id, const nanoseconds &dur);
+
+	// Reading (No lock required)
+	static uint64_t value(const size_t &id);          // COUNTER merged over threads
+	static Hist hist(const size_t &id);               // HISTOGRAM merged over threads
+	static void write(std::ostream &s);               // Prometheus text format
+	static void dump(const std::string &path);        // write() to a temp file renamed over path
+
+	// Export from a thread of its own; again for the same path does nothing (No lock required)
+	static void every(const std::string &path, const milliseconds &interval, const std::function<void ()> &func);
+	static void dump(const std::string &path, const milliseconds &interval);
+	static void serve(const std::string &path);       // write() to each connection on a Unix socket
+};
+
+
+struct Metrics::Exporter
+{
+	using local = boost::asio::local::stream_protocol;
+
+	boost::asio::io_service ios;
+	std::map<std::string,std::unique_ptr<boost::asio::steady_timer>> timers;
+	std::map<std::string,std::unique_ptr<local::acceptor>> acceptors;
+	std::thread thread;
+
+	void handle_timer(const boost::system::error_code &e, const std::string &path, const milliseconds &interval, const std::function<void ()> &func);
+	void accept(local::acceptor &acceptor);
+
+	Exporter();
+	~Exporter() noexcept;
+};
+
+
+inline
+Metrics::Exporter::Exporter():
+thread([this]
+{
+	const boost::asio::io_service::work work(ios);
+	ios.run();
+})
+{
+}
+
+
+inline
+Metrics::Exporter::~Exporter()
+noexcept
+{
+	ios.stop();
+	thread.join();
+}
+
+
+inline
+void Metrics::Exporter::handle_timer(const boost::system::error_code &e,
+                                     const std::string &path,
+                                     const milliseconds &interval,
+                                     const std::function<void ()> &func)
+{
+	if(e == boost::asio::error::operation_aborted)
+		return;
+
+	try
+	{
+		func();
+	}
+	catch(const std::exception &e)
+	{
+		std::cerr << "\033[1;31m[metrics]: " << path << ": " << e.what() << "\033[0m" << std::endl;
+	}
+
+	auto &timer(*timers.at(path));
+	timer.expires_from_now(interval);
+	timer.async_wait(std::bind(&Exporter::handle_timer,this,std::placeholders::_1,path,interval,func));
+}
+
+
+/**
+ * The snapshot is written whole before the connection is closed; a reader
+ * sees it end at EOF (e.g socat - UNIX-CONNECT:path).
+ */
+inline
+void Metrics::Exporter::accept(local::acceptor &acceptor)
+{
+	const auto sd(std::make_shared<local::socket>(ios));
+	acceptor.async_accept(*sd,[this,&acceptor,sd]
+	(const boost::system::error_code &e)
+	{
+		if(e == boost::asio::error::operation_aborted)
+			return;
+
+		if(!e)
+		{
+			std::ostringstream s;
+			Metrics::write(s);
+			const auto buf(std::make_shared<std::string>(s.str()));
+			boost::asio::async_write(*sd,boost::asio::buffer(*buf),[sd,buf]
+			(const boost::system::error_code &e, const size_t &size)
+			{
+				boost::system::error_code ec;
+				sd->close(ec);
+			});
+		}
+
+		accept(acceptor);
+	});
+}
+
+
+inline
+Metrics::Exporter &Metrics::get_exporter()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	if(!exporter)
+		exporter = std::make_unique<Exporter>();
+
+	return *exporter;
+}
+
+
+/**
+ * For any file written periodically from the exporter's thread; func is only
+ * ever called there, one at a time.
+ */
+inline
+void Metrics::every(const std::string &path,
+                    const milliseconds &interval,
+                    const std::function<void ()> &func)
+{
+	auto &ex(get_exporter());
+	ex.ios.post([&ex,path,interval,func]
+	{
+		if(ex.timers.count(path))
+			return;
+
+		auto &timer(*ex.timers.emplace(path,std::make_unique<boost::asio::steady_timer>(ex.ios)).first->second);
+		timer.expires_from_now(interval);
+		timer.async_wait(std::bind(&Exporter::handle_timer,&ex,std::placeholders::_1,path,interval,func));
+	});
+}
+
+
+inline
+void Metrics::dump(const std::string &path,
+                   const milliseconds &interval)
+{
+	every(path,interval,[path]
+	{
+		dump(path);
+	});
+}
+
+
+/**
+ * A stale socket file at path (of a process that's gone) is replaced.
+ */
+inline
+void Metrics::serve(const std::string &path)
+{
+	auto &ex(get_exporter());
+	ex.ios.post([&ex,path]
+	{
+		if(ex.acceptors.count(path))
+			return;
+
+		try
+		{
+			::unlink(path.c_str());
+			auto acceptor(std::make_unique<Exporter::local::acceptor>(ex.ios,Exporter::local::endpoint(path)));
+			ex.accept(*acceptor);
+			ex.acceptors.emplace(path,std::move(acceptor));
+		}
+		catch(const boost::system::system_error &e)
+		{
+			std::cerr << "\033[1;31m[metrics]: " << path << ": " << e.what() << "\033[0m" << std::endl;
+		}
+	});
+}
+
+
+inline
+size_t Metrics::id(const std::string &family,
+                   const std::string &help,
+                   const Type &type,
+                   const std::string &labels)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	const auto key(family + "{" + labels + "}");
+	const auto it(ids.find(key));
+	if(it != ids.end())
+		return it->second;
+
+	series.push_back({family,help,labels,type});
+	ids.emplace(key,series.size() - 1);
+	return series.size() - 1;
+}
+
+
+inline
+void Metrics::gauge(const std::string &family,
+                    const std::string &help,
+                    const Gauge &func)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	gauges[family] = {help,func};
+}
+
+
+inline
+size_t Metrics::size()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	return series.size();
+}
+
+
+inline
+void Metrics::count(const size_t &id,
+                    const uint64_t &n)
+{
+	auto &c(cell(id));
+	c.value.store(c.value.load(std::memory_order_relaxed) + n,std::memory_order_relaxed);
+}
+
+
+/**
+ * Only the owning thread writes its shard, so a load and a store do; readers
+ * may see a count and its sum from either side of a record.
+ */
+inline
+void Metrics::record(const size_t &id,
+                     const nanoseconds &dur)
+{
+	auto &c(cell(id));
+	if(!c.hist)
+		return;
+
+	auto &h(*c.hist);
+	const uint64_t ns(std::max(dur.count(),decltype(dur.count())(0)));
+	auto &b(h[Hist::bucket(ns)]);
+	b.store(b.load(std::memory_order_relaxed) + 1,std::memory_order_relaxed);
+	h[Hist::BUCKETS].store(h[Hist::BUCKETS].load(std::memory_order_relaxed) + ns,std::memory_order_relaxed);
+	c.value.store(c.value.load(std::memory_order_relaxed) + 1,std::memory_order_relaxed);
+}
+
+
+inline
+Metrics::Cell &Metrics::cell(const size_t &id)
+{
+	if(!local)
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		shards.emplace_back();
+		local = &shards.back();
+	}
+
+	auto &cells(local->cells);
+	if(id < cells.size() && cells[id])
+		return *cells[id];
+
+	Type type;
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		type = series.at(id).type;
+	}
+
+	auto c(std::make_unique<Cell>());
+	if(type == HISTOGRAM)
+	{
+		c->hist = std::make_unique<std::array<std::atomic<uint64_t>,Hist::BUCKETS + 1>>();
+		for(auto &b : *c->hist)
+			b.store(0,std::memory_order_relaxed);
+	}
+
+	const std::lock_guard<Shard> lock(*local);
+	if(cells.size() <= id)
+		cells.resize(id + 1);
+
+	cells[id] = std::move(c);
+	return *cells[id];
+}
+
+
+inline
+uint64_t Metrics::value(const size_t &id)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	uint64_t ret(0);
+	for(auto &shard : shards)
+	{
+		const std::lock_guard<Shard> lock(shard);
+		if(id < shard.cells.size() && shard.cells[id])
+			ret += shard.cells[id]->value.load(std::memory_order_relaxed);
+	}
+
+	return ret;
+}
+
+
+inline
+Metrics::Hist Metrics::hist(const size_t &id)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	Hist ret;
+	for(auto &shard : shards)
+	{
+		const std::lock_guard<Shard> lock(shard);
+		if(id >= shard.cells.size() || !shard.cells[id] || !shard.cells[id]->hist)
+			continue;
+
+		const auto &h(*shard.cells[id]->hist);
+		for(size_t i(0); i < Hist::BUCKETS; i++)
+			ret.counts[i] += h[i].load(std::memory_order_relaxed);
+
+		ret.sum += h[Hist::BUCKETS].load(std::memory_order_relaxed);
+		ret.count += shard.cells[id]->value.load(std::memory_order_relaxed);
+	}
+
+	return ret;
+}
+
+
+/**
+ * Histogram buckets are exported at every other power of two from 1024ns
+ * (~1us) to 2^34ns (~17s), which fall on bucket boundaries.
+ */
+inline
+void Metrics::write(std::ostream &s)
+{
+	std::vector<Series> all;
+	std::map<std::string,std::pair<std::string,Gauge>> gs;
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		all = series;
+		gs = gauges;
+	}
+
+	// Families are written together, whatever order their series registered in
+	std::vector<size_t> order(all.size());
+	std::iota(order.begin(),order.end(),0);
+	std::stable_sort(order.begin(),order.end(),[&all]
+	(const size_t &a, const size_t &b)
+	{
+		return all[a].family < all[b].family;
+	});
+
+	const auto sep([](const std::string &labels)
+	{
+		return labels.empty()? std::string{} : labels + ",";
+	});
+
+	std::string last;
+	for(const auto &id : order)
+	{
+		const auto &ser(all[id]);
+		if(ser.family != last)
+		{
+			s << "# HELP " << ser.family << " " << ser.help << "\n";
+			s << "# TYPE " << ser.family << " " << (ser.type == HISTOGRAM? "histogram" : "counter") << "\n";
+			last = ser.family;
+		}
+
+		if(ser.type == COUNTER)
+		{
+			s << ser.family << "{" << ser.labels << "} " << value(id) << "\n";
+			continue;
+		}
+
+		const auto h(hist(id));
+		uint64_t cum(0);
+		size_t i(0);
+		for(size_t p(10); p <= 34; p += 2)
+		{
+			const uint64_t le(uint64_t(1) << p);
+			for(; i < Hist::BUCKETS && Hist::lower(i) < le; i++)
+				cum += h.counts[i];
+
+			s << ser.family << "_bucket{" << sep(ser.labels) << "le=\"" << format_le(le) << "\"} " << cum << "\n";
+		}
+
+		s << ser.family << "_bucket{" << sep(ser.labels) << "le=\"+Inf\"} " << h.count << "\n";
+		s << ser.family << "_sum{" << ser.labels << "} " << format_le(h.sum) << "\n";
+		s << ser.family << "_count{" << ser.labels << "} " << h.count << "\n";
+	}
+
+	for(const auto &p : gs)
+	{
+		s << "# HELP " << p.first << " " << p.second.first << "\n";
+		s << "# TYPE " << p.first << " gauge\n";
+		s << p.first << " " << p.second.second() << "\n";
+	}
+
+	s << std::flush;
+}
+
+
+inline
+void Metrics::dump(const std::string &path)
+{
+	const auto tmp(path + ".tmp");
+	{
+		std::ofstream file(tmp,std::ios::out | std::ios::trunc);
+		if(!file.is_open())
+			throw Exception("Failed to open metrics file: ") << tmp;
+
+		write(file);
+	}
+
+	if(::rename(tmp.c_str(),path.c_str()) < 0)
+		throw Exception("Failed to replace metrics file: ") << path << ": " << strerror(errno);
+}
+
+
+inline
+std::string Metrics::format_le(const uint64_t &ns)
+{
+	std::ostringstream s;
+	s << std::setprecision(9) << (ns / 1e9);
+	return s.str();
+}
+
+
+inline
+size_t Metrics::Hist::bucket(uint64_t ns)
+{
+	if(ns < SUB)
+		return ns;
+
+	ns = std::min(ns,(uint64_t(SUB * 2) << (MAX_BITS - SUB_BITS)) - 1);
+	const size_t bits(63 - __builtin_clzll(ns));      // floor(log2(ns)) >= SUB_BITS
+	const size_t shift(bits - SUB_BITS);
+	return (shift + 1) * SUB + ((ns >> shift) - SUB);
+}
+
+
+inline
+uint64_t Metrics::Hist::lower(const size_t &bucket)
+{
+	if(bucket < SUB)
+		return bucket;
+
+	const size_t shift(bucket / SUB - 1);
+	return uint64_t(SUB + bucket % SUB) << shift;
+}
+
+
+inline
+uint64_t Metrics::Hist::quantile(const double &q)
+const
+{
+	const uint64_t rank(std::ceil(q * count));
+	uint64_t cum(0);
+	for(size_t i(0); i < BUCKETS; i++)
+		if((cum += counts[i]) >= rank && counts[i])
+			return lower(i);
+
+	return 0;
+}
+
+
+inline
+Metrics::Hist &Metrics::Hist::operator+=(const Hist &o)
+{
+	for(size_t i(0); i < BUCKETS; i++)
+		counts[i] += o.counts[i];
+
+	sum += o.sum;
+	count += o.count;
+	return *this;
+}
@@ -47,6 +47,7 @@ IRCBOT_FMT( PRIVMSG,           SELFNAME, TEXT
 IRCBOT_FMT( ACTION,            SELFNAME, TEXT                                                                  )
 IRCBOT_FMT( NOTICE,            SELFNAME, TEXT                                                                  )
 IRCBOT_FMT( NAMREPLY,          SELFNAME, TYPE,     CHANNAME, NAMELIST                                          )
+IRCBOT_FMT( ENDOFNAMES,        SELFNAME, CHANNAME, TEXT                                                        )
 IRCBOT_FMT( WHOREPLY,          SELFNAME, CHANNAME, USERNAME, HOSTNAME, SERVNAME, NICKNAME, FLAGS,    ADDL      )
 IRCBOT_FMT( WHOISUSER,         SELFNAME, NICKNAME, USERNAME, HOSTNAME, ASTERISK, REALNAME                      )
 IRCBOT_FMT( WHOISIDLE,         SELFNAME, NICKNAME, SECONDS,  SIGNON,   REMARKS                                 )
@@ -59,6 +60,9 @@ IRCBOT_FMT( BANLIST,           SELFNAME, CHANNAME, BANMASK,  OPERATOR, TIME,
 IRCBOT_FMT( EXCEPTLIST,        SELFNAME, CHANNAME, MASK,     OPERATOR, TIME,                                   )
 IRCBOT_FMT( INVITELIST,        SELFNAME, CHANNAME, MASK,     OPERATOR, TIME,                                   )
 IRCBOT_FMT( QUIETLIST,         SELFNAME, CHANNAME, MODECODE, BANMASK,  OPERATOR, TIME,                         )
+IRCBOT_FMT( ENDOFBANLIST,      SELFNAME, CHANNAME, TEXT                                                        )
+IRCBOT_FMT( ENDOFQUIETLIST,    SELFNAME, CHANNAME, MODECODE, TEXT                                              )
+IRCBOT_FMT( ENDOFWHO,          SELFNAME, TARGET,   TEXT                                                        )
 IRCBOT_FMT( MONLIST,           SELFNAME, NICKLIST                                                              )
 IRCBOT_FMT( MONONLINE,         SELFNAME, MASKLIST                                                              )
 IRCBOT_FMT( MONOFFLINE,        SELFNAME, NICKLIST                                                              )
@@ -75,13 +79,14 @@ class Msg
 {
 	using Params = std::vector<std::string>;
 
-	static void consume_any(std::istream &stream, const char &c);
-	static void consume_until(std::istream &stream, const char &c);
+	static std::string getline(std::istream &stream);
 
 	Mask origin;
 	std::string name;
 	uint32_t code;
 	Params params;
+	Trace::Ctx trace;                                       // of the line received (see: trace.h)
+	Arena::Ref arena;                                       // of the dispatch parsing it; not copied
 
   public:
 	auto &get_code() const                                  { return code;                      }
@@ -89,6 +94,8 @@ class Msg
 	auto &get_origin() const                                { return origin;                    }
 	auto &get_params() const                                { return params;                    }
 	auto num_params() const                                 { return get_params().size();       }
+	auto &get_trace() const                                 { return trace;                     }
+	Arena *get_arena() const                                { return arena;                     }
 
 	auto get_nick() const                                   { return origin.get_nick();         }
 	auto get_user() const                                   { return origin.get_user();         }
@@ -104,66 +111,80 @@ class Msg
 	bool from(const Mask &mask) const;
 	bool from_server() const;
 
+	void set_trace(const Trace::Ctx &trace)                 { this->trace = trace;              }
+
 	Msg(const uint32_t &code, const std::string &origin, const Params &params);
 	Msg(const uint32_t &code, const char *const &origin, const char **const &params, const size_t &count);
 	Msg(const std::string &name, const std::string &origin, const Params &params);
 	Msg(const char *const &name, const char *const &origin, const char **const &params, const size_t &count);
-	Msg(std::istream &stream);
+	Msg(boost::string_ref line, Arena *const &arena = nullptr);   // up to \r or \n
+	Msg(std::istream &stream);                                    // consumes through \n
 
 	friend std::ostream &operator<<(std::ostream &s, const Msg &m);
 };
 
 
+/**
+ * The arena is only carried for the handlers' scratch (see: arena.h); nothing
+ * of the Msg is in it, so a copy kept past the dispatch is whole, and has none.
+ */
 inline
-Msg::Msg(std::istream &stream):
-origin([&]() -> Mask
+Msg::Msg(boost::string_ref line,
+         Arena *const &arena):
+code(0),
+arena(arena)
 {
-	if(stream.eof() || stream.peek() != ':')
-		return {};
+	line = line.substr(0,std::min(line.find_first_of("\r\n"),line.size()));
+	const auto word([&line]
+	{
+		const auto pos(std::min(line.find(' '),line.size()));
+		const auto ret(line.substr(0,pos));
+		line.remove_prefix(pos);
+		while(!line.empty() && line.front() == ' ')
+			line.remove_prefix(1);
 
-	Mask ret;
-	stream.ignore(1,':');
-	std::getline(stream,ret,' ');
-	return ret;
-}()),
-name([&]
-{
-	std::string ret;
-	consume_any(stream,' ');
-	std::getline(stream,ret,' ');
-	return ret;
-}()),
-code(isnumeric(name)? lex_cast<decltype(code)>(name) : 0),
-params([&]() -> Params
-{
-	using delim = boost::char_separator<char>;
+		return ret;
+	});
 
-	std::string str;
-	std::getline(stream,str,'\r');
-	if(str.empty())
-		return {};
+	if(!line.empty() && line.front() == ':')
+	{
+		line.remove_prefix(1);
+		const auto ori(word());
+		origin.assign(ori.data(),ori.size());
+	}
 
-	if(str[0] == ':')
-		return {{str.substr(1)}};
+	const auto nam(word());
+	name.assign(nam.data(),nam.size());
+	code = isnumeric(name)? lex_cast<decltype(code)>(name) : 0;
+	if(line.empty())
+		return;
 
-	static const delim d(" ");
-	const auto col(str.find(" :"));
-	if(col == std::string::npos)
+	if(line.front() == ':')
 	{
-		const boost::tokenizer<delim> tk(str,d);
-		return {tk.begin(),tk.end()};
+		params.emplace_back(line.data()+1,line.size()-1);
+		return;
 	}
 
-	const auto &par(str.substr(0,col));
-	const auto &trail(str.substr(col+2));
-	const boost::tokenizer<delim> tk(par,d);
-	Params ret(tk.begin(),tk.end());
-	ret.emplace_back(trail);
-	return ret;
-}())
+	const auto col(std::min(line.find(" :"),line.size()));
+	for(auto mid(line.substr(0,col)); !mid.empty();)
+	{
+		const auto pos(std::min(mid.find(' '),mid.size()));
+		if(pos)
+			params.emplace_back(mid.data(),pos);
+
+		mid.remove_prefix(std::min(pos+1,mid.size()));
+	}
+
+	if(col < line.size())
+		params.emplace_back(line.data()+col+2,line.size()-col-2);
+}
+
+
+inline
+Msg::Msg(std::istream &stream):
+Msg(getline(stream))
 {
-	consume_any(stream,'\r');
-	consume_until(stream,'\n');
+
 }
 
 
@@ -230,7 +251,7 @@ inline
 bool Msg::from(const Mask &mask)
 const
 {
-	return mask == origin || tolower(mask.get_nick()) == tolower(origin.get_nick());
+	return mask == origin || iequals(mask.get_nick(),origin.get_nick());
 }
 
 
@@ -256,19 +277,11 @@ catch(const std::out_of_range &e)
 
 
 inline
-void Msg::consume_any(std::istream &stream,
-                      const char &c)
+std::string Msg::getline(std::istream &stream)
 {
-	while(!stream.eof() && stream.peek() == c)
-		stream.ignore(1,c);
-}
-
-
-inline
-void Msg::consume_until(std::istream &stream,
-                        const char &c)
-{
-	stream.ignore(512,c);
+	std::string ret;
+	std::getline(stream,ret,'\n');
+	return ret;
 }
 
 
@@ -24,15 +24,16 @@ class NickServ : public Service
 	void ghost(const std::string &nick, const std::string &pass);
 	void listchans();
 
-	NickServ(Users &users, Chans &chans, Events &events);
+	NickServ(const Context &ctx, Users &users, Chans &chans, Events &events);
 };
 
 
 inline
-NickServ::NickServ(Users &users,
+NickServ::NickServ(const Context &ctx,
+                   Users &users,
                    Chans &chans,
                    Events &events):
-Service("NickServ"),
+Service(ctx,"NickServ"),
 users(users),
 chans(chans),
 events(events)
@@ -24,10 +24,16 @@ struct Opts : public std::map<std::string,std::string>
 		{"port",                "6667"                                    },
 		{"pass",                ""                                        },
 		{"proxy",               ""      /* host:port format */            },
+		{"dns-ttl",             "300000" /* ms a lookup is cached */      },
+		{"connect-stagger",     "250"   /* ms between connect attempts */ },
+		{"connect-interval",    "1000"  /* ms per connect, per dest */    },
+		{"connect-burst",       "5"     /* connects before interval */    },
 
 		// Misc configuration
 		{"locale",              ""                                        },
 		{"dbdir",               "db"                                      },
+		{"dbshards",            "1"     /* ldb shards by account hash */  },
+		{"dbsnap",              ""      /* read-only Adb snapshot file */ },
 		{"prefix",              "!"                                       },
 		{"invite-throttle",     "300"                                     },
 		{"owner",               ""                                        },
@@ -37,7 +43,14 @@ struct Opts : public std::map<std::string,std::string>
 		{"quit-msg",            "Quit"                                    },
 		{"umode",               ""                                        },
 		{"timeout",             "300000" /* milliseconds */               },
-		{"threads",             "1"     /* for BACKGROUND mode */         },
+		{"sendq-max",           "4096"  /* lines waiting per session */   },
+		{"sendq-policy",        "reject" /* see: overflow.h */            },
+		{"target-max",          "0"     /* per target; 0 is unbounded */  },
+		{"target-policy",       "reject" /* see: overflow.h */            },
+		{"request-timeout",     "30000" /* ms for a query's reply */      },
+		{"threads",             "1"     /* for BACKGROUND or pinned */    },
+		{"pinned",              "false" /* own exec worker, no mutex */   },
+		{"steal",               "4"     /* pinned placement imbalance */  },
 
 		{"invite",              "false"                                   },
 		{"database",            "false"                                   },
@@ -48,8 +61,22 @@ struct Opts : public std::map<std::string,std::string>
 		{"chan-fetch-who",      "true"                                    },
 		{"chan-fetch-info",     "true"                                    },
 		{"chan-fetch-lists",    "true"                                    },
+		{"chan-fresh",          "3600"  /* s a fetched part is trusted */ },
+		{"resume-file",         ""      /* chan state across restarts */  },
+		{"capture-file",        ""      /* inbound lines for replay */    },
+		{"metrics-file",        ""      /* prometheus text, rewritten */  },
+		{"metrics-interval",    "10000" /* ms between metrics-file */     },
+		{"metrics-socket",      ""      /* unix socket serving metrics */ },
+		{"trace-file",          ""      /* chrome trace json, rewritten */},
+		{"trace-max",           "100000" /* spans kept for trace-file */  },
+		{"profile-file",        ""      /* folded stacks, rewritten */    },
+		{"profile-hz",          "99"    /* samples per second of CPU */   },
+		{"profile-interval",    "1000"  /* ms between profile-file */     },
+		{"admin-socket",        ""      /* unix socket serving stats */   },
 		{"quit",                "true"                                    },
 		{"reconnect",           "true"                                    },
+		{"reconnect-min",       "2000"  /* ms, doubled per fault */       },
+		{"reconnect-max",       "300000" /* ms, jittered backoff cap */   },
 	}
 	{
 		if(at("locale").empty())
@@ -0,0 +1,86 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * What a full queue does with what is offered to it.
+ */
+enum class Overflow : uint8_t
+{
+	REJECT,                                       // Exception thrown to the caller
+	DROP_NEWEST,                                  // what was offered is discarded
+	DROP_OLDEST,                                  // the head of the queue is discarded for it
+	COALESCE,                                     // discarded if already queued, else as DROP_OLDEST
+};
+
+Overflow overflow(const std::string &name);       // "reject", "drop-newest", "drop-oldest", "coalesce"
+const char *reflect(const Overflow &overflow);
+
+
+/**
+ * Limit and counters for one queue. The queue's owner measures its depth.
+ */
+struct Bound
+{
+	size_t max;                                   // 0 is unbounded
+	Overflow policy;
+	size_t dropped;                               // discarded by the policy
+	size_t rejected;                              // thrown back to the caller
+
+	bool full(const size_t &depth) const          { return max && depth >= max;     }
+
+	Bound(const Opts &opts, const std::string &name);    // opts[name-max] opts[name-policy]
+	Bound(const size_t &max = 0, const Overflow &policy = Overflow::REJECT);
+};
+
+
+inline
+Bound::Bound(const size_t &max,
+             const Overflow &policy):
+max(max),
+policy(policy),
+dropped(0),
+rejected(0)
+{
+}
+
+
+inline
+Bound::Bound(const Opts &opts,
+             const std::string &name):
+Bound(opts.get<size_t>(name + "-max"),overflow(opts[name + "-policy"]))
+{
+}
+
+
+inline
+Overflow overflow(const std::string &name)
+{
+	switch(hash(tolower(name)))
+	{
+		case hash("reject"):          return Overflow::REJECT;
+		case hash("drop-newest"):     return Overflow::DROP_NEWEST;
+		case hash("drop-oldest"):     return Overflow::DROP_OLDEST;
+		case hash("coalesce"):        return Overflow::COALESCE;
+		default:
+			throw Assertive("Unrecognized overflow policy: ") << name;
+	}
+}
+
+
+inline
+const char *reflect(const Overflow &overflow)
+{
+	switch(overflow)
+	{
+		case Overflow::REJECT:        return "reject";
+		case Overflow::DROP_NEWEST:   return "drop-newest";
+		case Overflow::DROP_OLDEST:   return "drop-oldest";
+		case Overflow::COALESCE:      return "coalesce";
+		default:                      return "";
+	}
+}
@@ -0,0 +1,279 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Requests in flight awaiting their numeric replies.
+ *
+ * A request names its target and the numerics making up and ending its reply.
+ * Numerics carry the target as the first parameter after our nick; one is
+ * given to the oldest request for that target, so any number of requests may
+ * be in flight and replies for different targets may interleave. Replies
+ * without the target (WHO rows) are held until an end numeric arrives, and
+ * belong to the request it ends: the server answers one connection in order.
+ *
+ * The callback is called from the event handler stack once the reply ends or
+ * after the timeout. A future must not be waited on from a handler: the reply
+ * can't be read until the handler returns.
+ */
+class Pending
+{
+  public:
+	using Numerics = std::set<uint32_t>;
+
+	struct Reply
+	{
+		std::string target;
+		std::vector<Msg> msgs;                        // in the order received, terminator last
+		bool timedout;
+
+		bool error() const;                           // an ERR_ numeric is among msgs
+	};
+
+	using Callback = std::function<void (const Reply &)>;
+	using Handler = std::function<void (const boost::system::error_code &)>;
+
+	struct Request
+	{
+		std::string target;                           // matched case-insensitively
+		Numerics replies;                             // collected, including ERR_ replies
+		Numerics ends;                                // completes the request
+		Callback cb;
+	};
+
+  private:
+	struct Entry
+	{
+		Request req;
+		time_point expires;
+		Reply reply;
+	};
+
+	std::list<Entry> reqs;                            // in the order sent
+	std::map<uint32_t,std::vector<Msg>> loose;        // replies without a target, until an end
+	milliseconds timeout;
+	boost::asio::steady_timer timer;
+	time_point deadline;                              // timer's expiry, max when not armed
+	Handler handler;
+
+	void arm();
+	bool stray(const Msg &msg);
+	void complete(const std::list<Entry>::iterator &it, const bool &timedout);
+	static void complete(Entry &ent, const bool &timedout);
+
+  public:
+	auto size() const                                 { return reqs.size();                        }
+	bool empty() const                                { return reqs.empty();                       }
+	auto &get_timeout() const                         { return timeout;                            }
+	static std::pair<Callback,std::future<Reply>> promise();
+
+	void set_handler(const Handler &handler)          { this->handler = handler;                   }
+	void add(Request req);
+	bool operator()(const Msg &msg);                  // true if taken by a request
+	size_t expire();                                  // time out what is past its deadline
+	size_t cancel();                                  // time out everything (connection lost)
+
+	Pending(boost::asio::io_service &ios, const milliseconds &timeout);
+};
+
+
+inline
+Pending::Pending(boost::asio::io_service &ios,
+                 const milliseconds &timeout):
+timeout(timeout),
+timer(ios),
+deadline(time_point::max())
+{
+}
+
+
+inline
+void Pending::add(Request req)
+{
+	req.target = tolower(req.target);
+	reqs.push_back({std::move(req),steady_clock::now() + timeout,{}});
+	reqs.back().reply.target = reqs.back().req.target;
+	reqs.back().reply.timedout = false;
+	arm();
+}
+
+
+inline
+bool Pending::operator()(const Msg &msg)
+{
+	const auto &code(msg.get_code());
+	if(!code || reqs.empty())
+		return false;
+
+	const auto target(tolower(msg[1]));
+	const auto it(std::find_if(reqs.begin(),reqs.end(),[&code,&target]
+	(const Entry &ent)
+	{
+		return ent.req.target == target && (ent.req.replies.count(code) || ent.req.ends.count(code));
+	}));
+
+	if(it == reqs.end())
+		return stray(msg);
+
+	auto &msgs(it->reply.msgs);
+	if(!it->req.ends.count(code))
+	{
+		msgs.emplace_back(msg);
+		return true;
+	}
+
+	for(const auto &reply : it->req.replies)
+	{
+		const auto lit(loose.find(reply));
+		if(lit == loose.end())
+			continue;
+
+		std::move(lit->second.begin(),lit->second.end(),std::back_inserter(msgs));
+		loose.erase(lit);
+	}
+
+	msgs.emplace_back(msg);
+	complete(it,false);
+	return true;
+}
+
+
+/**
+ * A reply numeric is held while some request collects it. An end numeric for a
+ * target not in flight ended a request sent around this table (e.g User::who()),
+ * so what was held belonged to that one.
+ */
+inline
+bool Pending::stray(const Msg &msg)
+{
+	const auto &code(msg.get_code());
+	for(const auto &ent : reqs)
+	{
+		if(ent.req.ends.count(code))
+		{
+			for(const auto &reply : ent.req.replies)
+				loose.erase(reply);
+
+			return false;
+		}
+
+		if(ent.req.replies.count(code))
+		{
+			loose[code].emplace_back(msg);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+inline
+size_t Pending::expire()
+{
+	size_t ret(0);
+	const auto now(steady_clock::now());
+	for(auto it(reqs.begin()); it != reqs.end();)
+		if(it->expires > now)
+			++it;
+		else
+		{
+			complete(it++,true);
+			++ret;
+		}
+
+	if(reqs.empty())
+		loose.clear();
+
+	deadline = time_point::max();
+	arm();
+	return ret;
+}
+
+
+inline
+size_t Pending::cancel()
+{
+	boost::system::error_code ec;
+	timer.cancel(ec);
+	deadline = time_point::max();
+	loose.clear();
+
+	// Taken as a whole: a callback sending another request adds to reqs anew
+	std::list<Entry> gone;
+	gone.swap(reqs);
+	for(auto &ent : gone)
+		complete(ent,true);
+
+	return gone.size();
+}
+
+
+inline
+void Pending::arm()
+{
+	if(reqs.empty() || !handler)
+		return;
+
+	const auto next(std::min_element(reqs.begin(),reqs.end(),[]
+	(const Entry &a, const Entry &b)
+	{
+		return a.expires < b.expires;
+	}));
+
+	if(next->expires >= deadline)
+		return;
+
+	deadline = next->expires;
+	timer.expires_at(deadline);
+	timer.async_wait(handler);
+}
+
+
+inline
+void Pending::complete(const std::list<Entry>::iterator &it,
+                       const bool &timedout)
+{
+	// Off the list first: the callback may well send another request
+	Entry ent(std::move(*it));
+	reqs.erase(it);
+	complete(ent,timedout);
+}
+
+
+inline
+void Pending::complete(Entry &ent,
+                       const bool &timedout)
+{
+	auto reply(std::move(ent.reply));
+	const auto cb(std::move(ent.req.cb));
+
+	// Errors are contained as for any other event handler
+	reply.timedout = timedout;
+	if(cb)
+		handler::Handler<void (const Reply &)>{cb}(reply);
+}
+
+
+inline
+std::pair<Pending::Callback,std::future<Pending::Reply>> Pending::promise()
+{
+	const auto p(std::make_shared<std::promise<Reply>>());
+	return {[p](const Reply &reply) { p->set_value(reply); }, p->get_future()};
+}
+
+
+inline
+bool Pending::Reply::error()
+const
+{
+	return std::any_of(msgs.begin(),msgs.end(),[]
+	(const Msg &msg)
+	{
+		return msg.get_code() >= 400 && msg.get_code() < 600;
+	});
+}
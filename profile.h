@@ -0,0 +1,280 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Sampling CPU profile, aggregated by the event and handler running.
+ *
+ * While a handler is called a Tag on its thread names the event, the kind of
+ * Handlers and the handler (by name or its prio class) with its prio. Enabled,
+ * a SIGPROF timer of the process's CPU time interrupts whichever thread is
+ * running; the signal handler copies that thread's Tag and its stack into a
+ * ring of samples and returns. The ring is drained on the metrics exporter's
+ * thread, which symbolizes the frames and counts each distinct stack.
+ *
+ * write() produces the folded stack format (for flamegraph.pl, speedscope or
+ * inferno), rooted at the Tag:
+ *
+ *	PRIVMSG;msg:user[128];main;...;handle_privmsg 42
+ *
+ * Samples outside any handler are rooted at "-". Frames are named by dladdr(),
+ * which needs the program linked with -rdynamic to see its own symbols; those
+ * it can't name are written module+offset for addr2line. Disabled, the cost is
+ * two stores to thread-local memory per handler called.
+ */
+class Profile
+{
+  public:
+	static constexpr size_t FRAMES = 64;              // deepest stack sampled
+	static constexpr size_t SLOTS = 2048;             // in the ring
+	static constexpr size_t EVENT = 32;               // chars of the event name kept
+
+	struct Tag                                        // this thread's handler for its lifetime
+	{
+		const char *kind;
+		const char *event;
+		const char *handler;                          // its name, else its prio class
+		uint8_t prio;
+		const Tag *prev;
+
+		Tag(const char *const &kind, const char *const &event, const char *const &handler, const uint8_t &prio);
+		~Tag() noexcept;
+	};
+
+  private:
+	struct Sample
+	{
+		std::atomic<bool> ready {false};              // written by the signal; cleared by drain()
+		char event[EVENT];
+		const char *kind;
+		const char *handler;
+		uint8_t prio;
+		uint8_t depth;
+		void *frames[FRAMES];
+	};
+
+	static std::mutex mutex;                          // bot.cpp
+	static std::unique_ptr<Sample[]> ring;            // bot.cpp
+	static std::atomic<size_t> head;                  // bot.cpp; slots claimed
+	static std::atomic<size_t> dropped;               // bot.cpp; ring full
+	static std::map<std::string,size_t> stacks;       // bot.cpp; folded, counted
+	static std::unordered_map<void *,std::string> syms;   // bot.cpp; by frame
+	static std::atomic<size_t> hz;                    // bot.cpp
+	static thread_local const Tag *current            // bot.cpp; initial-exec (see: handle_sigprof())
+	__attribute__((tls_model("initial-exec")));
+
+	static void handle_sigprof(int sig);
+	static const std::string &symbol(void *const &frame);
+	static std::string fold(const Sample &sample);
+
+  public:
+	static bool is_enabled()                          { return hz.load(std::memory_order_acquire); }
+	static size_t get_dropped()                       { return dropped.load(std::memory_order_relaxed); }
+	static size_t size();                             // distinct stacks
+
+	static void enable(const size_t &hz);             // samples per second of CPU; again does nothing
+	static void drain();                              // ring into the stacks
+	static void write(std::ostream &s);               // folded stacks
+	static void dump(const std::string &path);        // drain() and write() to a temp file renamed over path
+};
+
+
+inline
+Profile::Tag::Tag(const char *const &kind,
+                  const char *const &event,
+                  const char *const &handler,
+                  const uint8_t &prio):
+kind(kind),
+event(event),
+handler(handler),
+prio(prio),
+prev(current)
+{
+	std::atomic_signal_fence(std::memory_order_release);
+	current = this;
+}
+
+
+inline
+Profile::Tag::~Tag()
+noexcept
+{
+	current = prev;
+	std::atomic_signal_fence(std::memory_order_release);
+}
+
+
+inline
+void Profile::enable(const size_t &hz)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	if(is_enabled() || !hz)
+		return;
+
+	// backtrace() loads the unwinder on its first call, which must not be in the signal
+	void *frames[1];
+	::backtrace(frames,1);
+
+	ring.reset(new Sample[SLOTS]);
+	Profile::hz.store(hz,std::memory_order_release);
+
+	struct sigaction sa {};
+	sa.sa_handler = handle_sigprof;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if(::sigaction(SIGPROF,&sa,nullptr) < 0)
+		throw Exception("Failed to install SIGPROF handler: ") << strerror(errno);
+
+	const long usec(std::max(1000000L / long(hz),1L));
+	const struct itimerval it {{usec / 1000000L, usec % 1000000L},{usec / 1000000L, usec % 1000000L}};
+	if(::setitimer(ITIMER_PROF,&it,nullptr) < 0)
+		throw Exception("Failed to start the profiling timer: ") << strerror(errno);
+}
+
+
+/**
+ * Only async-signal-safe work here: a relaxed claim of a slot, copies, and
+ * backtrace() (already loaded by enable()). A slot not yet drained is not
+ * overwritten; the sample is dropped and counted instead. The signal lands on
+ * any thread, often one that has never touched current; its initial-exec model
+ * keeps that first access an offset from the thread pointer, where the default
+ * model in libircbot.so would go through __tls_get_addr(), which may malloc.
+ */
+inline
+void Profile::handle_sigprof(int sig)
+{
+	const int errno_saved(errno);
+	const auto slot(head.fetch_add(1,std::memory_order_relaxed) % SLOTS);
+	auto &sample(ring[slot]);
+	if(sample.ready.load(std::memory_order_acquire))
+	{
+		dropped.fetch_add(1,std::memory_order_relaxed);
+		errno = errno_saved;
+		return;
+	}
+
+	const Tag *const tag(current);
+	std::atomic_signal_fence(std::memory_order_acquire);
+	sample.kind = tag? tag->kind : nullptr;
+	sample.handler = tag? tag->handler : nullptr;
+	sample.prio = tag? tag->prio : 0;
+	sample.event[0] = '\0';
+	if(tag)
+	{
+		size_t i(0);
+		for(; i < EVENT - 1 && tag->event[i]; ++i)
+			sample.event[i] = tag->event[i];
+
+		sample.event[i] = '\0';
+	}
+
+	sample.depth = ::backtrace(sample.frames,FRAMES);
+	sample.ready.store(true,std::memory_order_release);
+	errno = errno_saved;
+}
+
+
+inline
+void Profile::drain()
+{
+	if(!is_enabled())
+		return;
+
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	for(size_t i(0); i < SLOTS; ++i)
+	{
+		auto &sample(ring[i]);
+		if(!sample.ready.load(std::memory_order_acquire))
+			continue;
+
+		++stacks[fold(sample)];
+		sample.ready.store(false,std::memory_order_release);
+	}
+}
+
+
+/**
+ * The first two frames are this handler's and the kernel's signal trampoline;
+ * the rest are written from the root.
+ */
+inline
+std::string Profile::fold(const Sample &sample)
+{
+	std::stringstream s;
+	if(sample.kind)
+		s << sample.event << ';' << sample.kind << ':' << sample.handler << '[' << uint(sample.prio) << ']';
+	else
+		s << '-';
+
+	for(ssize_t i(ssize_t(sample.depth) - 1); i >= 2; --i)
+		s << ';' << symbol(sample.frames[i]);
+
+	return s.str();
+}
+
+
+inline
+const std::string &Profile::symbol(void *const &frame)
+{
+	const auto it(syms.find(frame));
+	if(it != syms.end())
+		return it->second;
+
+	std::stringstream s;
+	Dl_info info {};
+	const bool found(::dladdr(frame,&info));
+	if(found && info.dli_sname)
+	{
+		int status(0);
+		const std::unique_ptr<char,decltype(&std::free)> dem(abi::__cxa_demangle(info.dli_sname,nullptr,nullptr,&status),&std::free);
+		const char *const name(status == 0 && dem? dem.get() : info.dli_sname);
+		for(const char *c(name); *c; ++c)                // ';' and ' ' are the format's
+			s << (*c == ';'? ':' : *c == ' '? '_' : *c);
+	}
+	else if(found && info.dli_fname)
+		s << info.dli_fname << "+0x" << std::hex << (uintptr_t(frame) - uintptr_t(info.dli_fbase));
+	else
+		s << "0x" << std::hex << uintptr_t(frame);
+
+	return syms.emplace(frame,s.str()).first->second;
+}
+
+
+inline
+size_t Profile::size()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	return stacks.size();
+}
+
+
+inline
+void Profile::write(std::ostream &s)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	for(const auto &p : stacks)
+		s << p.first << ' ' << p.second << '\n';
+}
+
+
+inline
+void Profile::dump(const std::string &path)
+{
+	drain();
+
+	const auto tmp(path + ".tmp");
+	{
+		std::ofstream file(tmp,std::ios::out | std::ios::trunc);
+		if(!file.is_open())
+			throw Exception("Failed to open profile file: ") << tmp;
+
+		write(file);
+	}
+
+	if(::rename(tmp.c_str(),path.c_str()) < 0)
+		throw Exception("Failed to replace profile file: ") << path << ": " << strerror(errno);
+}
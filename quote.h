@@ -8,6 +8,7 @@
 
 class Quote
 {
+	Socket &sock;
 	const char *const &cmd;
 
   public:
@@ -29,6 +30,7 @@ class Quote
 	// Append to stream
 	template<class T> Quote &operator<<(const T &t);
 
+	Quote(const Context &ctx, const char *const &cmd = "", const milliseconds &delay = 0ms);
 	Quote(const char *const &cmd = "", const milliseconds &delay = 0ms);
 	~Quote() noexcept;
 };
@@ -37,9 +39,19 @@ class Quote
 inline
 Quote::Quote(const char *const &cmd,
              const milliseconds &delay):
+Quote(get_ctx(),cmd,delay)
+{
+}
+
+
+inline
+Quote::Quote(const Context &ctx,
+             const char *const &cmd,
+             const milliseconds &delay):
+sock(ctx.get_sess().get_socket()),
 cmd(cmd)
 {
-	auto &sock(get_sock());
+	sock.check();
 	sock.set_delay(delay);
 
 	if(has_cmd())
@@ -51,15 +63,20 @@ inline
 Quote::~Quote()
 noexcept
 {
-	auto &sock(get_sock());
 	if(std::uncaught_exception())
 	{
 		sock.clear();
 		return;
 	}
 
-	if(sock.has_pending())
+	if(sock.has_pending()) try
+	{
 		operator<<(flush);
+	}
+	catch(const Exception &e)
+	{
+		std::cerr << "Quote::~Quote(): " << e << std::endl;
+	}
 }
 
 
@@ -83,7 +100,6 @@ Quote &Quote::operator()(const std::string &str)
 template<class T>
 Quote &Quote::operator<<(const T &t)
 {
-	auto &sock(get_sock());
 	if(has_cmd() && !sock.has_pending())
 		sock << cmd << " ";
 
@@ -95,7 +111,6 @@ Quote &Quote::operator<<(const T &t)
 inline
 Quote &Quote::operator<<(const flush_t)
 {
-	auto &sock(get_sock());
 	sock << flush;
 	return *this;
 }
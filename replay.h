@@ -0,0 +1,139 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Replays a wire capture (see: capture.h) through a Bot without a socket.
+ *
+ * Each line is dispatched with Bot::operator()(const std::string &) as if it
+ * had just been received: FAST as quickly as the handlers allow, RECORDED
+ * with the gaps it was captured with. What the handlers send in reply is
+ * formatted as usual and discarded; the Bot's socket is corked for the
+ * duration so nothing reaches the sendq.
+ *
+ * The caller holds the Bot's lock (or is on its thread when pinned), as for
+ * any manual dispatch. A handler throwing is counted and replay goes on.
+ */
+class Replay
+{
+  public:
+	using microseconds = std::chrono::microseconds;
+	using nanoseconds = std::chrono::nanoseconds;
+
+	enum Speed { FAST, RECORDED };
+
+	struct Line
+	{
+		microseconds time;                            // since the epoch, when captured
+		std::string line;
+	};
+
+	struct Result
+	{
+		size_t lines = 0;                             // dispatched
+		size_t errors = 0;                            // of which threw
+		nanoseconds elapsed {0};
+	};
+
+  private:
+	std::vector<Line> lines;
+
+	static std::vector<Line> read(std::istream &in);
+
+  public:
+	auto &get_lines() const                           { return lines;                             }
+	auto size() const                                 { return lines.size();                      }
+	microseconds span() const;                        // first to last line as captured
+
+	Result operator()(Bot &bot, const Speed &speed = FAST) const;
+
+	Replay(std::istream &in);
+	Replay(const std::string &path);
+};
+
+
+inline
+Replay::Replay(std::istream &in):
+lines(read(in))
+{
+}
+
+
+inline
+Replay::Replay(const std::string &path)
+{
+	std::ifstream in(path);
+	if(!in.is_open())
+		throw Exception("Failed to open capture file: ") << path;
+
+	lines = read(in);
+}
+
+
+inline
+std::vector<Replay::Line> Replay::read(std::istream &in)
+{
+	std::vector<Line> ret;
+	std::string buf;
+	while(std::getline(in,buf))
+	{
+		const auto sp(buf.find(' '));
+		if(sp == std::string::npos || sp == 0)
+			continue;
+
+		ret.push_back({microseconds(lex_cast<int64_t>(buf.substr(0,sp))),buf.substr(sp+1)});
+	}
+
+	return ret;
+}
+
+
+inline
+Replay::Result Replay::operator()(Bot &bot,
+                                  const Speed &speed)
+const
+{
+	auto &sock(bot.sess.get_socket());
+	sock.set_cork();
+	const scope uncork([&sock]
+	{
+		sock.clear();
+		sock.unset_cork();
+	});
+
+	Result ret;
+	const auto start(steady_clock::now());
+	for(const auto &l : lines)
+	{
+		if(speed == RECORDED)
+			std::this_thread::sleep_until(start + (l.time - lines.front().time));
+
+		bot.set_tls_context();
+		try
+		{
+			bot(l.line);
+		}
+		catch(const std::exception &e)
+		{
+			++ret.errors;
+		}
+
+		sock.clear();
+		++ret.lines;
+	}
+
+	ret.elapsed = steady_clock::now() - start;
+	return ret;
+}
+
+
+inline
+Replay::microseconds Replay::span()
+const
+{
+	return lines.empty()? microseconds(0) : lines.back().time - lines.front().time;
+}
@@ -0,0 +1,172 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Process-wide cache of name lookups, shared by every Socket.
+ *
+ * Results are kept for a fixed ttl (getaddrinfo doesn't report the record's).
+ * Concurrent lookups of the same host:port wait on the one already in flight
+ * rather than each querying; a fleet connecting to one network resolves once.
+ * Failures are not cached.
+ */
+class Resolver
+{
+  public:
+	using tcp = boost::asio::ip::tcp;
+	using error_code = boost::system::error_code;
+	using Endpoints = std::vector<tcp::endpoint>;
+	using Callback = std::function<void (const error_code &, const Endpoints &)>;
+
+  private:
+	struct Entry
+	{
+		Endpoints eps;
+		time_point expires;
+		std::vector<Callback> waiters;                // non-empty while a lookup is in flight
+	};
+
+	static std::mutex mutex;                          // bot.cpp
+	static std::map<std::string,Entry> cache;         // bot.cpp
+
+	static Endpoints order(const tcp::resolver::iterator &it);
+	static void complete(const std::string &key, const milliseconds &ttl, const error_code &ec, const tcp::resolver::iterator &it);
+
+  public:
+	static void async_resolve(boost::asio::io_service &ios, const std::string &host, const std::string &port, const milliseconds &ttl, const Callback &cb);
+	static Endpoints resolve(boost::asio::io_service &ios, const std::string &host, const std::string &port, const milliseconds &ttl);
+	static void clear();
+};
+
+
+inline
+void Resolver::clear()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	for(auto it(cache.begin()); it != cache.end();)
+		if(it->second.waiters.empty())
+			cache.erase(it++);
+		else
+			++it;
+}
+
+
+inline
+Resolver::Endpoints Resolver::resolve(boost::asio::io_service &ios,
+                                      const std::string &host,
+                                      const std::string &port,
+                                      const milliseconds &ttl)
+{
+	const auto key(host + ":" + port);
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		const auto it(cache.find(key));
+		if(it != cache.end() && !it->second.eps.empty() && it->second.expires > steady_clock::now())
+			return it->second.eps;
+	}
+
+	error_code ec;
+	tcp::resolver res(ios);
+	const tcp::resolver::query query(host,port,tcp::resolver::query::numeric_service);
+	const auto it(res.resolve(query,ec));
+	if(ec)
+		throw Internal(ec.value(),ec.message());
+
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	auto &ent(cache[key]);
+	ent.eps = order(it);
+	ent.expires = steady_clock::now() + ttl;
+	return ent.eps;
+}
+
+
+inline
+void Resolver::async_resolve(boost::asio::io_service &ios,
+                             const std::string &host,
+                             const std::string &port,
+                             const milliseconds &ttl,
+                             const Callback &cb)
+{
+	const auto key(host + ":" + port);
+	std::unique_lock<decltype(mutex)> lock(mutex);
+	auto &ent(cache[key]);
+	if(!ent.eps.empty() && ent.expires > steady_clock::now())
+	{
+		const auto eps(ent.eps);
+		lock.unlock();
+		cb({},eps);
+		return;
+	}
+
+	ent.waiters.emplace_back(cb);
+	if(ent.waiters.size() > 1)
+		return;
+
+	lock.unlock();
+	const auto res(std::make_shared<tcp::resolver>(ios));
+	const tcp::resolver::query query(host,port,tcp::resolver::query::numeric_service);
+	res->async_resolve(query,[res,key,ttl]
+	(const error_code &ec, tcp::resolver::iterator it)
+	{
+		complete(key,ttl,ec,it);
+	});
+}
+
+
+inline
+void Resolver::complete(const std::string &key,
+                        const milliseconds &ttl,
+                        const error_code &ec,
+                        const tcp::resolver::iterator &it)
+{
+	std::vector<Callback> waiters;
+	Endpoints eps;
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		auto &ent(cache[key]);
+		std::swap(waiters,ent.waiters);
+		if(!ec)
+		{
+			ent.eps = order(it);
+			ent.expires = steady_clock::now() + ttl;
+			eps = ent.eps;
+		}
+	}
+
+	for(const auto &cb : waiters)
+		cb(ec,eps);
+}
+
+
+/**
+ * Alternates address families starting with IPv6 (RFC 8305 section 4) so a
+ * broken family only delays the race by one attempt.
+ */
+inline
+Resolver::Endpoints Resolver::order(const tcp::resolver::iterator &it)
+{
+	Endpoints v6, v4;
+	for(auto i(it); i != tcp::resolver::iterator(); ++i)
+	{
+		const tcp::endpoint ep(*i);
+		auto &eps(ep.address().is_v6()? v6 : v4);
+		if(std::find(eps.begin(),eps.end(),ep) == eps.end())
+			eps.emplace_back(ep);
+	}
+
+	Endpoints ret;
+	for(size_t i(0); i < std::max(v6.size(),v4.size()); ++i)
+	{
+		if(i < v6.size())
+			ret.emplace_back(v6[i]);
+
+		if(i < v4.size())
+			ret.emplace_back(v4[i]);
+	}
+
+	return ret;
+}
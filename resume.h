@@ -0,0 +1,250 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Channel state kept across a reconnect so a rejoin refetches only what is stale.
+ *
+ * At a fault the lists, ChanServ info and freshness times of every joined channel
+ * are saved here, and to path if set so a restarted bot resumes too. When we
+ * rejoin, the saved state goes back into the Chan. The bot then asks MODE first:
+ * if RPL_CREATIONTIME differs, the channel was recreated while we were away and
+ * everything is refetched.
+ *
+ * Membership and Users are not kept: a nick seen after the reconnect may be a
+ * different person, so NAMES and WHO always rebuild them.
+ */
+class Resume
+{
+	using ptree = boost::property_tree::ptree;
+
+	std::string path;                                  // file, or empty for memory only
+	Adoc chans;                                        // saved state keyed by channel (lowercase)
+
+	static const ptree &child(const ptree &doc, const char *const &key);   // empty if absent
+	static std::vector<std::string> row(const ptree &array);
+	template<class List> static ptree save(const List &list);
+	static ptree save(const Chan &chan);
+	static void load(const ptree &doc, Chan &chan);
+
+  public:
+	auto &get_path() const                             { return path;                               }
+	auto num() const                                   { return chans.size();                       }
+	bool has(const std::string &name) const            { return chans.find(tolower(name)) != chans.not_found(); }
+
+	bool restore(Chan &chan);                          // false if nothing was saved for chan
+	void save(const Chans &chans);                     // updates joined chans; writes path if set
+
+	Resume(const std::string &path = {});
+};
+
+
+inline
+Resume::Resume(const std::string &path):
+path(path)
+{
+	if(path.empty())
+		return;
+
+	std::ifstream file(path);
+	if(!file.good())
+		return;
+
+	const std::string str{std::istreambuf_iterator<char>(file),std::istreambuf_iterator<char>()};
+	try
+	{
+		json::parse(chans,str);
+	}
+	catch(const std::exception &e)
+	{
+		std::cerr << "Resume: ignoring " << path << ": " << e.what() << std::endl;
+		chans.clear();
+	}
+}
+
+
+inline
+void Resume::save(const Chans &chans)
+{
+	// A channel not (yet) rejoined keeps what was saved for it before
+	chans.for_each([this]
+	(const Chan &chan)
+	{
+		if(!chan.is_joined())
+			return;
+
+		const auto name(tolower(chan.get_name()));
+		const auto it(this->chans.find(name));
+		if(it != this->chans.not_found())
+			it->second = save(chan);
+		else
+			this->chans.push_back({name,save(chan)});
+	});
+
+	if(path.empty())
+		return;
+
+	const auto tmp(path + ".tmp");
+	std::string buf;
+	this->chans.write(buf);
+	std::ofstream file(tmp,std::ios_base::trunc);
+	file.write(buf.data(),buf.size());
+	file.close();
+	if(!file.good() || std::rename(tmp.c_str(),path.c_str()) < 0)
+		std::cerr << "Resume: failed to write " << path << std::endl;
+}
+
+
+/**
+ * The entry is taken out first, so one that fails to load is dropped rather
+ * than retried on every rejoin; the Chan is then left as it was never saved.
+ */
+inline
+bool Resume::restore(Chan &chan)
+{
+	const auto it(chans.find(tolower(chan.get_name())));
+	if(it == chans.not_found())
+		return false;
+
+	ptree doc;
+	doc.swap(it->second);
+	chans.erase(chans.to_iterator(it));
+	try
+	{
+		load(doc,chan);
+		return true;
+	}
+	catch(const std::exception &e)
+	{
+		std::cerr << "Resume: ignoring " << chan.get_name() << ": " << e.what() << std::endl;
+		chan.set_creation(0);
+		chan.set_info({});
+		chan.set_fresh(chan::Fresh{});
+		chan.lists.bans.clear();
+		chan.lists.quiets.clear();
+		chan.lists.excepts.clear();
+		chan.lists.invites.clear();
+		chan.lists.flags.clear();
+		return false;
+	}
+}
+
+
+inline
+Resume::ptree Resume::save(const Chan &chan)
+{
+	ptree doc, info, fresh;
+	for(const auto &kv : chan.get_info())
+		info.push_back({kv.first,ptree(kv.second)});
+
+	for(const auto &kv : chan.get_fresh())
+		fresh.push_back({kv.first,ptree(lex_cast(kv.second))});
+
+	ptree flags;
+	for(const auto &f : chan.lists.flags)
+	{
+		ptree ent;
+		ent.push_back({"",ptree(f.get_mask())});
+		ent.push_back({"",ptree(f.get_flags())});
+		ent.push_back({"",ptree(lex_cast(f.get_time()))});
+		ent.push_back({"",ptree(f.is_founder()? "1" : "0")});
+		flags.push_back({"",ent});
+	}
+
+	doc.put("creation",chan.get_creation());
+	doc.push_back({"info",info});
+	doc.push_back({"fresh",fresh});
+	doc.push_back({"bans",save(chan.lists.bans)});
+	doc.push_back({"quiets",save(chan.lists.quiets)});
+	doc.push_back({"excepts",save(chan.lists.excepts)});
+	doc.push_back({"invites",save(chan.lists.invites)});
+	doc.push_back({"flags",flags});
+	return doc;
+}
+
+
+template<class List>
+Resume::ptree Resume::save(const List &list)
+{
+	ptree ret;
+	for(const auto &ban : list)
+	{
+		ptree ent;
+		ent.push_back({"",ptree(ban.get_mask())});
+		ent.push_back({"",ptree(ban.get_oper())});
+		ent.push_back({"",ptree(lex_cast(ban.get_time()))});
+		ret.push_back({"",ent});
+	}
+
+	return ret;
+}
+
+
+inline
+void Resume::load(const ptree &doc,
+                  Chan &chan)
+{
+	const auto list([&doc]
+	(const char *const &name, chan::List<Ban> &list)
+	{
+		list.clear();
+		for(const auto &p : child(doc,name))
+		{
+			const auto ent(row(p.second));
+			list.emplace(Mask(ent.at(0)),Mask(ent.at(1)),lex_cast<time_t>(ent.at(2)));
+		}
+	});
+
+	chan.set_creation(doc.get<time_t>("creation",0));
+
+	chan::Info info;
+	for(const auto &p : child(doc,"info"))
+		info.emplace(p.first,p.second.data());
+
+	chan::Fresh fresh;
+	for(const auto &p : child(doc,"fresh"))
+		fresh.emplace(p.first,lex_cast<time_t>(p.second.data()));
+
+	chan.set_info(info);
+	chan.set_fresh(fresh);
+	list("bans",chan.lists.bans);
+	list("quiets",chan.lists.quiets);
+	list("excepts",chan.lists.excepts);
+	list("invites",chan.lists.invites);
+
+	chan.lists.flags.clear();
+	for(const auto &p : child(doc,"flags"))
+	{
+		const auto ent(row(p.second));
+		chan.lists.flags.emplace(Mask(ent.at(0)),Mode(ent.at(1)),lex_cast<time_t>(ent.at(2)),ent.at(3) == "1");
+	}
+}
+
+
+/**
+ * get_child() with a default returns a reference to that default, which in a
+ * range-for over a temporary is destroyed before the loop runs.
+ */
+inline
+const Resume::ptree &Resume::child(const ptree &doc,
+                                   const char *const &key)
+{
+	static const ptree empty;
+	const auto ret(doc.get_child_optional(key));
+	return ret? *ret : empty;
+}
+
+
+inline
+std::vector<std::string> Resume::row(const ptree &array)
+{
+	std::vector<std::string> ret;
+	for(const auto &p : array)
+		ret.emplace_back(p.second.data());
+
+	return ret;
+}
@@ -12,11 +12,13 @@ using namespace irc::bot;
 
 
 decltype(sendq::mutex)        sendq::mutex;
-decltype(sendq::cond)         sendq::cond;
+decltype(sendq::inbox)        sendq::inbox {nullptr};
+decltype(sendq::efd)          sendq::efd {::eventfd(0,EFD_CLOEXEC)};
 decltype(sendq::interrupted)  sendq::interrupted;
 decltype(sendq::ecbs)         sendq::ecbs;
 decltype(sendq::queue)        sendq::queue;
 decltype(sendq::slowq)        sendq::slowq;
+decltype(sendq::total)        sendq::total {0};
 decltype(sendq::thread)       sendq::thread {&sendq::worker};
 static const scope join([]
 {
@@ -28,7 +30,75 @@ static const scope join([]
 void sendq::interrupt()
 {
 	interrupted.store(true,std::memory_order_release);
-	cond.notify_all();
+	wake();
+}
+
+
+/**
+ * Producers only push onto the inbox. The one that finds it empty wakes the
+ * worker; the rest know a wakeup is already pending, so a burst costs one
+ * eventfd write and no lock is shared with the worker while it sends.
+ */
+void sendq::submit(Ent &&ent)
+{
+	const auto node(new Node{std::move(ent),nullptr});
+	node->ent.queued = steady_clock::now();
+	total.fetch_add(1,std::memory_order_relaxed);
+	auto head(inbox.load(std::memory_order_relaxed));
+	do
+	{
+		node->next = head;
+	}
+	while(!inbox.compare_exchange_weak(head,node,std::memory_order_release,std::memory_order_relaxed));
+
+	if(!head)
+		wake();
+}
+
+
+void sendq::wake()
+{
+	const uint64_t one(1);
+	if(::write(efd,&one,sizeof(one)) < 0 && errno != EAGAIN)
+		std::cerr << "\033[1;31m[sendq]: eventfd write: " << strerror(errno) << "\033[0m" << std::endl;
+}
+
+
+void sendq::wait(const milliseconds &timeout)
+{
+	const auto ms(timeout.count() >= std::numeric_limits<int>::max()? -1 : int(timeout.count()));
+	struct pollfd pfd {efd,POLLIN,0};
+	if(::poll(&pfd,1,ms) > 0 && (pfd.revents & POLLIN))
+	{
+		uint64_t val;
+		if(::read(efd,&val,sizeof(val)) < 0 && errno != EAGAIN)
+			std::cerr << "\033[1;31m[sendq]: eventfd read: " << strerror(errno) << "\033[0m" << std::endl;
+	}
+}
+
+
+/**
+ * Takes everything submitted so far into the queue, in submission order. Also
+ * called by purge() so nothing for a purged socket is still in flight.
+ */
+void sendq::drain()
+{
+	Node *node(inbox.exchange(nullptr,std::memory_order_acquire));
+	Node *prev(nullptr);
+	while(node)
+	{
+		Node *const next(node->next);
+		node->next = prev;
+		prev = node;
+		node = next;
+	}
+
+	for(node = prev; node; )
+	{
+		std::unique_ptr<Node> hold(node);
+		queue.emplace_back(std::move(node->ent));
+		node = node->next;
+	}
 }
 
 
@@ -43,28 +113,129 @@ void sendq::set_ecb(const void *const &ptr,
 void sendq::purge(const void *const &ptr)
 {
 	const std::lock_guard<decltype(mutex)> lock(mutex);
+	drain();
 
-	const auto queue_end(std::remove_if(queue.begin(),queue.end(),[&ptr]
-	(const auto &ent)
+	// remove_if() leaves moved-from kept entries past its end, so release as matched
+	const auto match([&ptr](const Ent &ent)
 	{
-		return ent.sd == ptr;
-	}));
+		if(ent.sd != ptr)
+			return false;
 
-	const auto slowq_end(std::remove_if(slowq.begin(),slowq.end(),[&ptr]
-	(const auto &ent)
-	{
-		return ent.sd == ptr;
-	}));
+		release(ent);
+		return true;
+	});
 
-	queue.erase(queue_end,queue.end());
-	slowq.erase(slowq_end,slowq.end());
+	queue.erase(std::remove_if(queue.begin(),queue.end(),match),queue.end());
+	slowq.erase(std::remove_if(slowq.begin(),slowq.end(),match),slowq.end());
 	ecbs.erase(ptr);
 }
 
 
+/**
+ * Drops the first line still queued for the socket that starts with any of the
+ * prefixes, and moves each later one of those up into the slot of the one before it. The last slot is
+ * returned for the line replacing it, so a full queue stays within its pacing
+ * rather than falling further behind.
+ */
+bool sendq::shift(const void *const &ptr,
+                  const std::vector<std::string> &prefixes,
+                  time_point &slot)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	drain();
+
+	std::vector<Ent *> ents;
+	const auto gather([&ptr,&prefixes,&ents]
+	(Ent &ent)
+	{
+		if(ent.sd != ptr)
+			return;
+
+		if(std::any_of(prefixes.begin(),prefixes.end(),[&ent]
+		(const std::string &prefix)
+		{
+			return boost::starts_with(ent.pck,prefix);
+		}))
+			ents.emplace_back(&ent);
+	});
+
+	std::for_each(queue.begin(),queue.end(),gather);
+	std::for_each(slowq.begin(),slowq.end(),gather);
+	if(ents.empty())
+		return false;
+
+	std::stable_sort(ents.begin(),ents.end(),[]
+	(const Ent *const &a, const Ent *const &b)
+	{
+		return a->absolute < b->absolute;
+	});
+
+	slot = ents.back()->absolute;
+	for(size_t i(ents.size() - 1); i > 0; --i)
+		ents[i]->absolute = ents[i-1]->absolute;
+
+	Ent *const drop(ents.front());
+	release(*drop);
+	const auto match([&drop](const Ent &ent) { return &ent == drop; });
+	queue.erase(std::remove_if(queue.begin(),queue.end(),match),queue.end());
+	slowq.erase(std::remove_if(slowq.begin(),slowq.end(),match),slowq.end());
+	std::stable_sort(slowq.begin(),slowq.end(),[]
+	(const Ent &a, const Ent &b)
+	{
+		return a.absolute < b.absolute;
+	});
+
+	return true;
+}
+
+
+bool sendq::has(const void *const &ptr,
+                const std::string &pck)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	drain();
+
+	const auto match([&ptr,&pck](const Ent &ent)
+	{
+		return ent.sd == ptr && ent.pck == pck;
+	});
+
+	return std::any_of(queue.begin(),queue.end(),match) ||
+	       std::any_of(slowq.begin(),slowq.end(),match);
+}
+
+
+/**
+ * Counted as lines are submitted and released rather than taken under the
+ * mutex, which the worker holds across its writes to the sockets.
+ */
+size_t sendq::size()
+{
+	return total.load(std::memory_order_relaxed);
+}
+
+
+void sendq::release(const Ent &ent)
+{
+	total.fetch_sub(1,std::memory_order_relaxed);
+	if(ent.depth)
+		ent.depth->fetch_sub(1,std::memory_order_relaxed);
+}
+
+
+/**
+ * A line's time from submit() to the wire is all its wait: what its pacing
+ * asked for (throttle) and what it was late beyond that. A traced line has
+ * the same split recorded as spans, named for the command and its target.
+ */
 size_t sendq::send(Ent &ent)
 try
 {
+	static const auto lines(Metrics::id("ircbot_sendq_lines_total","Lines written to sockets.",Metrics::COUNTER));
+	static const auto bytes(Metrics::id("ircbot_sendq_bytes_total","Bytes written to sockets.",Metrics::COUNTER));
+	static const auto wire(Metrics::id("ircbot_sendq_wait_seconds","Time from submit to the wire.",Metrics::HISTOGRAM));
+	static const auto throttle(Metrics::id("ircbot_sendq_throttle_seconds","Time a line was scheduled to wait.",Metrics::HISTOGRAM));
+
 	static const boost::asio::const_buffer terminator{"\r\n",2};
 	const std::array<boost::asio::const_buffer,2> buf
 	{
@@ -73,7 +244,26 @@ try
 	};
 
 	std::cout << "\033[1;36m>> " << ent.pck << "\033[0m" << std::endl;
-	return ent.sd->send(buf);
+	const scope rel([&ent] { release(ent); });
+	const auto ret(ent.sd->send(buf));
+	const auto sent(steady_clock::now());
+	Metrics::record(wire,sent - ent.queued);
+	Metrics::record(throttle,std::max(ent.absolute - ent.queued,steady_clock::duration(0)));
+	Metrics::count(lines);
+	Metrics::count(bytes,ret);
+
+	if(ent.trace.id)
+	{
+		const auto slot(std::max(ent.absolute,ent.queued));
+		const auto detail(ent.pck.substr(0,ent.pck.find(' ',ent.pck.find(' ') + 1)));
+		Trace::span(ent.trace,"reply",detail,ent.trace.recv,sent);
+		if(slot > ent.queued)
+			Trace::span(ent.trace,ent.delayed? "delay" : "throttle",detail,ent.queued,slot);
+
+		Trace::span(ent.trace,"sendq",detail,slot,sent);
+	}
+
+	return ret;
 }
 catch(const boost::system::system_error &e)
 {
@@ -134,27 +324,34 @@ try
 {
 	while(1)
 	{
-		std::unique_lock<decltype(mutex)> lock(mutex);
-		cond.wait_for(lock,next_event());
-		if(interrupted.load(std::memory_order_consume))
-			throw Interrupted("Interrupted");
-
-		while(!queue.empty())
+		milliseconds timeout;
 		{
-			process(queue.front());
-			queue.pop_front();
+			const std::lock_guard<decltype(mutex)> lock(mutex);
+			if(interrupted.load(std::memory_order_consume))
+				throw Interrupted("Interrupted");
+
+			drain();
+			while(!queue.empty())
+			{
+				process(queue.front());
+				queue.pop_front();
+			}
+
+			while(!slowq.empty())
+			{
+				Ent &ent(slowq.front());
+				if(ent.absolute > steady_clock::now())
+					break;
+
+				send(ent);
+				slowq.pop_front();
+			}
+
+			timeout = next_event();
 		}
 
-		while(!slowq.empty())
-		{
-			Ent &ent(slowq.front());
-			if(ent.absolute > steady_clock::now())
-				break;
-
-			send(ent);
-			slowq.pop_front();
-		}
-    }
+		wait(timeout);
+	}
 }
 catch(const Internal &e)
 {
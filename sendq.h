@@ -11,23 +11,43 @@ struct Ent
 	time_point absolute;
 	boost::asio::ip::tcp::socket *sd;
 	std::string pck;
+	std::atomic<size_t> *depth;                   // submitter's count of its lines queued (or null)
+	time_point queued {};                         // set by submit()
+	Trace::Ctx trace {};                          // of the line it replies to (see: trace.h)
+	bool delayed {};                              // absolute is by the caller's delay, not the throttle
+};
+
+struct Node
+{
+	Ent ent;
+	Node *next;
 };
 
 using ECb = std::function<void (const boost::system::error_code &)>;
 
-extern std::mutex mutex;
-extern std::condition_variable cond;
+extern std::mutex mutex;                          // worker side only; producers never take it
+extern std::atomic<Node *> inbox;                 // submissions, newest first (Treiber stack)
+extern int efd;                                   // eventfd signaled when inbox becomes non-empty
 extern std::atomic<bool> interrupted;
 extern std::map<const void *, ECb> ecbs;
 extern std::deque<Ent> queue;
 extern std::deque<Ent> slowq;
 extern std::thread thread;
+extern std::atomic<size_t> total;                 // lines submitted and not yet sent or dropped
 
+void submit(Ent &&ent);                           // No lock required. Lock-free, never blocks.
 void set_ecb(const void *const &p, const ECb &c); // No lock required.
 void purge(const void *const &p);                 // No lock required.
+bool shift(const void *const &p, const std::vector<std::string> &prefixes, time_point &slot);   // No lock required.
+bool has(const void *const &p, const std::string &pck);                          // No lock required.
+size_t size();                                    // No lock required. Never blocks.
+void drain();                                     // Lock required (internal usage)
 size_t send(Ent &ent);                            // Lock required (internal usage)
+void release(const Ent &ent);                     // Lock required (internal usage)
 void slowq_add(Ent &ent);                         // Lock required (internal usage)
 void process(Ent &ent);                           // Lock required (internal usage)
 auto next_event();                                // Lock required (internal usage)
+void wait(const milliseconds &timeout);           // No lock required. (internal usage)
+void wake();                                      // No lock required.
 void interrupt();                                 // No lock required.
 void worker();                                    // Static initialized. Not advised to call.
@@ -8,22 +8,35 @@
 
 class Service : public Stream
 {
+  public:
+	using Capture = std::list<std::string, Alloc<std::string>>;
+	using Callback = std::function<void (const Capture &, const bool &error)>;
+
+  private:
+	struct Term
+	{
+		std::forward_list<std::string> strs;           // Any of these ends the capture
+		Callback cb;                                   // Given the capture after the subclass
+	};
+
+	const Context *ctx;
 	std::string name;
-	std::list<std::string> capture;                    // State of the current capture
-	std::deque<std::forward_list<std::string>> queue;  // Queue of terminators
+	Capture capture;                                   // State of the current capture
+	std::deque<Term> queue;                            // Queue of terminators
 
-	void next();                                       // Discard capture, move to next in queue
+	void next(const bool &error = false);              // Discard capture, move to next in queue
 
   public:
 	auto get_name() const                              { return name;                                  }
 	auto queue_size() const                            { return queue.size();                          }
 	auto capture_size() const                          { return capture.size();                        }
-	virtual bool enabled() const                       { return get_opts().get<bool>("services");      }
+	virtual bool enabled() const                       { return get_sess().get_opts().get<bool>("services"); }
+	static std::pair<Callback,std::future<Capture>> promise();
 
   protected:
-	using Capture = decltype(capture);
-
-	auto &get_terminator() const                       { return queue.front();                         }
+	const Context &get_ctx() const                     { return *ctx;                                  }
+	Sess &get_sess() const                             { return ctx->get_sess();                       }
+	auto &get_terminator() const                       { return queue.front().strs;                    }
 
 	// Passes a complete multipart message to subclass
 	// once the handler here receives a terminator
@@ -31,25 +44,29 @@ class Service : public Stream
 
   public:
 	void clear_capture()                               { capture.clear();                              }
-	void clear_queue()                                 { queue.clear();                                }
+	void clear_queue();                                // Callbacks are told of an error
+	void attach(Mem *const &mem)                       { Capture(mem).swap(capture);                   }
 
 	// [SEND] Add expected terminator every send
-	void terminator_next(const std::string &str)       { queue.push_back({tolower(str)});              }
-	void terminator_also(const std::string &str)       { queue.back().emplace_front(tolower(str));     }
-	void terminator_errors()                           { queue.push_back({"",""});                     }
-	void terminator_any()                              { queue.push_back({""});                        }
+	void terminator_next(const std::string &str)       { queue.push_back({{tolower(str)},nullptr});    }
+	void terminator_also(const std::string &str)       { queue.back().strs.emplace_front(tolower(str)); }
+	void terminator_errors()                           { queue.push_back({{"",""},nullptr});           }
+	void terminator_any()                              { queue.push_back({{""},nullptr});              }
+	void terminator_then(const Callback &cb)           { queue.back().cb = cb;                         }
 
 	// [RECV] Called by Bot handlers
 	void handle(const Msg &msg);
 
-	Service(const std::string &name);
+	Service(const Context &ctx, const std::string &name);
 
 	friend std::ostream &operator<<(std::ostream &s, const Service &srv);
 };
 
 
 inline
-Service::Service(const std::string &name):
+Service::Service(const Context &ctx,
+                 const std::string &name):
+ctx(&ctx),
 name(name)
 {
 }
@@ -83,8 +100,9 @@ try
 	if(msg.get_name() != "NOTICE")
 		throw Exception("Service handler only reads NOTICE.");
 
-	const auto &term = queue.front();
-	const auto &text = tolower(decolor(msg[TEXT]));
+	const auto &term = queue.front().strs;
+	const auto &lower = tolower(decolor(msg[TEXT],Arena::Alloc<char>(msg.get_arena())),Arena::Alloc<char>(msg.get_arena()));
+	const boost::string_ref text(lower.data(),lower.size());
 
 	const size_t terms = std::distance(term.begin(),term.end());
 	const bool any_term = terms == 1 && term.begin()->empty();
@@ -104,11 +122,20 @@ try
 		for(const auto &m : capture)
 			printf("[%s]\n",m.c_str());
 */
-		const scope r([&] { next(); });
 		if(capture.empty())
 			capture.emplace_back(decolor(msg[TEXT]));
 
-		captured(capture);
+		try
+		{
+			captured(capture);
+		}
+		catch(...)
+		{
+			next(true);
+			throw;
+		}
+
+		next();
 		return;
 	}
 
@@ -117,14 +144,19 @@ try
 
 	if(err_term && !error)
 	{
+		const auto cb(std::move(queue.front().cb));
 		queue.pop_front();
+		if(cb)
+			cb({},false);
+
 		handle(msg);
 		return;
 	}
 
 	if(any_term || error)
 	{
-		next();
+		capture.emplace_back(decolor(msg[TEXT]));
+		next(error);
 		return;
 	}
 
@@ -137,10 +169,41 @@ catch(const std::out_of_range &e)
 
 
 inline
-void Service::next()
+void Service::next(const bool &error)
 {
+	const auto cb(std::move(queue.front().cb));
+	const auto cap(std::move(capture));
 	queue.pop_front();
 	capture.clear();
+
+	if(cb)
+		cb(cap,error);
+}
+
+
+inline
+void Service::clear_queue()
+{
+	auto queue(std::move(this->queue));
+	this->queue.clear();
+	for(const auto &term : queue)
+		if(term.cb)
+			term.cb({},true);
+}
+
+
+inline
+std::pair<Service::Callback,std::future<Service::Capture>> Service::promise()
+{
+	const auto p(std::make_shared<std::promise<Capture>>());
+	return {[p](const Capture &capture, const bool &error)
+	{
+		if(error)
+			p->set_exception(std::make_exception_ptr(Exception(capture.empty()? "no reply" : capture.back())));
+		else
+			p->set_value(capture);
+	},
+	p->get_future()};
 }
 
 
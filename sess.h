@@ -15,10 +15,12 @@ class Sess
 	std::mutex &mutex;                                 // downstream reference to Bot mutex
 	boost::asio::io_service &ios;                      // Associated IOService
 	boost::asio::steady_timer timer;                   // Session's timer
+	boost::asio::steady_timer retry;                   // Pending (re)connect
 	boost::asio::strand strand;                        // Session events' mutex
 	State state;                                       // Session State
 	flag_t flags;                                      // Session flags indicator
 	Socket socket;
+	Backoff backoff;                                   // Delay of the next reconnect
 	Server server;                                     // Filled at connection time
 	Mode mode;                                         // UMODE
 	std::set<std::string> caps;                        // registered capabilities (full LS in Server)
@@ -31,10 +33,12 @@ class Sess
 	auto &get_mutex() const                            { return const_cast<std::mutex &>(mutex);    }
 	auto &get_ios() const                              { return ios;                                }
 	auto &get_timer() const                            { return timer;                              }
+	auto &get_retry() const                            { return retry;                              }
 	auto &get_strand() const                           { return strand;                             }
 	auto &get_state() const                            { return state;                              }
 	auto &get_flags() const                            { return flags;                              }
 	auto &get_socket() const                           { return socket;                             }
+	auto &get_backoff() const                          { return backoff;                            }
 	auto &get_server() const                           { return server;                             }
 	auto &get_isupport() const                         { return get_server().isupport;              }
 	auto &get_nick() const                             { return nick;                               }
@@ -54,8 +58,10 @@ class Sess
 	auto &get_opts()                                   { return opts;                               }
 	auto &get_mutex()                                  { return mutex;                              }
 	auto &get_timer()                                  { return timer;                              }
+	auto &get_retry()                                  { return retry;                              }
 	auto &get_strand()                                 { return strand;                             }
 	auto &get_socket()                                 { return socket;                             }
+	auto &get_backoff()                                { return backoff;                            }
 
 	void set(const State &state)                       { this->state = state;                       }
 	void set(const Flag &flags)                        { this->flags |= flags;                      }
@@ -89,15 +95,23 @@ opts(opts),
 mutex(mutex),
 ios(ios),
 timer(ios),
+retry(ios),
 strand(ios),
 state(State::INACTIVE),
 flags(Flag::NONE),
 socket(this->opts,ios),
+backoff(milliseconds(this->opts.get<int64_t>("reconnect-min")),
+        milliseconds(this->opts.get<int64_t>("reconnect-max"))),
 nick(this->opts["nick"])
 {
-	// Use the same global locale for each session for now.
-	// Raise an issue if you have a case for this being a problem.
-	irc::bot::locale = std::locale(this->opts["locale"].c_str());
+	// Use the same global locale for each session for now; the first session sets it,
+	// as others may be reading it on their own threads. Raise an issue if you have a
+	// case for this being a problem.
+	static std::once_flag locale_once;
+	std::call_once(locale_once,[this]
+	{
+		irc::bot::locale = std::locale(this->opts["locale"].c_str());
+	});
 }
 
 
@@ -124,6 +138,11 @@ std::ostream &operator<<(std::ostream &s,
 	s << "nick:            " << ss.get_nick() << std::endl;
 	s << "mode:            " << ss.get_mode() << std::endl;
 
+	const auto &sock(ss.get_socket());
+	const auto &bound(sock.get_bound());
+	s << "sendq:           " << sock.get_depth() << "/" << bound.max << " " << reflect(bound.policy)
+	  << " (dropped: " << bound.dropped << " rejected: " << bound.rejected << ")" << std::endl;
+
 	s << "caps:            ";
 	for(const auto &cap : ss.caps)
 		s << "[" << cap << "]";
@@ -0,0 +1,138 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * One logical account database spread over count ldb instances by a hash of
+ * the key. Writes to different shards don't serialize on one LevelDB writer.
+ *
+ * A path is opened once per process: every Adb (i.e every Bot) naming the same
+ * path shares the instances, their block caches and LevelDB's background
+ * compaction thread, rather than fighting over the LOCK file.
+ *
+ * On disk a single shard is the path itself (the layout before sharding);
+ * otherwise the shards are path.0 ... path.N-1 and path.shards records N and
+ * the name of the hash, since the placement of every key depends on both. The
+ * hash is 64-bit FNV-1a over the key's bytes as unsigned, so it is the same on
+ * every platform and is never changed in place: another would get a new name.
+ */
+class Shards
+{
+  public:
+	using Ldb = stldb::ldb<std::string,std::string>;
+
+  private:
+	static constexpr const char *HASH = "fnv1a64";       // recorded in path.shards
+
+	static std::mutex mutex;                             // bot.cpp
+	static std::map<std::string,std::weak_ptr<Shards>> opened;  // bot.cpp
+
+	std::string path;
+	std::vector<std::unique_ptr<Ldb>> ldbs;
+
+	static size_t read_count(const std::string &path);
+	static uint64_t place(const std::string &key);
+
+  public:
+	auto &get_path() const                               { return path;                              }
+	size_t size() const                                  { return ldbs.size();                       }
+	Ldb &operator[](const size_t &i) const               { return *ldbs.at(i);                       }
+	Ldb &of(const std::string &key) const                { return *ldbs[place(key) % ldbs.size()];   }
+
+	static std::shared_ptr<Shards> open(const std::string &path, const size_t &count = 1);
+
+	Shards(const std::string &path, const size_t &count);
+	Shards(const Shards &) = delete;
+	Shards &operator=(const Shards &) = delete;
+};
+
+
+inline
+std::shared_ptr<Shards> Shards::open(const std::string &path,
+                                     const size_t &count)
+{
+	const std::lock_guard<std::mutex> lock(mutex);
+	auto &weak(opened[path]);
+	auto ret(weak.lock());
+	if(ret && ret->size() != count)
+		throw Internal("Shards: ") << path << " is open with " << ret->size() << " shards, not " << count;
+
+	if(!ret)
+	{
+		ret = std::make_shared<Shards>(path,count);
+		weak = ret;
+	}
+
+	return ret;
+}
+
+
+inline
+Shards::Shards(const std::string &path,
+               const size_t &count):
+path(path)
+{
+	if(!count)
+		throw Internal("Shards: count must be at least 1");
+
+	const auto existing(read_count(path));
+	if(existing && existing != count)
+		throw Internal("Shards: ") << path << " has " << existing << " shards, not " << count;
+
+	if(count == 1)
+	{
+		ldbs.emplace_back(std::make_unique<Ldb>(path));
+		return;
+	}
+
+	for(size_t i(0); i < count; ++i)
+		ldbs.emplace_back(std::make_unique<Ldb>(path + "." + lex_cast(i)));
+
+	std::ofstream file(path + ".shards",std::ios_base::trunc);
+	file << count << ' ' << HASH << std::endl;
+}
+
+
+inline
+uint64_t Shards::place(const std::string &key)
+{
+	uint64_t ret(14695981039346656037ULL);
+	for(const uint8_t c : key)
+		ret = (ret ^ c) * 1099511628211ULL;
+
+	return ret;
+}
+
+
+/**
+ * Shard count of the database already at path: 1 for a plain instance, 0 when
+ * there is nothing there yet.
+ */
+inline
+size_t Shards::read_count(const std::string &path)
+{
+	std::ifstream file(path + ".shards");
+	if(!file.good())
+	{
+		struct stat st;
+		const bool unsharded(::stat(path.c_str(),&st) == 0);
+		const bool sharded(::stat((path + ".0").c_str(),&st) == 0);
+		if(sharded)
+			throw Internal("Shards: ") << path << ".shards is missing";
+
+		return unsharded? 1 : 0;
+	}
+
+	size_t ret(0);
+	std::string hash;
+	file >> ret >> hash;
+	if(hash != HASH)
+		throw Internal("Shards: ") << path << " was placed by hash \"" << hash << "\", not " << HASH;
+
+	return ret;
+}
+
@@ -0,0 +1,824 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * In-process fake ircd for load testing.
+ *
+ * Listens on localhost and runs its own thread. It speaks as much of the
+ * protocol as the Bot uses: CAP, registration (001-005), JOIN with NAMES,
+ * channel MODE and its lists, WHOX, WHOIS, PING and the NickServ/ChanServ
+ * replies the Bot captures. PRIVMSG and NOTICE to a channel are relayed to
+ * the other bots in it.
+ *
+ * Load is scripted with the calls below; each returns a future ready once
+ * everything has been written to the bots. Channels are filled with synthetic
+ * users (u<n>!~u<n>@u<n>.sim) which appear in NAMES, WHO and in the load.
+ *
+ * Flood lines carry their time of sending as "t=<ns>" (steady_clock) at the
+ * start of the text, so the receiver measures latency against the same clock.
+ * A bot echoing one back gives a round trip recorded here (see: take_rtts()).
+ */
+class Ircd
+{
+  public:
+	using nanoseconds = std::chrono::nanoseconds;
+
+	static constexpr const char *const NAME = "sim.ircd";
+
+	static std::string stamp();                       // "t=<ns>" for now
+	static bool stamped(const std::string &text, nanoseconds &elapsed);
+
+  private:
+	struct Client
+	{
+		boost::asio::ip::tcp::socket sd;
+		boost::asio::streambuf in;
+		std::string out;                              // lines awaiting a write
+		std::string sending;                          // lines being written
+		std::string nick;
+		std::string user;
+		bool registered;
+
+		std::string mask() const                      { return nick + "!~" + user + "@" + nick + ".bot.sim"; }
+
+		Client(boost::asio::io_service &ios): sd(ios), registered(false) {}
+	};
+
+	using Clientp = std::shared_ptr<Client>;
+
+	struct Chan
+	{
+		std::string topic;
+		std::vector<std::string> nicks;               // synthetic users
+		std::set<Clientp> members;                    // connected bots
+		size_t bans = 0;                              // length of the +b list
+		size_t quiets = 0;                            // length of the +q list
+	};
+
+	boost::asio::io_service ios;
+	boost::asio::ip::tcp::acceptor acceptor;
+	boost::asio::steady_timer timer;                  // paces flood()
+	std::set<Clientp> clients;
+	std::map<std::string,Chan> chans;                 // by lowercase name
+	size_t serial;                                    // for synthetic nicks
+
+	mutable std::mutex mutex;                         // below, shared with the caller's thread
+	std::condition_variable cond;
+	std::map<std::string,size_t> joined;              // bots in each channel
+	time_point last_in;
+	std::vector<nanoseconds> rtts;
+	std::atomic<size_t> lines_in {0};
+	std::atomic<size_t> lines_out {0};
+	std::thread thread;
+
+	template<class Func> std::future<void> script(Func&& func);
+	Chan &chan(const std::string &name)               { return chans[tolower(name)];             }
+	static std::string user_mask(const std::string &nick);
+
+	void send(const Clientp &c, const std::string &line);
+	void send(Chan &chan, const std::string &line, const Clientp &except = nullptr);
+	void numeric(const Clientp &c, const uint32_t &code, const std::string &params);
+	void notice(const Clientp &c, const std::string &from, const std::string &text);
+	void write(const Clientp &c);
+	void read(const Clientp &c);
+	void accept();
+	void close(const Clientp &c);
+
+	void welcome(const Clientp &c);
+	void names(const Clientp &c, const std::string &name, Chan &chan);
+	void who(const Clientp &c, const std::string &name);
+	void chanserv(const Clientp &c, const std::string &text);
+	void nickserv(const Clientp &c, const std::string &text);
+	void handle_join(const Clientp &c, const Msg &msg);
+	void handle_mode(const Clientp &c, const Msg &msg);
+	void handle_privmsg(const Clientp &c, const Msg &msg);
+	void handle(const Clientp &c, const Msg &msg);
+
+	void flood(const std::string &name, const size_t &rate, const size_t &count, size_t sent,
+	           const time_point &start, const std::shared_ptr<std::promise<void>> &p);
+
+  public:
+	auto get_port() const                             { return acceptor.local_endpoint().port(); }
+	size_t get_lines_in() const                       { return lines_in.load();                  }
+	size_t get_lines_out() const                      { return lines_out.load();                 }
+	std::vector<nanoseconds> take_rtts();
+
+	bool wait_joined(const std::string &chan, const size_t &bots, const milliseconds &timeout);
+	void wait_quiet(const milliseconds &quiet);        // until nothing is received for this long
+
+	// Load
+	std::future<void> netjoin(const std::string &chan, const size_t &users);
+	std::future<void> flood(const std::string &chan, const size_t &rate, const size_t &count);
+	std::future<void> nickstorm(const std::string &chan, const size_t &count);
+	std::future<void> quitstorm(const std::string &chan, const size_t &count);
+	std::future<void> set_lists(const std::string &chan, const size_t &bans, const size_t &quiets);
+
+	Ircd(const uint16_t &port = 0);                   // 0 picks a free port
+	~Ircd() noexcept;
+};
+
+
+inline
+Ircd::Ircd(const uint16_t &port):
+acceptor(ios,{boost::asio::ip::address_v4::loopback(),port}),
+timer(ios),
+serial(0),
+last_in(steady_clock::now())
+{
+	accept();
+	thread = std::thread([this]
+	{
+		const boost::asio::io_service::work work(ios);
+		ios.run();
+	});
+}
+
+
+inline
+Ircd::~Ircd()
+noexcept
+{
+	ios.stop();
+	thread.join();
+}
+
+
+template<class Func>
+std::future<void> Ircd::script(Func&& func)
+{
+	const auto p(std::make_shared<std::promise<void>>());
+	ios.post([this,p,func]
+	{
+		func();
+		p->set_value();
+	});
+
+	return p->get_future();
+}
+
+
+inline
+std::future<void> Ircd::netjoin(const std::string &name,
+                                const size_t &users)
+{
+	return script([this,name,users]
+	{
+		auto &chan(this->chan(name));
+		for(size_t i(0); i < users; i++)
+		{
+			const auto nick("u" + lex_cast(serial++));
+			chan.nicks.emplace_back(nick);
+			send(chan,":" + user_mask(nick) + " JOIN " + name + " " + nick + " :Simulated User");
+		}
+	});
+}
+
+
+inline
+std::future<void> Ircd::nickstorm(const std::string &name,
+                                  const size_t &count)
+{
+	return script([this,name,count]
+	{
+		auto &chan(this->chan(name));
+		for(size_t i(0); i < count && i < chan.nicks.size(); i++)
+		{
+			auto &nick(chan.nicks[i]);
+			const auto renamed(nick.back() == '_'? nick.substr(0,nick.size() - 1) : nick + "_");
+			send(chan,":" + user_mask(nick) + " NICK :" + renamed);
+			nick = renamed;
+		}
+	});
+}
+
+
+inline
+std::future<void> Ircd::quitstorm(const std::string &name,
+                                  const size_t &count)
+{
+	return script([this,name,count]
+	{
+		auto &chan(this->chan(name));
+		for(size_t i(0); i < count && !chan.nicks.empty(); i++)
+		{
+			send(chan,":" + user_mask(chan.nicks.back()) + " QUIT :*.net *.split");
+			chan.nicks.pop_back();
+		}
+	});
+}
+
+
+inline
+std::future<void> Ircd::set_lists(const std::string &name,
+                                  const size_t &bans,
+                                  const size_t &quiets)
+{
+	return script([this,name,bans,quiets]
+	{
+		auto &chan(this->chan(name));
+		chan.bans = bans;
+		chan.quiets = quiets;
+	});
+}
+
+
+/**
+ * Lines due by the elapsed time are sent every millisecond, so the rate holds
+ * on average whatever the timer's resolution.
+ */
+inline
+std::future<void> Ircd::flood(const std::string &name,
+                              const size_t &rate,
+                              const size_t &count)
+{
+	const auto p(std::make_shared<std::promise<void>>());
+	ios.post([this,name,rate,count,p]
+	{
+		flood(name,rate,count,0,steady_clock::now(),p);
+	});
+
+	return p->get_future();
+}
+
+
+inline
+void Ircd::flood(const std::string &name,
+                 const size_t &rate,
+                 const size_t &count,
+                 size_t sent,
+                 const time_point &start,
+                 const std::shared_ptr<std::promise<void>> &p)
+{
+	using namespace std::chrono;
+
+	auto &chan(this->chan(name));
+	const auto elapsed(duration_cast<microseconds>(steady_clock::now() - start).count());
+	const auto due(std::min(count,size_t(rate * elapsed / 1000000) + 1));
+	for(; sent < due; sent++)
+	{
+		const auto &nick(chan.nicks.empty()? std::string("u0") : chan.nicks[sent % chan.nicks.size()]);
+		send(chan,":" + user_mask(nick) + " PRIVMSG " + name + " :" + stamp() + " " + lex_cast(sent) +
+		          " Lorem ipsum dolor sit amet, consectetur adipiscing elit");
+	}
+
+	if(sent >= count)
+	{
+		p->set_value();
+		return;
+	}
+
+	timer.expires_from_now(1ms);
+	timer.async_wait([this,name,rate,count,sent,start,p]
+	(const boost::system::error_code &e)
+	{
+		if(!e)
+			flood(name,rate,count,sent,start,p);
+	});
+}
+
+
+inline
+bool Ircd::wait_joined(const std::string &name,
+                       const size_t &bots,
+                       const milliseconds &timeout)
+{
+	std::unique_lock<decltype(mutex)> lock(mutex);
+	return cond.wait_for(lock,timeout,[this,&name,&bots]
+	{
+		const auto it(joined.find(tolower(name)));
+		return it != joined.end() && it->second >= bots;
+	});
+}
+
+
+inline
+void Ircd::wait_quiet(const milliseconds &quiet)
+{
+	while(1)
+	{
+		time_point last;
+		{
+			const std::lock_guard<decltype(mutex)> lock(mutex);
+			last = last_in;
+		}
+
+		const auto until(last + quiet);
+		if(steady_clock::now() >= until)
+			return;
+
+		std::this_thread::sleep_until(until);
+	}
+}
+
+
+inline
+std::vector<Ircd::nanoseconds> Ircd::take_rtts()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	return std::move(rtts);
+}
+
+
+inline
+void Ircd::accept()
+{
+	const auto c(std::make_shared<Client>(ios));
+	acceptor.async_accept(c->sd,[this,c]
+	(const boost::system::error_code &e)
+	{
+		if(e == boost::asio::error::operation_aborted)
+			return;
+
+		if(!e)
+		{
+			c->sd.set_option(boost::asio::ip::tcp::no_delay(true));
+			clients.emplace(c);
+			read(c);
+		}
+
+		accept();
+	});
+}
+
+
+inline
+void Ircd::read(const Clientp &c)
+{
+	boost::asio::async_read_until(c->sd,c->in,"\r\n",[this,c]
+	(const boost::system::error_code &e, const size_t &size)
+	{
+		if(e)
+		{
+			close(c);
+			return;
+		}
+
+		std::string line(size,'\0');
+		std::istream(&c->in).read(&line.front(),size);
+		if(line.size() > 2)
+		{
+			lines_in.fetch_add(1,std::memory_order_relaxed);
+			{
+				const std::lock_guard<decltype(mutex)> lock(mutex);
+				last_in = steady_clock::now();
+			}
+
+			std::istringstream stream(line);
+			handle(c,Msg(stream));
+		}
+
+		if(c->sd.is_open())
+			read(c);
+	});
+}
+
+
+inline
+void Ircd::close(const Clientp &c)
+{
+	boost::system::error_code ec;
+	c->sd.close(ec);
+	for(auto &p : chans)
+		if(p.second.members.erase(c))
+		{
+			const std::lock_guard<decltype(mutex)> lock(mutex);
+			joined[p.first]--;
+		}
+
+	clients.erase(c);
+}
+
+
+inline
+void Ircd::send(const Clientp &c,
+                const std::string &line)
+{
+	if(!c->sd.is_open())
+		return;
+
+	c->out += line;
+	c->out += "\r\n";
+	lines_out.fetch_add(1,std::memory_order_relaxed);
+	if(c->sending.empty())
+		write(c);
+}
+
+
+inline
+void Ircd::send(Chan &chan,
+                const std::string &line,
+                const Clientp &except)
+{
+	for(const auto &c : chan.members)
+		if(c != except)
+			send(c,line);
+}
+
+
+inline
+void Ircd::write(const Clientp &c)
+{
+	std::swap(c->out,c->sending);
+	boost::asio::async_write(c->sd,boost::asio::buffer(c->sending),[this,c]
+	(const boost::system::error_code &e, const size_t &size)
+	{
+		c->sending.clear();
+		if(e)
+		{
+			close(c);
+			return;
+		}
+
+		if(!c->out.empty())
+			write(c);
+	});
+}
+
+
+inline
+void Ircd::numeric(const Clientp &c,
+                   const uint32_t &code,
+                   const std::string &params)
+{
+	std::stringstream ss;
+	ss << ":" << NAME << " " << std::setw(3) << std::setfill('0') << code << " " << c->nick << " " << params;
+	send(c,ss.str());
+}
+
+
+inline
+void Ircd::notice(const Clientp &c,
+                  const std::string &from,
+                  const std::string &text)
+{
+	send(c,":" + from + "!" + from + "@services. NOTICE " + c->nick + " :" + text);
+}
+
+
+inline
+void Ircd::handle(const Clientp &c,
+                  const Msg &msg)
+{
+	switch(hash(msg.get_name()))
+	{
+		case hash("CAP"):
+			if(msg[0] == "LS")
+				send(c,std::string(":") + NAME + " CAP * LS :account-notify extended-join multi-prefix");
+			else if(msg[0] == "REQ")
+				send(c,std::string(":") + NAME + " CAP " + (c->nick.empty()? "*" : c->nick) + " ACK :" + msg[1]);
+			break;
+
+		case hash("NICK"):
+			if(c->registered)
+				send(c,":" + c->mask() + " NICK :" + msg[0]);
+
+			c->nick = msg[0];
+			if(!c->registered && !c->user.empty())
+				welcome(c);
+			break;
+
+		case hash("USER"):
+			c->user = msg[0];
+			if(!c->registered && !c->nick.empty())
+				welcome(c);
+			break;
+
+		case hash("PING"):
+			send(c,std::string(":") + NAME + " PONG " + NAME + " :" + msg[0]);
+			break;
+
+		case hash("JOIN"):
+			handle_join(c,msg);
+			break;
+
+		case hash("PART"):
+		{
+			auto &chan(this->chan(msg[0]));
+			send(chan,":" + c->mask() + " PART " + msg[0] + " :" + msg[1]);
+			if(chan.members.erase(c))
+			{
+				const std::lock_guard<decltype(mutex)> lock(mutex);
+				joined[tolower(msg[0])]--;
+			}
+			break;
+		}
+
+		case hash("MODE"):
+			handle_mode(c,msg);
+			break;
+
+		case hash("WHO"):
+			for(const auto &name : tokens(msg[0],","))
+				who(c,name);
+			break;
+
+		case hash("WHOIS"):
+			numeric(c,RPL_WHOISUSER,msg[0] + " ~" + msg[0] + " " + msg[0] + ".sim * :Simulated User");
+			numeric(c,RPL_ENDOFWHOIS,msg[0] + " :End of /WHOIS list.");
+			break;
+
+		case hash("PRIVMSG"):
+		case hash("NOTICE"):
+			handle_privmsg(c,msg);
+			break;
+
+		case hash("QUIT"):
+			send(c,"ERROR :Closing Link: " + c->nick + " (Quit: " + msg[0] + ")");
+			close(c);
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+inline
+void Ircd::welcome(const Clientp &c)
+{
+	c->registered = true;
+	numeric(c,RPL_WELCOME,":Welcome to the simulated network " + c->nick);
+	numeric(c,RPL_YOURHOST,std::string(":Your host is ") + NAME + ", running version sim-1.0");
+	numeric(c,RPL_CREATED,":This server was created just now");
+	numeric(c,RPL_MYINFO,std::string(NAME) + " sim-1.0 DOQRSZaghilopswz CFILMPQSbcefgijklmnopqrstvz bkloveqjfI");
+	numeric(c,RPL_ISUPPORT,"CHANTYPES=# EXCEPTS INVEX CHANMODES=eIbq,k,flj,CFLMPQScgimnprstz CHANLIMIT=#:120 "
+	                       "PREFIX=(ov)@+ MAXLIST=bqeI:100 MODES=4 NETWORK=sim KNOCK STATUSMSG=@+ "
+	                       ":are supported by this server");
+	numeric(c,RPL_ISUPPORT,"CASEMAPPING=rfc1459 NICKLEN=16 CHANNELLEN=50 TOPICLEN=390 CPRIVMSG CNOTICE "
+	                       "MONITOR=100 TARGMAX=NAMES:1,LIST:1,KICK:1,WHOIS:1,WHO:4,PRIVMSG:4,NOTICE:4 "
+	                       "EXTBAN=$,ajrxz WHOX :are supported by this server");
+	send(c,":" + c->nick + " MODE " + c->nick + " :+i");
+}
+
+
+inline
+void Ircd::handle_join(const Clientp &c,
+                       const Msg &msg)
+{
+	for(const auto &name : tokens(msg[0],","))
+	{
+		auto &chan(this->chan(name));
+		if(!chan.members.emplace(c).second)
+			continue;
+
+		send(chan,":" + c->mask() + " JOIN " + name + " " + c->nick + " :" + c->user);
+		if(!chan.topic.empty())
+			numeric(c,RPL_TOPIC,name + " :" + chan.topic);
+
+		names(c,name,chan);
+		{
+			const std::lock_guard<decltype(mutex)> lock(mutex);
+			joined[tolower(name)]++;
+		}
+
+		cond.notify_all();
+	}
+}
+
+
+inline
+void Ircd::names(const Clientp &c,
+                 const std::string &name,
+                 Chan &chan)
+{
+	std::string line;
+	const auto flush([this,&c,&name,&line]
+	{
+		numeric(c,RPL_NAMREPLY,"= " + name + " :" + line);
+		line.clear();
+	});
+
+	const auto add([&line,&flush](const std::string &nick)
+	{
+		line += (line.empty()? "" : " ") + nick;
+		if(line.size() > 400)
+			flush();
+	});
+
+	for(const auto &m : chan.members)
+		add(m->nick);
+
+	for(const auto &nick : chan.nicks)
+		add(nick);
+
+	if(!line.empty())
+		flush();
+
+	numeric(c,RPL_ENDOFNAMES,name + " :End of /NAMES list.");
+}
+
+
+/**
+ * WHOX fields come in a fixed order whatever the order asked: for %tnha that
+ * is token, host, nick, account.
+ */
+inline
+void Ircd::who(const Clientp &c,
+               const std::string &name)
+{
+	const auto it(chans.find(tolower(name)));
+	if(it != chans.end())
+	{
+		for(const auto &m : it->second.members)
+			numeric(c,RPL_WHOSPCRPL,"0 " + m->nick + ".bot.sim " + m->nick + " 0");
+
+		for(const auto &nick : it->second.nicks)
+			numeric(c,RPL_WHOSPCRPL,"0 " + nick + ".sim " + nick + " " + nick);
+	}
+
+	numeric(c,RPL_ENDOFWHO,name + " :End of /WHO list.");
+}
+
+
+inline
+void Ircd::handle_mode(const Clientp &c,
+                       const Msg &msg)
+{
+	const auto &name(msg[0]);
+	if(name.empty() || name.at(0) != '#')
+	{
+		send(c,":" + c->nick + " MODE " + c->nick + " :" + (msg[1].empty()? "+i" : msg[1]));
+		return;
+	}
+
+	auto &chan(this->chan(name));
+	const auto &modes(msg[1]);
+	if(modes.empty())
+	{
+		numeric(c,RPL_CHANNELMODEIS,name + " +nt");
+		numeric(c,RPL_CREATIONTIME,name + " 1379283498");
+		return;
+	}
+
+	if(modes == "+b" || modes == "b")
+	{
+		for(size_t i(0); i < chan.bans; i++)
+			numeric(c,RPL_BANLIST,name + " *!*@ban" + lex_cast(i) + ".sim " + NAME + " 1444852329");
+
+		numeric(c,RPL_ENDOFBANLIST,name + " :End of Channel Ban List");
+		return;
+	}
+
+	if(modes == "+q" || modes == "q")
+	{
+		for(size_t i(0); i < chan.quiets; i++)
+			numeric(c,RPL_QUIETLIST,name + " q *!*@quiet" + lex_cast(i) + ".sim " + NAME + " 1444852329");
+
+		numeric(c,RPL_ENDOFQUIETLIST,name + " q :End of Channel Quiet List");
+		return;
+	}
+
+	if(modes == "+e" || modes == "e")
+	{
+		numeric(c,RPL_ENDOFEXCEPTLIST,name + " :End of Channel Exception List");
+		return;
+	}
+
+	if(modes == "+I" || modes == "I")
+	{
+		numeric(c,RPL_ENDOFINVITELIST,name + " :End of Channel Invite List");
+		return;
+	}
+
+	std::string line(":" + c->mask() + " MODE " + name);
+	for(size_t i(1); i < msg.num_params(); i++)
+		line += " " + msg[i];
+
+	send(chan,line);
+}
+
+
+inline
+void Ircd::handle_privmsg(const Clientp &c,
+                          const Msg &msg)
+{
+	const auto &target(msg[0]);
+	const auto &text(msg[1]);
+	switch(hash(tolower(target)))
+	{
+		case hash("chanserv"):
+			chanserv(c,text);
+			return;
+
+		case hash("nickserv"):
+			nickserv(c,text);
+			return;
+	}
+
+	nanoseconds rtt;
+	if(stamped(text,rtt))
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		rtts.emplace_back(rtt);
+	}
+
+	if(!target.empty() && target.at(0) == '#')
+		send(chan(target),":" + c->mask() + " " + msg.get_name() + " " + target + " :" + text,c);
+}
+
+
+inline
+void Ircd::chanserv(const Clientp &c,
+                    const std::string &text)
+{
+	static const char *const CS = "ChanServ";
+	const auto toks(tokens(text));
+	if(toks.size() < 2)
+		return;
+
+	const auto &name(toks.at(1));
+	switch(hash(tolower(toks.at(0))))
+	{
+		case hash("info"):
+			notice(c,CS,"Information on " + name + ":");
+			notice(c,CS,"Founder    : sim");
+			notice(c,CS,"Registered : Sep 15 22:18:18 2013 (2y 4w 1d ago)");
+			notice(c,CS,"Mode lock  : +nt");
+			notice(c,CS,"Flags      : GUARD");
+			notice(c,CS,"*** End of Info ***");
+			break;
+
+		case hash("flags"):
+		case hash("access"):
+			notice(c,CS,"Entry Nickname/Host          Flags");
+			notice(c,CS,"----- ---------------------- -----");
+			notice(c,CS,"1     sim                    +AFRefiorstv (FOUNDER) [modified 2y 4w 1d ago]");
+			notice(c,CS,"2     " + c->nick + std::string(c->nick.size() < 23? 23 - c->nick.size() : 1,' ') + "+Aiortv [modified 1d ago]");
+			notice(c,CS,"----- ---------------------- -----");
+			notice(c,CS,"End of " + name + " FLAGS listing.");
+			break;
+
+		case hash("akick"):
+			notice(c,CS,"AKICK list for " + name + ":");
+			notice(c,CS,"Total of 0 entries in " + name + "'s AKICK list.");
+			break;
+	}
+}
+
+
+inline
+void Ircd::nickserv(const Clientp &c,
+                    const std::string &text)
+{
+	static const char *const NS = "NickServ";
+	const auto toks(tokens(text));
+	if(toks.empty())
+		return;
+
+	switch(hash(tolower(toks.at(0))))
+	{
+		case hash("identify"):
+			notice(c,NS,"You are now identified for " + (toks.size() > 1? toks.at(1) : c->nick) + ".");
+			break;
+
+		case hash("listchans"):
+			notice(c,NS,"1 channel access match for the nickname " + c->nick);
+			break;
+
+		case hash("info"):
+		{
+			const auto &acct(toks.size() > 1? toks.at(1) : c->nick);
+			notice(c,NS,"Information on " + acct + " (account " + acct + "):");
+			notice(c,NS,"Registered : Jan 01 00:00:00 2012 (3y 40w 5d ago)");
+			notice(c,NS,"*** End of Info ***");
+			break;
+		}
+	}
+}
+
+
+inline
+std::string Ircd::user_mask(const std::string &nick)
+{
+	return nick + "!~" + nick + "@" + nick + ".sim";
+}
+
+
+inline
+std::string Ircd::stamp()
+{
+	using namespace std::chrono;
+
+	const auto now(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()));
+	return "t=" + lex_cast(now.count());
+}
+
+
+inline
+bool Ircd::stamped(const std::string &text,
+                   nanoseconds &elapsed)
+{
+	using namespace std::chrono;
+
+	if(text.compare(0,2,"t=") != 0)
+		return false;
+
+	const auto now(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()));
+	elapsed = now - nanoseconds(std::strtoll(text.c_str() + 2,nullptr,10));
+	return true;
+}
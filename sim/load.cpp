@@ -0,0 +1,455 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * End-to-end load driver: a Fleet of bots against the in-process Ircd.
+ *
+ * Usage: load [--key=val ...]
+ *	--scenario=all      netjoin, flood, storm, banlist or all (in that order)
+ *	--bots=1            bots in the Fleet, all in one channel
+ *	--threads=1         exec:: workers for the Fleet
+ *	--users=50000       synthetic users of the netjoin (and the storm)
+ *	--rate=10000        flood lines per second
+ *	--count=100000      flood lines in total
+ *	--bans=5000         entries of the ban list fetched by each bot
+ *	--echo              each bot sends every flood line back (round trip)
+ *	--timeout=60000     ms allowed for a scenario to complete
+ *	--out=load.json     results
+ *	--capture=          wire capture of the first bot, for sim/replay
+ *	--trace=            chrome trace of every bot (see: trace.h); --echo for replies
+ *	--verbose           keep the bots' logging on stdout
+ *
+ * A scenario is timed from the first line the Ircd sends until every bot has
+ * handled its last; flood lines are also timed one by one (see: ircd.h).
+ */
+
+#ifndef IRCBOT_VERSION
+#define IRCBOT_VERSION "unknown"
+#endif
+
+#include "bot.h"
+
+using namespace irc::bot;
+
+#include "ircd.h"
+
+
+using nanoseconds = std::chrono::nanoseconds;
+
+/**
+ * What one bot has handled. Counters are only written on the bot's thread;
+ * latencies are read once the counter shows they are all in.
+ */
+struct Probe
+{
+	std::atomic<size_t> joins {0};
+	std::atomic<size_t> nicks {0};
+	std::atomic<size_t> quits {0};
+	std::atomic<size_t> msgs {0};
+	std::atomic<size_t> lists {0};
+	std::vector<nanoseconds> latency;
+
+	void reset();
+};
+
+
+struct Result
+{
+	std::string name;
+	size_t items;                                     // lines handled by all bots
+	nanoseconds elapsed;
+	std::vector<nanoseconds> latency;                 // ircd to handler
+	std::vector<nanoseconds> rtts;                    // ircd to handler and back
+	bool complete;
+};
+
+
+void Probe::reset()
+{
+	joins = 0;
+	nicks = 0;
+	quits = 0;
+	msgs = 0;
+	lists = 0;
+	latency.clear();
+}
+
+
+static
+nanoseconds percentile(std::vector<nanoseconds> &v,
+                       const double &p)
+{
+	if(v.empty())
+		return nanoseconds(0);
+
+	const auto i(std::min(v.size() - 1,size_t(p * v.size())));
+	std::nth_element(v.begin(),v.begin() + i,v.end());
+	return v[i];
+}
+
+
+static
+void write_latency(std::ostream &s,
+                   const std::string &name,
+                   std::vector<nanoseconds> v)
+{
+	using namespace std::chrono;
+
+	const auto us([](const nanoseconds &ns) { return duration_cast<microseconds>(ns).count(); });
+	s << "\"" << name << "\": {"
+	  << "\"samples\": " << v.size() << ", "
+	  << "\"p50_us\": " << us(percentile(v,0.50)) << ", "
+	  << "\"p90_us\": " << us(percentile(v,0.90)) << ", "
+	  << "\"p99_us\": " << us(percentile(v,0.99)) << ", "
+	  << "\"max_us\": " << us(v.empty()? nanoseconds(0) : *std::max_element(v.begin(),v.end()))
+	  << "}";
+}
+
+
+static
+void write_results(std::ostream &s,
+                   const Opts &opts,
+                   std::vector<Result> &results)
+{
+	using namespace std::chrono;
+
+	s << "{" << std::endl;
+	s << "\t\"version\": \"" << IRCBOT_VERSION << "\"," << std::endl;
+	s << "\t\"bots\": " << opts["bots"] << "," << std::endl;
+	s << "\t\"threads\": " << opts["threads"] << "," << std::endl;
+	s << "\t\"results\": [" << std::endl;
+	for(auto it(results.begin()); it != results.end(); ++it)
+	{
+		const auto ms(duration_cast<microseconds>(it->elapsed).count() / 1000.0);
+		s << "\t\t{"
+		  << "\"name\": \"" << it->name << "\", "
+		  << "\"complete\": " << (it->complete? "true" : "false") << ", "
+		  << "\"items\": " << it->items << ", "
+		  << std::fixed << std::setprecision(2)
+		  << "\"elapsed_ms\": " << ms << ", "
+		  << "\"items_per_sec\": " << (ms > 0.0? it->items * 1000.0 / ms : 0.0) << ", ";
+		write_latency(s,"latency",it->latency);
+		s << ", ";
+		write_latency(s,"rtt",it->rtts);
+		s << "}" << (std::next(it) != results.end()? "," : "") << std::endl;
+	}
+
+	s << "\t]" << std::endl;
+	s << "}" << std::endl;
+}
+
+
+class Driver
+{
+	const Opts &opts;
+	const std::string chan;
+	Ircd ircd;
+	std::vector<std::unique_ptr<Probe>> probes;       // outlive the bots' handlers
+	Fleet fleet;
+	std::vector<Bot *> bots;
+	size_t users;                                     // synthetic users in chan
+
+	size_t sum(std::atomic<size_t> Probe::*const &counter) const;
+	bool wait(std::atomic<size_t> Probe::*const &counter, const size_t &target);
+	Result collect(const std::string &name, const time_point &start, std::atomic<size_t> Probe::*const &counter, const size_t &target);
+	void reset();
+	void populate();                                  // netjoin first if nobody is in chan
+
+	void add_bot(const size_t &i);
+
+  public:
+	Result netjoin();
+	Result flood();
+	Result storm();
+	Result banlist();
+
+	Driver(const Opts &opts);
+};
+
+
+Driver::Driver(const Opts &opts):
+opts(opts),
+chan("#load"),
+fleet(opts.get<size_t>("threads")),
+users(0)
+{
+	const auto num(opts.get<size_t>("bots"));
+	for(size_t i(0); i < num; i++)
+		add_bot(i);
+
+	fleet.for_each([](Bot &bot)
+	{
+		bot.connect();
+	});
+
+	if(!ircd.wait_joined(chan,num,milliseconds(opts.get<int64_t>("timeout"))))
+		throw Exception("Bots did not all join ") << chan;
+
+	// Let the post-join fetches finish before anything is timed; the bots
+	// joining each other aren't load either.
+	ircd.wait_quiet(500ms);
+	for(auto &probe : probes)
+		probe->reset();
+}
+
+
+void Driver::add_bot(const size_t &i)
+{
+	Opts bo;
+	bo["nick"] = "sim" + lex_cast(i);
+	bo["host"] = "127.0.0.1";
+	bo["port"] = lex_cast(ircd.get_port());
+	bo["connect-interval"] = "0";
+	bo["reconnect"] = "false";
+	bo["throttle-msg"] = "0";
+	bo["throttle-join"] = "0";
+	bo["sendq-max"] = "0";
+	bo["target-max"] = "0";
+	bo.autojoin.emplace_back(chan);
+	bo["trace-file"] = opts["trace"];
+	if(i == 0)
+		bo["capture-file"] = opts["capture"];
+
+	probes.emplace_back(std::make_unique<Probe>());
+	auto &probe(*probes.back());
+	auto &bot(fleet.add(bo["nick"],bo));
+	bots.emplace_back(&bot);
+
+	const auto &self(bo["nick"]);
+	const bool echo(opts.get<bool>("echo"));
+	auto &events(bot.events);
+	events.msg.add("JOIN",[&probe,self](const Msg &msg)
+	{
+		if(msg.get_nick() != self)
+			probe.joins.fetch_add(1,std::memory_order_release);
+	},handler::RECURRING);
+
+	events.msg.add("NICK",[&probe](const Msg &msg)
+	{
+		probe.nicks.fetch_add(1,std::memory_order_release);
+	},handler::RECURRING);
+
+	events.msg.add("QUIT",[&probe](const Msg &msg)
+	{
+		probe.quits.fetch_add(1,std::memory_order_release);
+	},handler::RECURRING);
+
+	events.msg.add("PRIVMSG",[&probe,&bot,echo](const Msg &msg)
+	{
+		using namespace fmt::PRIVMSG;
+
+		nanoseconds elapsed;
+		if(!Ircd::stamped(msg[TEXT],elapsed))
+			return;
+
+		probe.latency.emplace_back(elapsed);
+
+		// NOTICE so the other bots don't take it for load
+		if(echo)
+			Quote(bot.context,"NOTICE") << msg[SELFNAME] << " :" << msg[TEXT];
+
+		probe.msgs.fetch_add(1,std::memory_order_release);
+	},handler::RECURRING);
+}
+
+
+size_t Driver::sum(std::atomic<size_t> Probe::*const &counter)
+const
+{
+	size_t ret(0);
+	for(const auto &probe : probes)
+		ret += ((*probe).*counter).load(std::memory_order_acquire);
+
+	return ret;
+}
+
+
+bool Driver::wait(std::atomic<size_t> Probe::*const &counter,
+                  const size_t &target)
+{
+	const auto until(steady_clock::now() + milliseconds(opts.get<int64_t>("timeout")));
+	while(sum(counter) < target)
+	{
+		if(steady_clock::now() > until)
+			return false;
+
+		std::this_thread::sleep_for(1ms);
+	}
+
+	return true;
+}
+
+
+Result Driver::collect(const std::string &name,
+                       const time_point &start,
+                       std::atomic<size_t> Probe::*const &counter,
+                       const size_t &target)
+{
+	Result ret;
+	ret.name = name;
+	ret.complete = wait(counter,target);
+	ret.elapsed = steady_clock::now() - start;
+	ret.items = sum(counter);
+	for(auto &probe : probes)
+		std::copy(probe->latency.begin(),probe->latency.end(),std::back_inserter(ret.latency));
+
+	if(opts.get<bool>("echo"))
+	{
+		ircd.wait_quiet(100ms);
+		ret.rtts = ircd.take_rtts();
+	}
+
+	std::cerr << std::setw(12) << std::left << name
+	          << (ret.complete? "" : "INCOMPLETE ")
+	          << ret.items << " lines in "
+	          << std::chrono::duration_cast<milliseconds>(ret.elapsed).count() << "ms"
+	          << std::endl;
+
+	reset();
+	return ret;
+}
+
+
+void Driver::reset()
+{
+	// Wait out what the bots send in reply so it isn't counted in the next scenario.
+	ircd.wait_quiet(200ms);
+	for(auto &probe : probes)
+		probe->reset();
+}
+
+
+void Driver::populate()
+{
+	if(!users)
+		netjoin();
+}
+
+
+Result Driver::netjoin()
+{
+	const auto num(opts.get<size_t>("users"));
+	const auto start(steady_clock::now());
+	ircd.netjoin(chan,num);
+	users += num;
+	return collect("netjoin",start,&Probe::joins,num * bots.size());
+}
+
+
+Result Driver::flood()
+{
+	populate();
+	const auto count(opts.get<size_t>("count"));
+	const auto start(steady_clock::now());
+	ircd.flood(chan,opts.get<size_t>("rate"),count);
+	return collect("flood",start,&Probe::msgs,count * bots.size());
+}
+
+
+/**
+ * Everyone changes nick and changes it back, then half the channel splits.
+ */
+Result Driver::storm()
+{
+	populate();
+	const auto start(steady_clock::now());
+	ircd.nickstorm(chan,users);
+	ircd.nickstorm(chan,users);
+	if(!wait(&Probe::nicks,users * 2 * bots.size()))
+		return collect("storm",start,&Probe::nicks,users * 2 * bots.size());
+
+	const auto quits(users / 2);
+	ircd.quitstorm(chan,quits);
+	users -= quits;
+	return collect("storm",start,&Probe::quits,quits * bots.size());
+}
+
+
+Result Driver::banlist()
+{
+	const auto bans(opts.get<size_t>("bans"));
+	ircd.set_lists(chan,bans,0).wait();
+
+	const auto start(steady_clock::now());
+	for(size_t i(0); i < bots.size(); i++)
+	{
+		auto &bot(*bots.at(i));
+		auto &probe(*probes.at(i));
+		bot.sess.post([this,&bot,&probe]
+		{
+			bot.set_tls_context();
+			bot.chans.get(chan).banlist([&probe](const Pending::Reply &reply)
+			{
+				probe.lists.fetch_add(reply.msgs.size(),std::memory_order_release);
+			});
+		});
+	}
+
+	// Each reply also holds its end numeric
+	return collect("banlist",start,&Probe::lists,(bans + 1) * bots.size());
+}
+
+
+int main(int argc, char **argv)
+try
+{
+	Opts opts;
+	opts.clear();
+	opts["scenario"] = "all";
+	opts["bots"] = "1";
+	opts["threads"] = "1";
+	opts["users"] = "50000";
+	opts["rate"] = "10000";
+	opts["count"] = "100000";
+	opts["bans"] = "5000";
+	opts["echo"] = "false";
+	opts["timeout"] = "60000";
+	opts["out"] = "load.json";
+	opts["capture"] = "";
+	opts["trace"] = "";
+	opts["verbose"] = "false";
+	opts.parse(std::vector<std::string>(argv + 1,argv + argc));
+
+	// The bots log every line; the results don't need them to.
+	if(!opts.get<bool>("verbose"))
+		std::cout.setstate(std::ios::badbit);
+
+	const auto &scenario(opts["scenario"]);
+	const auto run([&scenario](const std::string &name)
+	{
+		return scenario == "all" || scenario == name;
+	});
+
+	std::vector<Result> results;
+	{
+		Driver driver(opts);
+		if(run("netjoin"))
+			results.emplace_back(driver.netjoin());
+
+		if(run("flood"))
+			results.emplace_back(driver.flood());
+
+		if(run("storm"))
+			results.emplace_back(driver.storm());
+
+		if(run("banlist"))
+			results.emplace_back(driver.banlist());
+	}
+
+	if(opts.has("trace"))
+		Trace::dump(opts["trace"]);
+
+	std::ofstream out(opts["out"]);
+	write_results(out,opts,results);
+	return std::all_of(results.begin(),results.end(),[](const Result &r) { return r.complete; })? 0 : 1;
+}
+catch(const std::exception &e)
+{
+	std::cerr << "load: " << e.what() << std::endl;
+	return 1;
+}
@@ -0,0 +1,146 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Replay driver: feeds a wire capture (see: capture.h) through a fresh Bot.
+ *
+ * Usage: replay [--key=val ...]
+ *	--capture=capture.txt   lines recorded with opts capture-file
+ *	--speed=fast            fast, or recorded to keep the captured gaps
+ *	--passes=1              each on a new Bot
+ *	--nick=                 the captured bot's nick; else taken from its 001
+ *	--out=replay.json       results
+ *	--trace=                chrome trace of the parse and dispatch of each line
+ *	--verbose               keep the bot's logging on stdout
+ *
+ * The throughput is that of the handlers and the state they keep, with no
+ * socket or sendq in the way, so captures of splits and floods can be run
+ * under a profiler and compared across versions.
+ */
+
+#ifndef IRCBOT_VERSION
+#define IRCBOT_VERSION "unknown"
+#endif
+
+#include "bot.h"
+
+using namespace irc::bot;
+
+
+struct Pass
+{
+	Replay::Result result;
+	size_t users;
+	size_t chans;
+};
+
+
+static
+std::string captured_nick(const Replay &replay)
+{
+	for(const auto &l : replay.get_lines())
+	{
+		std::istringstream stream(l.line);
+		const Msg msg(stream);
+		if(msg.get_code() == RPL_WELCOME)
+			return msg[0];
+	}
+
+	return {};
+}
+
+
+static
+void write_results(std::ostream &s,
+                   const Opts &opts,
+                   const Replay &replay,
+                   const std::vector<Pass> &passes)
+{
+	using namespace std::chrono;
+
+	s << "{" << std::endl;
+	s << "\t\"version\": \"" << IRCBOT_VERSION << "\"," << std::endl;
+	s << "\t\"capture\": \"" << opts["capture"] << "\"," << std::endl;
+	s << "\t\"speed\": \"" << opts["speed"] << "\"," << std::endl;
+	s << "\t\"lines\": " << replay.size() << "," << std::endl;
+	s << "\t\"span_ms\": " << duration_cast<milliseconds>(replay.span()).count() << "," << std::endl;
+	s << "\t\"passes\": [" << std::endl;
+	for(auto it(passes.begin()); it != passes.end(); ++it)
+	{
+		const auto &r(it->result);
+		const auto ms(duration_cast<microseconds>(r.elapsed).count() / 1000.0);
+		s << "\t\t{"
+		  << "\"lines\": " << r.lines << ", "
+		  << "\"errors\": " << r.errors << ", "
+		  << std::fixed << std::setprecision(2)
+		  << "\"elapsed_ms\": " << ms << ", "
+		  << "\"lines_per_sec\": " << (ms > 0.0? r.lines * 1000.0 / ms : 0.0) << ", "
+		  << "\"users\": " << it->users << ", "
+		  << "\"chans\": " << it->chans
+		  << "}" << (std::next(it) != passes.end()? "," : "") << std::endl;
+	}
+
+	s << "\t]" << std::endl;
+	s << "}" << std::endl;
+}
+
+
+int main(int argc, char **argv)
+try
+{
+	Opts opts;
+	opts.clear();
+	opts["capture"] = "capture.txt";
+	opts["speed"] = "fast";
+	opts["passes"] = "1";
+	opts["nick"] = "";
+	opts["out"] = "replay.json";
+	opts["trace"] = "";
+	opts["verbose"] = "false";
+	opts.parse(std::vector<std::string>(argv + 1,argv + argc));
+
+	if(!opts.get<bool>("verbose"))
+		std::cout.setstate(std::ios::badbit);
+
+	const Replay replay(opts["capture"]);
+	const auto speed(opts["speed"] == "recorded"? Replay::RECORDED : Replay::FAST);
+
+	Opts bo;
+	bo["nick"] = opts["nick"].empty()? captured_nick(replay) : opts["nick"];
+	bo["throttle-msg"] = "0";
+	bo["target-max"] = "0";
+	bo["sendq-max"] = "0";
+	bo["trace-file"] = opts["trace"];
+
+	std::vector<Pass> passes;
+	for(size_t i(0); i < opts.get<size_t>("passes"); i++)
+	{
+		Bot bot(bo);
+		const std::lock_guard<Bot> lock(bot);
+		const auto res(replay(bot,speed));
+		passes.push_back({res,bot.users.num(),bot.chans.num()});
+
+		std::cerr << "pass " << i << ": "
+		          << res.lines << " lines in "
+		          << std::chrono::duration_cast<milliseconds>(res.elapsed).count() << "ms"
+		          << (res.errors? " (" + lex_cast(res.errors) + " errors)" : std::string{})
+		          << std::endl;
+	}
+
+	if(opts.has("trace"))
+		Trace::dump(opts["trace"]);
+
+	std::ofstream out(opts["out"]);
+	write_results(out,opts,replay,passes);
+	return 0;
+}
+catch(const std::exception &e)
+{
+	std::cerr << "replay: " << e.what() << std::endl;
+	return 1;
+}
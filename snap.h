@@ -0,0 +1,353 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Immutable, memory-mapped snapshot of the account database.
+ *
+ * File layout:
+ *	[Head] [key][val][key][val]... [pad to 8] [Ent 0][Ent 1]...[Ent count-1]
+ *
+ * The Ent index is sorted by key (bytewise) so lookups are a binary search over
+ * the mapping. Keys and values are served as string_refs into the mapping and
+ * remain valid as long as the Snap instance is alive.
+ */
+class Snap
+{
+  public:
+	using string_ref = boost::string_ref;
+
+	static constexpr const char *const MAGIC            = "IRCBOTSN";
+	static constexpr uint32_t VERSION                   = 1;
+
+	struct Head
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t flags;
+		uint64_t count;                                 // number of Ent in the index
+		uint64_t index;                                 // file offset of the Ent index
+	};
+
+	struct Ent
+	{
+		uint64_t key_off;
+		uint64_t val_off;
+		uint32_t key_len;
+		uint32_t val_len;
+	};
+
+  private:
+	const char *map;
+	size_t len;
+	ino_t ino;                                          // identity of the mapped file for reloads
+	time_t mtime;
+
+	auto &head() const                                  { return *reinterpret_cast<const Head *>(map); }
+	auto index() const                                  { return reinterpret_cast<const Ent *>(map + head().index); }
+	const Ent *find(const string_ref &key) const;
+
+  public:
+	auto &get_ino() const                               { return ino;                                }
+	auto &get_mtime() const                             { return mtime;                              }
+	auto count() const                                  { return size_t(head().count);               }
+	auto key(const size_t &i) const                     { return string_ref(map + index()[i].key_off, index()[i].key_len); }
+	auto val(const size_t &i) const                     { return string_ref(map + index()[i].val_off, index()[i].val_len); }
+	bool exists(const string_ref &key) const            { return find(key) != nullptr;               }
+	string_ref get(const string_ref &key) const;        // data() is null when not found
+	size_t lower_bound(const string_ref &key) const;    // index of the first key not less than key
+	void willneed(const size_t &beg, const size_t &end) const;   // read-ahead hint for index range
+
+	template<class Func> void for_each(Func&& func) const;                        // void (key, val)
+	template<class It> static size_t write(const std::string &path, It&& begin, It&& end);
+	template<class Gen> static size_t write(const std::string &path, Gen&& gen);  // gen(void (key, val))
+
+	Snap(const std::string &path);
+	Snap(const Snap &) = delete;
+	Snap &operator=(const Snap &) = delete;
+	~Snap() noexcept;
+};
+
+
+inline
+Snap::Snap(const std::string &path):
+map(nullptr),
+len(0)
+{
+	const int fd(::open(path.c_str(),O_RDONLY|O_CLOEXEC));
+	if(fd < 0)
+		throw Internal(errno,"Snap: failed to open ") << path;
+
+	const scope close([&fd]
+	{
+		::close(fd);
+	});
+
+	struct stat st;
+	if(::fstat(fd,&st) < 0)
+		throw Internal(errno,"Snap: failed to stat ") << path;
+
+	ino = st.st_ino;
+	mtime = st.st_mtime;
+	len = st.st_size;
+	if(len < sizeof(Head))
+		throw Internal("Snap: file too small: ") << path;
+
+	void *const ptr(::mmap(nullptr,len,PROT_READ,MAP_SHARED,fd,0));
+	if(ptr == MAP_FAILED)
+		throw Internal(errno,"Snap: failed to map ") << path;
+
+	map = static_cast<const char *>(ptr);
+	::madvise(ptr,len,MADV_RANDOM);
+
+	const auto &h(head());
+	const bool valid(memcmp(h.magic,MAGIC,sizeof(h.magic)) == 0 &&
+	                 h.version == VERSION &&
+	                 h.index >= sizeof(Head) &&
+	                 h.index % alignof(Ent) == 0 &&
+	                 h.index <= len &&
+	                 h.count <= (len - h.index) / sizeof(Ent));
+
+	if(!valid)
+	{
+		::munmap(ptr,len);
+		throw Internal("Snap: bad header: ") << path;
+	}
+
+	// Every key and value lies between the header and the index.
+	const auto ents(index());
+	for(size_t i(0); i < h.count; ++i)
+	{
+		const auto &ent(ents[i]);
+		if(ent.key_off < sizeof(Head) || ent.key_off > h.index || ent.key_len > h.index - ent.key_off ||
+		   ent.val_off < sizeof(Head) || ent.val_off > h.index || ent.val_len > h.index - ent.val_off)
+		{
+			::munmap(ptr,len);
+			throw Internal("Snap: bad entry ") << i << ": " << path;
+		}
+	}
+}
+
+
+inline
+Snap::~Snap()
+noexcept
+{
+	::munmap(const_cast<char *>(map),len);
+}
+
+
+template<class It>
+size_t Snap::write(const std::string &path,
+                   It&& begin,
+                   It&& end)
+{
+	return write(path,[&begin,&end]
+	(const auto &func)
+	{
+		for(auto it(begin); it != end; ++it)
+			func(std::string{it->first},std::string{it->second});
+	});
+}
+
+
+template<class Gen>
+size_t Snap::write(const std::string &path,
+                   Gen&& gen)
+{
+	const auto tmp(path + ".tmp");
+	std::ofstream file(tmp,std::ios_base::binary|std::ios_base::trunc);
+	file.exceptions(std::ios_base::badbit|std::ios_base::failbit);
+
+	// A failed write leaves nothing behind; path still has the last good one.
+	bool done(false);
+	const scope remove([&tmp,&done]
+	{
+		if(!done)
+			::unlink(tmp.c_str());
+	});
+
+	Head head {{0},VERSION,0,0,0};
+	memcpy(head.magic,MAGIC,sizeof(head.magic));
+	file.write(reinterpret_cast<const char *>(&head),sizeof(head));
+
+	std::vector<std::pair<std::string,Ent>> index;
+	gen([&file,&index]
+	(const string_ref &key, const string_ref &val)
+	{
+		Ent ent;
+		ent.key_off = uint64_t(file.tellp());
+		ent.key_len = key.size();
+		ent.val_off = ent.key_off + key.size();
+		ent.val_len = val.size();
+		file.write(key.data(),key.size());
+		file.write(val.data(),val.size());
+		index.emplace_back(key.to_string(),ent);
+	});
+
+	std::sort(index.begin(),index.end(),[]
+	(const auto &a, const auto &b)
+	{
+		return a.first < b.first;
+	});
+
+	static const char pad[alignof(Ent)] {0};
+	file.write(pad,(alignof(Ent) - uint64_t(file.tellp()) % alignof(Ent)) % alignof(Ent));
+	head.index = uint64_t(file.tellp());
+	head.count = index.size();
+	for(const auto &p : index)
+		file.write(reinterpret_cast<const char *>(&p.second),sizeof(Ent));
+
+	file.seekp(0);
+	file.write(reinterpret_cast<const char *>(&head),sizeof(head));
+	file.close();
+
+	// Readers see either the old file or the new file; never a partial one.
+	if(std::rename(tmp.c_str(),path.c_str()) < 0)
+		throw Internal(errno,"Snap: failed to rename ") << tmp << " to " << path;
+
+	done = true;
+	return index.size();
+}
+
+
+template<class Func>
+void Snap::for_each(Func&& func)
+const
+{
+	for(size_t i(0); i < count(); ++i)
+		func(key(i),val(i));
+}
+
+
+inline
+Snap::string_ref Snap::get(const string_ref &key)
+const
+{
+	const auto ent(find(key));
+	return ent? string_ref(map + ent->val_off,ent->val_len) : string_ref{};
+}
+
+
+inline
+const Snap::Ent *Snap::find(const string_ref &key)
+const
+{
+	const auto i(lower_bound(key));
+	if(i == count() || this->key(i) != key)
+		return nullptr;
+
+	return index() + i;
+}
+
+
+inline
+size_t Snap::lower_bound(const string_ref &key)
+const
+{
+	const auto beg(index());
+	const auto end(beg + count());
+	const auto it(std::lower_bound(beg,end,key,[this]
+	(const Ent &ent, const string_ref &key)
+	{
+		return string_ref(map + ent.key_off,ent.key_len) < key;
+	}));
+
+	return it - beg;
+}
+
+
+/**
+ * Snap::write() lays records out in the order the ldb iterates, which is key
+ * order, so a range of the index covers one contiguous span of the file.
+ */
+inline
+void Snap::willneed(const size_t &beg,
+                    const size_t &end)
+const
+{
+	if(beg >= end || end > count())
+		return;
+
+	static const size_t page(::sysconf(_SC_PAGESIZE));
+	const auto &first(index()[beg]);
+	const auto &last(index()[end - 1]);
+	const size_t lo(std::min(first.key_off,last.key_off) & ~(page - 1));
+	const size_t hi(std::max(first.val_off + first.val_len,last.val_off + last.val_len));
+	if(hi > lo)
+		::madvise(const_cast<char *>(map) + lo,hi - lo,MADV_WILLNEED);
+}
+
+
+/**
+ * A snapshot path and the Snap currently served from it. When the file at the
+ * path is replaced (Snap::write() renames over it) the next get() after the
+ * check interval maps the new file and swaps it in; holders of the old Snap
+ * keep it mapped until they release it.
+ */
+class SnapFile
+{
+	std::string path;
+	milliseconds interval;                              // minimum time between stat() of path
+	mutable std::shared_ptr<const Snap> snap;           // std::atomic_load/std::atomic_store only
+	mutable std::atomic<int64_t> checked;               // steady_clock ms of the last stat()
+
+  public:
+	auto &get_path() const                              { return path;                               }
+	bool reload() const;                                // remap if the file changed; true if swapped
+	std::shared_ptr<const Snap> get() const;            // current Snap, reloading if due
+
+	SnapFile(const std::string &path, const milliseconds &interval = 1000ms);
+};
+
+
+inline
+SnapFile::SnapFile(const std::string &path,
+                   const milliseconds &interval):
+path(path),
+interval(interval),
+snap(std::make_shared<const Snap>(path)),
+checked(std::chrono::duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count())
+{
+}
+
+
+inline
+std::shared_ptr<const Snap> SnapFile::get()
+const
+{
+	using namespace std::chrono;
+
+	const auto now(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+	auto last(checked.load(std::memory_order_relaxed));
+	if(now - last >= interval.count() && checked.compare_exchange_strong(last,now))
+		reload();
+
+	return std::atomic_load(&snap);
+}
+
+
+inline
+bool SnapFile::reload()
+const try
+{
+	struct stat st;
+	if(::stat(path.c_str(),&st) < 0)
+		return false;
+
+	const auto cur(std::atomic_load(&snap));
+	if(st.st_ino == cur->get_ino() && st.st_mtime == cur->get_mtime())
+		return false;
+
+	std::atomic_store(&snap,std::make_shared<const Snap>(path));
+	return true;
+}
+catch(const Internal &e)
+{
+	std::cerr << "SnapFile::reload(): " << e << std::endl;
+	return false;
+}
@@ -8,6 +8,12 @@
 
 class Socket
 {
+  public:
+	using ConnCb = std::function<void (const boost::system::error_code &)>;
+
+  private:
+	struct Race;
+
 	const Opts &opts;
 	boost::asio::io_service &ios;
 	boost::asio::ip::tcp::endpoint ep;
@@ -16,6 +22,13 @@ class Socket
 	milliseconds delay;
 	Throttle throttle;
 	int cork;                                         // makes operator<<(flush_t) ineffective
+	std::shared_ptr<Race> race;                       // connect in progress
+	std::atomic<size_t> depth;                        // lines in sendq not yet sent
+	Bound bound;                                      // opts sendq-max/sendq-policy
+
+	void cancel_race();
+	time_point schedule();                            // next xmit time by delay or throttle
+	time_point overflow();                            // xmit time when full; min() to drop
 
   public:
 	using flush_t = Stream::flush_t;
@@ -27,7 +40,12 @@ class Socket
 	auto &get_throttle() const                        { return throttle;                          }
 	auto has_cork() const                             { return cork > 0;                          }
 	auto has_pending() const                          { return !sendq.str().empty();              }
+	auto get_depth() const                            { return depth.load();                      }
+	auto &get_bound() const                           { return bound;                             }
 	bool is_connected() const;
+	std::string get_host() const;                     // opts host, or the proxy's
+	std::string get_port() const;
+	auto get_dest() const                             { return get_host() + ":" + get_port();     }
 
 	auto &get_ep()                                    { return ep;                                }
 	auto &get_sd()                                    { return sd;                                }
@@ -38,11 +56,13 @@ class Socket
 	void unset_cork()                                 { this->cork--;                             }
 	void purge()                                      { sendq::purge(&get_sd());                  }
 	void clear();                                     // Clears the instance sendq buffer
+	void check();                                     // Throws if full and the policy rejects
 
 	Socket &operator<<(const flush_t);
 	template<class T> Socket &operator<<(const T &t);
 
 	bool disconnect(const bool &fin = true);
+	void async_connect(const ConnCb &cb);             // Resolves and races every endpoint
 	void connect();                                   // Blocking/Synchronous
 
 	Socket(const Opts &opts, boost::asio::io_service &ios);
@@ -55,26 +75,11 @@ Socket::Socket(const Opts &opts,
                boost::asio::io_service &ios):
 opts(opts),
 ios(ios),
-ep([&]() -> decltype(ep)
-{
-	using namespace boost::asio::ip;
-
-	const auto &host(opts.has("proxy")? split(opts["proxy"],":").first : opts["host"]);
-	const auto &port(opts.has("proxy")? split(opts["proxy"],":").second : opts["port"]);
-
-	boost::system::error_code ec;
-	tcp::resolver res(ios);
-	const tcp::resolver::query query(tcp::v4(),host,port,tcp::resolver::query::numeric_service);
-	const auto it(res.resolve(query,ec));
-
-	if(ec)
-		throw Internal(ec.value(),ec.message());
-
-	return *it;
-}()),
 sd(ios),
 delay(0ms),
-cork(0)
+cork(0),
+depth(0),
+bound(opts,"sendq")
 {
 
 }
@@ -84,20 +89,262 @@ inline
 Socket::~Socket()
 noexcept
 {
+	cancel_race();
 	purge();
 }
 
 
+/**
+ * Attempts to every endpoint of the host, started stagger apart in resolver
+ * order (RFC 8305). The first to connect becomes sd; the rest are closed. A
+ * failed attempt starts the next one immediately instead of waiting out the
+ * stagger. The callback gets the last error only once every attempt failed.
+ */
+struct Socket::Race : std::mutex
+{
+	using tcp = boost::asio::ip::tcp;
+	using error_code = boost::system::error_code;
+
+	Socket *sock;                                     // null once done
+	ConnCb cb;
+	milliseconds stagger;
+	boost::asio::steady_timer timer;
+	Resolver::Endpoints eps;
+	std::vector<std::unique_ptr<tcp::socket>> attempts;
+	size_t next;
+	size_t pending;
+	error_code last;
+
+	void finish(std::unique_lock<Race> &lock, const error_code &ec);
+	void launch(const std::shared_ptr<Race> &self);
+	void handle_timer(const std::shared_ptr<Race> &self, const error_code &ec);
+	void handle_conn(const std::shared_ptr<Race> &self, const size_t &idx, const error_code &ec);
+	void handle_resolve(const std::shared_ptr<Race> &self, const error_code &ec, const Resolver::Endpoints &eps);
+	void cancel();
+
+	Race(Socket &sock, const ConnCb &cb, const milliseconds &stagger);
+};
+
+
+inline
+Socket::Race::Race(Socket &sock,
+                   const ConnCb &cb,
+                   const milliseconds &stagger):
+sock(&sock),
+cb(cb),
+stagger(stagger),
+timer(sock.ios),
+next(0),
+pending(0)
+{
+
+}
+
+
+inline
+void Socket::Race::cancel()
+{
+	const std::lock_guard<Race> lock(*this);
+	sock = nullptr;
+
+	error_code ec;
+	timer.cancel(ec);
+	for(const auto &sd : attempts)
+		if(sd)
+			sd->close(ec);
+}
+
+
+inline
+void Socket::Race::handle_resolve(const std::shared_ptr<Race> &self,
+                                  const error_code &ec,
+                                  const Resolver::Endpoints &eps)
+{
+	std::unique_lock<Race> lock(*this);
+	if(!sock)
+		return;
+
+	if(ec || eps.empty())
+	{
+		finish(lock,ec? ec : boost::asio::error::host_not_found);
+		return;
+	}
+
+	this->eps = eps;
+	attempts.resize(eps.size());
+	launch(self);
+}
+
+
+inline
+void Socket::Race::handle_timer(const std::shared_ptr<Race> &self,
+                                const error_code &ec)
+{
+	if(ec == boost::asio::error::operation_aborted)
+		return;
+
+	const std::lock_guard<Race> lock(*this);
+	if(sock)
+		launch(self);
+}
+
+
+inline
+void Socket::Race::handle_conn(const std::shared_ptr<Race> &self,
+                               const size_t &idx,
+                               const error_code &ec)
+{
+	std::unique_lock<Race> lock(*this);
+	if(!sock)
+		return;
+
+	--pending;
+	if(!ec)
+	{
+		sock->sd = std::move(*attempts[idx]);
+		sock->ep = eps[idx];
+		finish(lock,ec);
+		return;
+	}
+
+	last = ec;
+	attempts[idx].reset();
+	if(next < eps.size())
+		launch(self);
+	else if(!pending)
+		finish(lock,last);
+}
+
+
+/** Requires the lock */
+inline
+void Socket::Race::launch(const std::shared_ptr<Race> &self)
+{
+	if(next >= eps.size())
+		return;
+
+	const auto idx(next++);
+	auto &sd(attempts[idx]);
+	sd = std::make_unique<tcp::socket>(sock->ios);
+	sd->async_connect(eps[idx],[self,idx]
+	(const error_code &ec)
+	{
+		self->handle_conn(self,idx,ec);
+	});
+
+	++pending;
+	if(next >= eps.size())
+		return;
+
+	// Rearming aborts the wait already pending
+	timer.expires_from_now(stagger);
+	timer.async_wait([self]
+	(const error_code &ec)
+	{
+		self->handle_timer(self,ec);
+	});
+}
+
+
+inline
+void Socket::Race::finish(std::unique_lock<Race> &lock,
+                          const error_code &ec)
+{
+	sock = nullptr;
+
+	error_code ignore;
+	timer.cancel(ignore);
+	for(const auto &sd : attempts)
+		if(sd)
+			sd->close(ignore);
+
+	const auto cb(std::move(this->cb));
+	lock.unlock();
+	cb(ec);
+}
+
+
+inline
+void Socket::async_connect(const ConnCb &cb)
+{
+	using namespace boost::asio::ip;
+
+	cancel_race();
+	if(sd.is_open())
+	{
+		boost::system::error_code ec;
+		sd.close(ec);
+	}
+
+	const milliseconds ttl(opts.get<int64_t>("dns-ttl"));
+	const milliseconds stagger(opts.get<int64_t>("connect-stagger"));
+	const auto race(std::make_shared<Race>(*this,cb,stagger));
+	this->race = race;
+	// The lookup may complete on the ios of whichever socket started it
+	auto &ios(this->ios);
+	Resolver::async_resolve(ios,get_host(),get_port(),ttl,[&ios,race]
+	(const boost::system::error_code &ec, const Resolver::Endpoints &eps)
+	{
+		ios.post([race,ec,eps]
+		{
+			race->handle_resolve(race,ec,eps);
+		});
+	});
+}
+
+
 inline
 void Socket::connect()
-try
 {
-	sd.open(boost::asio::ip::tcp::v4());
-	sd.connect(ep);
+	const milliseconds ttl(opts.get<int64_t>("dns-ttl"));
+	const auto eps(Resolver::resolve(ios,get_host(),get_port(),ttl));
+
+	cancel_race();
+	boost::system::error_code ec(boost::asio::error::host_not_found);
+	for(const auto &ep : eps)
+	{
+		sd.close(ec);
+		sd.open(ep.protocol(),ec);
+		if(!ec)
+			sd.connect(ep,ec);
+
+		if(!ec)
+		{
+			this->ep = ep;
+			return;
+		}
+	}
+
+	boost::system::error_code ignore;
+	sd.close(ignore);
+	throw Internal(ec.value(),ec.message());
 }
-catch(const boost::system::system_error &e)
+
+
+inline
+void Socket::cancel_race()
+{
+	if(!race)
+		return;
+
+	race->cancel();
+	race.reset();
+}
+
+
+inline
+std::string Socket::get_host()
+const
+{
+	return opts.has("proxy")? split(opts["proxy"],":").first : opts["host"];
+}
+
+
+inline
+std::string Socket::get_port()
+const
 {
-	throw Internal(e.what());
+	return opts.has("proxy")? split(opts["proxy"],":").second : opts["port"];
 }
 
 
@@ -105,6 +352,7 @@ inline
 bool Socket::disconnect(const bool &fin)
 try
 {
+	cancel_race();
 	if(!sd.is_open())
 		return false;
 
@@ -142,14 +390,76 @@ Socket &Socket::operator<<(const flush_t)
 	}
 
 	const scope clr(std::bind(&Socket::clear,this));
-	const auto xmit_time(delay == 0ms? throttle.next_abs() : steady_clock::now() + delay);
-	const std::lock_guard<decltype(sendq::mutex)> lock(sendq::mutex);
-	sendq::queue.push_back({xmit_time,&sd,sendq.str()});
-	sendq::cond.notify_one();
+	const auto xmit_time(bound.full(get_depth())? overflow() : schedule());
+	if(xmit_time == time_point::min())
+		return *this;
+
+	depth.fetch_add(1,std::memory_order_relaxed);
+	sendq::Ent ent{xmit_time,&sd,sendq.str(),&depth};
+	ent.trace = Trace::get_current();
+	ent.delayed = delay != 0ms;
+	sendq::submit(std::move(ent));
 	return *this;
 }
 
 
+inline
+time_point Socket::schedule()
+{
+	return delay == 0ms? throttle.next_abs() : steady_clock::now() + delay;
+}
+
+
+/**
+ * Dropping the oldest line hands its place in the pacing to this one (see:
+ * sendq::shift()), so the wait for a line stays bounded by sendq-max. Only
+ * PRIVMSG and NOTICE are dropped: losing a PONG, JOIN or QUIT would break the
+ * session, so without either queued the line waits its turn.
+ */
+inline
+time_point Socket::overflow()
+{
+	time_point slot;
+	switch(bound.policy)
+	{
+		case Overflow::REJECT:
+			check();
+			return schedule();
+
+		case Overflow::COALESCE:
+			if(sendq::has(&sd,sendq.str()))
+			{
+				bound.dropped++;
+				return time_point::min();
+			}
+			// fallthrough
+
+		case Overflow::DROP_OLDEST:
+			if(!sendq::shift(&sd,{"PRIVMSG ","NOTICE "},slot))
+				return schedule();
+
+			bound.dropped++;
+			return slot;
+
+		case Overflow::DROP_NEWEST:
+		default:
+			bound.dropped++;
+			return time_point::min();
+	}
+}
+
+
+inline
+void Socket::check()
+{
+	if(bound.policy != Overflow::REJECT || !bound.full(get_depth()))
+		return;
+
+	bound.rejected++;
+	throw Exception("Send queue full: ") << get_depth() << " lines waiting";
+}
+
+
 inline
 void Socket::clear()
 {
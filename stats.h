@@ -0,0 +1,186 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * What one Bot holds and has waiting, as a snapshot.
+ *
+ * Every figure is a container's own size or a count kept as it changes (see:
+ * chan::Tally, Handlers::num()), so taking one walks no user, channel or list
+ * entry as operator<<(Bot) does. The bytes are estimates from those counts: the
+ * nodes and buckets of each container, not what their strings hold elsewhere.
+ * What those nodes actually take, together, is counted by the Bot's Mem.
+ *
+ * Taken on the Bot's thread: by a handler, in sess.post() when pinned, or
+ * under its lock. With opts admin-socket the Bot serves write() to whoever
+ * connects. Like every Adoc, its values are written as strings; the flags are
+ * one, space separated.
+ */
+struct Stats
+{
+	enum Class { HOOK, LIB, USER, _NUM_CLASS };      // handler::Prio ranges
+
+	struct Bytes
+	{
+		size_t users = 0;
+		size_t chans = 0;
+		size_t members = 0;
+		size_t lists = 0;
+		size_t interned = 0;                          // of the process
+
+		size_t total() const                          { return users + chans + members + lists;   }
+	};
+
+	State state;
+	flag_t flags;
+
+	size_t users;
+	size_t chans;
+	chan::Tally lists;                                // memberships and list entries
+	size_t interned;                                  // strings in the Intern pool
+	Bytes bytes;
+	size_t mem_used;                                  // by the nodes of this bot's state (see: Mem)
+	size_t mem_reserved;                              // blocks of its pools and larger allocations
+	size_t mem_allocs;
+
+	size_t sendq_depth;                               // lines this bot has queued
+	size_t sendq_dropped;                             // by the overflow policy
+	size_t sendq_rejected;
+	size_t sendq_total;                               // lines queued by the process
+	milliseconds throttle;                            // until the socket throttle admits a line
+	size_t fetchq;                                    // channel parts waiting to be fetched
+	size_t pending;                                   // queries awaiting their replies
+
+	std::array<size_t,_NUM_CLASS> handlers;           // over every Events member
+
+	void write(std::ostream &s) const;                // JSON, as Adoc writes it
+
+	explicit Stats(const Bot &bot);
+};
+
+
+inline
+Stats::Stats(const Bot &bot):
+state(bot.sess.get_state()),
+flags(bot.sess.get_flags()),
+users(bot.users.num()),
+chans(bot.chans.num()),
+lists(bot.chans.get_tally()),
+interned(Intern::size()),
+mem_used(bot.mem.get_used()),
+mem_reserved(bot.mem.get_reserved()),
+mem_allocs(bot.mem.get_allocs()),
+sendq_depth(bot.sess.get_socket().get_depth()),
+sendq_dropped(bot.sess.get_socket().get_bound().dropped),
+sendq_rejected(bot.sess.get_socket().get_bound().rejected),
+sendq_total(sendq::size()),
+throttle(bot.sess.get_socket().get_throttle().calc_rel()),
+fetchq(bot.fetchq.size()),
+pending(bot.pending.size()),
+handlers{}
+{
+	// A tree node links three others and a color; a hash node one other and its
+	// hash, plus about a bucket each at the default load factor.
+	static constexpr size_t tree(4 * sizeof(void *)), hash(3 * sizeof(void *));
+	using Member = std::pair<const std::string, std::tuple<User *, Mode>>;
+
+	bytes.users = bot.users.num() * (sizeof(std::pair<const std::string, User>) + hash);
+	bytes.chans = chans * (sizeof(std::pair<const std::string, Chan>) + tree);
+	bytes.members = lists.members * (sizeof(Member) + hash);
+	bytes.lists = lists.bans * (sizeof(Ban) + tree) +
+	              lists.quiets * (sizeof(Quiet) + tree) +
+	              lists.excepts * (sizeof(Except) + tree) +
+	              lists.invites * (sizeof(Invite) + tree) +
+	              lists.akicks * (sizeof(AKick) + tree) +
+	              lists.flags * (sizeof(Flags) + tree);
+	bytes.interned = interned * (sizeof(std::string) + sizeof(std::weak_ptr<const std::string>) + tree);
+
+	const auto add([this](const auto &h)
+	{
+		handlers[HOOK] += h.num(handler::HOOK);
+		handlers[LIB] += h.num(handler::LIB);
+		handlers[USER] += h.num(handler::USER);
+	});
+
+	const auto &ev(bot.events);
+	add(ev.chan_user);
+	add(ev.chan);
+	add(ev.user);
+	add(ev.msg);
+	add(ev.state_leave);
+	add(ev.state);
+}
+
+
+inline
+void Stats::write(std::ostream &s)
+const
+{
+	static const std::map<State,const char *> states
+	{
+		{ State::FAULT,         "FAULT"        },
+		{ State::INACTIVE,      "INACTIVE"     },
+		{ State::CONNECTING,    "CONNECTING"   },
+		{ State::PROXYING,      "PROXYING"     },
+		{ State::NEGOTIATING,   "NEGOTIATING"  },
+		{ State::REGISTERING,   "REGISTERING"  },
+		{ State::IDENTIFYING,   "IDENTIFYING"  },
+		{ State::ACTIVE,        "ACTIVE"       },
+	};
+
+	static const std::vector<std::pair<Flag,const char *>> names
+	{
+		{ CONNECTED,   "CONNECTED"   },
+		{ PROXIED,     "PROXIED"     },
+		{ NEGOTIATED,  "NEGOTIATED"  },
+		{ WELCOMED,    "WELCOMED"    },
+		{ IDENTIFIED,  "IDENTIFIED"  },
+		{ CLOAKED,     "CLOAKED"     },
+		{ TIMEOUT,     "TIMEOUT"     },
+		{ SOCKERR,     "SOCKERR"     },
+		{ SERVERR,     "SERVERR"     },
+	};
+
+	std::string fl;
+	for(const auto &p : names)
+		if((flags & p.first) == p.first)
+			fl += std::string(fl.empty()? "" : " ") + p.second;
+
+	Adoc doc;
+	doc.put("state",states.at(state));
+	doc.put("flags",fl);
+	doc.put("users",users);
+	doc.put("chans",chans);
+	doc.put("members",lists.members);
+	doc.put("lists.bans",lists.bans);
+	doc.put("lists.quiets",lists.quiets);
+	doc.put("lists.excepts",lists.excepts);
+	doc.put("lists.invites",lists.invites);
+	doc.put("lists.akicks",lists.akicks);
+	doc.put("lists.flags",lists.flags);
+	doc.put("interned",interned);
+	doc.put("bytes.users",bytes.users);
+	doc.put("bytes.chans",bytes.chans);
+	doc.put("bytes.members",bytes.members);
+	doc.put("bytes.lists",bytes.lists);
+	doc.put("bytes.total",bytes.total());
+	doc.put("bytes.interned",bytes.interned);
+	doc.put("mem.used",mem_used);
+	doc.put("mem.reserved",mem_reserved);
+	doc.put("mem.allocs",mem_allocs);
+	doc.put("sendq.depth",sendq_depth);
+	doc.put("sendq.dropped",sendq_dropped);
+	doc.put("sendq.rejected",sendq_rejected);
+	doc.put("sendq.total",sendq_total);
+	doc.put("sendq.throttle_ms",throttle.count());
+	doc.put("fetchq",fetchq);
+	doc.put("pending",pending);
+	doc.put("handlers.hook",handlers[HOOK]);
+	doc.put("handlers.lib",handlers[LIB]);
+	doc.put("handlers.user",handlers[USER]);
+	s << doc;
+}
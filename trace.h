@@ -0,0 +1,185 @@
+/**
+ *  COPYRIGHT 2014 (C) Jason Volk
+ *  COPYRIGHT 2014 (C) Svetlana Tkachenko
+ *
+ *  DISTRIBUTED UNDER THE GNU GENERAL PUBLIC LICENSE (GPL) (see: LICENSE)
+ */
+
+
+/**
+ * Latency tracing from a line's receipt to the replies it caused on the wire.
+ *
+ * While enabled, each line received gets a trace id and its time of receipt
+ * (a Ctx, carried by its Msg). The Ctx is current on the thread for as long as
+ * the line's handlers run, so whatever they send through a Stream or Quote is
+ * stamped with it by the Socket and carried in its sendq::Ent. The stages are
+ * recorded as spans of that id:
+ *
+ *	parse        received to Msg constructed
+ *	dispatch     every handler of the event
+ *	reply        received to on the wire, for each line sent; within it:
+ *	  delay      submit to its slot, when paced by the caller (e.g Locutor)
+ *	  throttle   submit to its slot, when paced by the Socket throttle
+ *	  sendq      its slot to on the wire (waiting in the slowq, then written)
+ *
+ * The last trace-max spans are kept and written as Chrome trace JSON (for
+ * chrome://tracing or Perfetto), one track per trace id. Disabled, the cost
+ * is a relaxed load per line received and a copy of the empty Ctx per line
+ * sent.
+ */
+class Trace
+{
+  public:
+	struct Ctx
+	{
+		uint64_t id = 0;                              // 0 when not traced
+		time_point recv;
+	};
+
+	struct Span
+	{
+		uint64_t id;
+		const char *name;
+		std::string detail;                           // event or command
+		time_point start;
+		time_point end;
+	};
+
+	struct Scope                                      // Ctx current on this thread for its lifetime
+	{
+		Ctx prev;
+
+		Scope(const Ctx &ctx): prev(current) { current = ctx; }
+		~Scope() { current = prev; }
+	};
+
+  private:
+	static std::mutex mutex;                          // bot.cpp
+	static std::deque<Span> spans;                    // bot.cpp
+	static size_t max;                                // bot.cpp
+	static std::atomic<bool> enabled;                 // bot.cpp
+	static std::atomic<uint64_t> ids;                 // bot.cpp
+	static thread_local Ctx current;                  // bot.cpp
+
+  public:
+	static bool is_enabled()                          { return enabled.load(std::memory_order_relaxed); }
+	static const Ctx &get_current()                   { return current;                          }
+	static size_t size();
+
+	static void enable(const size_t &max);            // keeping the last max spans
+	static Ctx begin();                               // new id, received now, if enabled (No lock required)
+	static void span(const Ctx &ctx, const char *const &name, const std::string &detail,
+	                 const time_point &start, const time_point &end);
+
+	static void write(std::ostream &s);               // Chrome trace JSON
+	static void dump(const std::string &path);        // write() to a temp file renamed over path
+};
+
+
+inline
+void Trace::enable(const size_t &max)
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	Trace::max = std::max(Trace::max,max);
+	enabled.store(true,std::memory_order_relaxed);
+}
+
+
+inline
+Trace::Ctx Trace::begin()
+{
+	if(!is_enabled())
+		return {};
+
+	return {ids.fetch_add(1,std::memory_order_relaxed) + 1,steady_clock::now()};
+}
+
+
+inline
+void Trace::span(const Ctx &ctx,
+                 const char *const &name,
+                 const std::string &detail,
+                 const time_point &start,
+                 const time_point &end)
+{
+	if(!ctx.id)
+		return;
+
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	spans.push_back({ctx.id,name,detail,start,end});
+	while(spans.size() > max)
+		spans.pop_front();
+}
+
+
+inline
+size_t Trace::size()
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	return spans.size();
+}
+
+
+/**
+ * Each span is a complete event on the track (tid) of its trace id, so the
+ * stages of one trace nest together whatever thread recorded them.
+ */
+inline
+void Trace::write(std::ostream &s)
+{
+	using namespace std::chrono;
+
+	std::deque<Span> spans;
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		spans = Trace::spans;
+	}
+
+	const auto us([](const nanoseconds &ns)
+	{
+		return duration_cast<microseconds>(ns).count();
+	});
+
+	const auto pid(::getpid());
+	s << "{\"traceEvents\":[";
+	for(auto it(spans.begin()); it != spans.end(); ++it)
+	{
+		const auto &span(*it);
+		s << (it == spans.begin()? "\n" : ",\n")
+		  << "{\"name\":\"" << span.name << "\","
+		  << "\"cat\":\"ircbot\","
+		  << "\"ph\":\"X\","
+		  << "\"pid\":" << pid << ","
+		  << "\"tid\":" << span.id << ","
+		  << "\"ts\":" << us(span.start.time_since_epoch()) << ","
+		  << "\"dur\":" << us(std::max(span.end - span.start,nanoseconds(0))) << ","
+		  << "\"args\":{\"detail\":\"";
+
+		for(const auto &c : span.detail)
+			if(c == '"' || c == '\\')
+				s << '\\' << c;
+			else if(uint8_t(c) >= 0x20)
+				s << c;
+
+		s << "\"}}";
+	}
+
+	s << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+
+inline
+void Trace::dump(const std::string &path)
+{
+	const auto tmp(path + ".tmp");
+	{
+		std::ofstream file(tmp,std::ios::out | std::ios::trunc);
+		if(!file.is_open())
+			throw Exception("Failed to open trace file: ") << tmp;
+
+		write(file);
+	}
+
+	if(::rename(tmp.c_str(),path.c_str()) < 0)
+		throw Exception("Failed to replace trace file: ") << path << ": " << strerror(errno);
+}
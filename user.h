@@ -10,12 +10,13 @@ class User : public Locutor,
              public Acct
 {
 	// nick -> Locutor::target                         // who 'n'
-	std::string host;                                  // who 'h'
+	Intern::Ref host;                                  // who 'h' (shared with every Bot)
 	std::string acct;                                  // who 'a' (account name)
 	bool secure;                                       // WHOISSECURE (ssl)
 	time_t signon;                                     // WHOISIDLE
 	time_t idle;                                       // who 'l' or WHOISIDLE
 	bool away;
+	time_t fresh;                                      // last WHO reply for this user
 	size_t chans;                                      // reference counter for number of channels
 
   public:
@@ -24,14 +25,16 @@ class User : public Locutor,
 
 	// Observers
 	auto &get_nick() const                             { return Locutor::get_target();               }
-	auto &get_host() const                             { return host;                                }
+	auto &get_host() const                             { return *host;                               }
 	auto &get_acct() const                             { return acct;                                }
 	auto &is_secure() const                            { return secure;                              }
 	auto &is_away() const                              { return away;                                }
 	auto &get_signon() const                           { return signon;                              }
 	auto &get_idle() const                             { return idle;                                }
+	auto &get_fresh() const                            { return fresh;                               }
+	bool is_fresh(const time_t &ttl) const             { return fresh && fresh + ttl >= time(NULL);  }
 	auto &num_chans() const                            { return chans;                               }
-	bool is_myself() const                             { return get_nick() == get_sess().get_nick(); }
+	bool is_myself() const                             { return get_nick() == get_my_nick();         }
 	bool is_logged_in() const;
 	bool is_owner() const;
 	Mask mask(const Mask::Type &t) const;              // Generate a mask from *this members
@@ -53,17 +56,20 @@ class User : public Locutor,
 	// [RECV] Handlers may call to update state
 	void set_nick(const std::string &nick)             { Locutor::set_target(nick);                  }
 	void set_acct(const std::string &acct)             { this->acct = tolower(acct);                 }
-	void set_host(const std::string &host)             { this->host = host;                          }
+	void set_host(const std::string &host)             { this->host = Intern::get(host);             }
 	void set_secure(const bool &secure)                { this->secure = secure;                      }
 	void set_signon(const time_t &signon)              { this->signon = signon;                      }
 	void set_idle(const time_t &idle)                  { this->idle = idle;                          }
 	void set_away(const bool &away)                    { this->away = away;                          }
+	void set_fresh()                                   { this->fresh = time(NULL);                   }
 	void inc_chans(const size_t &n = 1)                { chans += n;                                 }
 	void dec_chans(const size_t &n = 1)                { chans -= n;                                 }
 
 	// [SEND] Controls
 	void who(const std::string &flags = WHO_FORMAT);   // Requests who with flags we need by default
-	void info();                                       // Update acct["info"] from nickserv
+	void who(const Pending::Callback &cb, const std::string &flags = WHO_FORMAT);
+	void info(const Service::Callback &cb = nullptr);  // Update acct["info"] from nickserv
+	std::future<Service::Capture> info_async();        // Not to be waited on by a handler
 
 	explicit User(const std::string &nick, const std::string &host = {}, const std::string &acct = {});
 	User(User &&user) noexcept;
@@ -80,13 +86,14 @@ User::User(const std::string &nick,
            const std::string &host,
            const std::string &acct):
 Locutor(nick),
-Acct(&this->acct),
-host(host),
+Acct(&this->acct,&Locutor::get_ctx().get_adb()),
+host(Intern::get(host)),
 acct(tolower(acct)),
 secure(false),
 signon(0),
 idle(0),
 away(false),
+fresh(0),
 chans(0)
 {
 }
@@ -95,13 +102,14 @@ chans(0)
 inline
 User::User(const User &user):
 Locutor(user),
-Acct(&this->acct),
+Acct(&this->acct,&Locutor::get_ctx().get_adb()),
 host(user.host),
 acct(user.acct),
 secure(user.secure),
 signon(user.signon),
 idle(user.idle),
 away(user.away),
+fresh(user.fresh),
 chans(user.chans)
 {
 }
@@ -111,13 +119,14 @@ inline
 User::User(User &&user)
 noexcept:
 Locutor(std::move(user)),
-Acct(&this->acct),
+Acct(&this->acct,&Locutor::get_ctx().get_adb()),
 host(std::move(user.host)),
 acct(std::move(user.acct)),
 secure(std::move(user.secure)),
 signon(std::move(user.signon)),
 idle(std::move(user.idle)),
 away(std::move(user.away)),
+fresh(std::move(user.fresh)),
 chans(std::move(user.chans))
 {
 }
@@ -133,6 +142,7 @@ User &User::operator=(const User &o)
 	signon = o.signon;
 	idle = o.idle;
 	away = o.away;
+	fresh = o.fresh;
 	chans = o.chans;
 	return *this;
 }
@@ -149,33 +159,54 @@ noexcept
 	signon = std::move(o.signon);
 	idle = std::move(o.idle);
 	away = std::move(o.away);
+	fresh = std::move(o.fresh);
 	chans = std::move(o.chans);
 	return *this;
 }
 
 
 inline
-void User::info()
+void User::info(const Service::Callback &cb)
 {
-	Service &ns(get_ns());
+	Service &ns(get_ctx().get_ns());
 	ns << "info " << acct << flush;
 	ns.terminator_next("*** End of Info ***");
+	if(cb)
+		ns.terminator_then(cb);
+}
+
+
+inline
+std::future<Service::Capture> User::info_async()
+{
+	auto p(Service::promise());
+	info(p.first);
+	return std::move(p.second);
 }
 
 
 inline
 void User::who(const std::string &flags)
 {
-	Quote out("WHO");
+	Quote out(get_ctx(),"WHO");
 	out << get_nick() << " " << flags << flush;
 }
 
 
+inline
+void User::who(const Pending::Callback &cb,
+               const std::string &flags)
+{
+	get_ctx().get_pending().add({get_nick(),{RPL_WHOREPLY,RPL_WHOSPCRPL},{RPL_ENDOFWHO},cb});
+	who(flags);
+}
+
+
 inline
 bool User::is_owner()
 const
 {
-	const auto &opts(get_opts());
+	const auto &opts(get_ctx().get_sess().get_opts());
 	return is_logged_in() && (get_acct() == opts["owner"] || get_nick() == opts["owner"]);
 }
 
@@ -198,17 +229,17 @@ const
 			if(mask.has_all_wild())
 				return true;
 
-			if(tolower(mask.get_host()) == tolower(get_host()))
+			if(iequals(mask.get_host(),get_host()))
 				return true;
 
-			if(tolower(mask.get_nick()) == tolower(get_nick()))
+			if(iequals(mask.get_nick(),get_nick()))
 				return true;
 
 		case Mask::EXTENDED:
 			return tolower(mask.get_mask()) == get_acct();
 
 		case Mask::INVALID:
-			return tolower(mask) == tolower(get_nick());
+			return iequals(mask,get_nick());
 
 		default:
 			throw Exception("Mask format unrecognized.");
@@ -9,7 +9,7 @@
 class Users
 {
 	using Cmp = CaseInsensitiveEqual<std::string>;
-	std::unordered_map<std::string, User, Cmp, Cmp> users;
+	std::unordered_map<std::string, User, Cmp, Cmp, Alloc<std::pair<const std::string, User>>> users;
 
   public:
 	// Observers
@@ -26,11 +26,21 @@ class Users
 	void rename(const std::string &old_nick, const std::string &new_nick);
 	template<class... Args> User &add(const std::string &nick, Args&&... args);
 	bool del(const User &user);
+	void clear()                                         { users.clear();                     }
+
+	Users(Mem *const &mem = nullptr);
 
 	friend std::ostream &operator<<(std::ostream &s, const Users &u);
 };
 
 
+inline
+Users::Users(Mem *const &mem):
+users(0,Cmp(),Cmp(),mem)
+{
+}
+
+
 inline
 bool Users::del(const User &user)
 {
@@ -42,6 +52,10 @@ template<class... Args>
 User &Users::add(const std::string &nick,
                  Args&&... args)
 {
+	const auto it(users.find(nick));
+	if(it != users.end())
+		return it->second;
+
 	const auto &iit(users.emplace(std::piecewise_construct,
 	                              std::forward_as_tuple(nick),
 	                              std::forward_as_tuple(nick,std::forward<Args>(args)...)));
@@ -171,14 +171,17 @@ std::string chomp(const std::string &str,
 }
 
 
-inline
-std::pair<std::string, std::string> split(const std::string &str,
-                                          const std::string &delim = " ")
+template<class A = std::allocator<char>>
+auto split(const std::string &str,
+           const std::string &delim = " ",
+           const A &alloc = A{})
 {
+	using S = std::basic_string<char, std::char_traits<char>, A>;
+
 	const auto pos(str.find(delim));
 	return pos == std::string::npos?
-	              std::make_pair(str,std::string{}):
-	              std::make_pair(str.substr(0,pos), str.substr(pos+delim.size()));
+	              std::make_pair(S(str.begin(),str.end(),alloc),S(alloc)):
+	              std::make_pair(S(str.begin(),str.begin()+pos,alloc),S(str.begin()+pos+delim.size(),str.end(),alloc));
 }
 
 
@@ -232,13 +235,14 @@ template<template<class,
                   class T = std::string,
                   class A = std::allocator<T>>
 C<T,A> tokens(const std::string &str,
-              const char *const &sep = " ")
+              const char *const &sep = " ",
+              const A &alloc = A{})
 {
 	using delim = boost::char_separator<char>;
 
 	const delim d(sep);
 	const boost::tokenizer<delim> tk(str,d);
-	return {std::begin(tk),std::end(tk)};
+	return C<T,A>(std::begin(tk),std::end(tk),alloc);
 }
 
 
@@ -543,10 +547,12 @@ const char *tolower(char (&buf)[SIZE])
 }
 
 
-inline
-std::string tolower(const std::string &str)
+template<class S,
+         class A>
+auto tolower(const S &str,
+             const A &alloc)
 {
-	std::string ret(str.size(),char());
+	std::basic_string<char, std::char_traits<char>, A> ret(str.size(),char(),alloc);
 	std::transform(str.begin(),str.end(),ret.begin(),[]
 	(const char &c)
 	{
@@ -557,25 +563,74 @@ std::string tolower(const std::string &str)
 }
 
 
+inline
+std::string tolower(const std::string &str)
+{
+	return tolower(str,std::allocator<char>{});
+}
+
+
+// tolower(a) == tolower(b), without making either
+template<class A,
+         class B>
+bool iequals(const A &a,
+             const B &b)
+{
+	return std::equal(std::begin(a),std::end(a),std::begin(b),std::end(b),[]
+	(const char &x, const char &y)
+	{
+		return tolower(x) == tolower(y);
+	});
+}
+
+
+// tolower(a) < tolower(b), without making either
+template<class A,
+         class B>
+bool iless(const A &a,
+           const B &b)
+{
+	return std::lexicographical_compare(std::begin(a),std::end(a),std::begin(b),std::end(b),[]
+	(const char &x, const char &y)
+	{
+		return uint8_t(tolower(x)) < uint8_t(tolower(y));
+	});
+}
+
+
+// hash() of tolower(a), without making it
+template<class A>
+size_t ihash(const A &a)
+{
+	size_t ret(5381ULL);
+	for(auto it(std::rbegin(a)); it != std::rend(a); ++it)
+		ret = (ret * 33ULL) ^ tolower(*it);
+
+	return ret;
+}
+
+
 template<class T = std::string>
 struct CaseInsensitiveEqual
 {
-	auto operator()(const T &a, const T &b) const    { return tolower(a) == tolower(b);   }
-	auto operator()(const T &a) const                { return std::hash<T>()(tolower(a)); }
+	auto operator()(const T &a, const T &b) const    { return iequals(a,b);               }
+	auto operator()(const T &a) const                { return ihash(a);                   }
 };
 
 
 template<class T = std::string>
 struct CaseInsensitiveLess
 {
-	auto operator()(const T &a, const T &b) const    { return tolower(a) < tolower(b);    }
+	auto operator()(const T &a, const T &b) const    { return iless(a,b);                 }
 };
 
 
-inline
-std::string decolor(const std::string &str)
+template<class S,
+         class A>
+auto decolor(const S &str,
+             const A &alloc)
 {
-	std::string ret(str);
+	std::basic_string<char, std::char_traits<char>, A> ret(str.begin(),str.end(),alloc);
 	const auto end = std::remove_if(ret.begin(),ret.end(),[]
 	(const char &c)
 	{
@@ -595,6 +650,13 @@ std::string decolor(const std::string &str)
 }
 
 
+inline
+std::string decolor(const std::string &str)
+{
+	return decolor(str,std::allocator<char>{});
+}
+
+
 inline
 std::string randstr(const size_t &len)
 {